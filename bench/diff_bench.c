@@ -0,0 +1,221 @@
+//
+// Created by HP on 16/10/2026.
+//
+// Benchmark do diff de arquivos grandes: o patience (com as âncoras de linhas únicas)
+// contra a comparação posicional que era usada acima de 1000 linhas. Para cada
+// tamanho, uma linha é inserida perto do início e 2% das linhas são alteradas;
+// mostra as operações geradas e o tempo médio de cada caminho, do texto às
+// operações prontas para o journal.
+//
+// Uso: diff_bench [-c PERCENT] [-s SEED] [LINHAS...]
+//
+#include "diff.h"
+#include "line_index.h"
+#include "operation.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+
+#define BENCH_MIN_NS 200000000LL      // Repete cada medida até somar pelo menos 200 ms
+#define BENCH_MAX_RUNS 1000
+#define BENCH_LINE_LEN 48
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    // xorshift64*: sequência reproduzível pela semente
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1DULL;
+}
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Linha de código plausível: números e identificadores, quase sempre únicos
+static size_t append_line(char* out, int n) {
+    return (size_t)snprintf(out, BENCH_LINE_LEN + 1, "    value_%d = compute(%llu, %d);\n",
+                            n, (unsigned long long)(rng_next() % 100000), n % 97);
+}
+
+// Conteúdo original com `lines` linhas e a versão editada: uma linha inserida
+// perto do início e `percent`% das linhas substituídas
+static void build_contents(int lines, double percent, char** old_text, size_t* old_len,
+                           char** new_text, size_t* new_len) {
+    char* old_buf = (char*)safe_malloc((size_t)lines * BENCH_LINE_LEN + 1);
+    char* new_buf = (char*)safe_malloc(((size_t)lines + 1) * BENCH_LINE_LEN + 1);
+    size_t o = 0, n = 0;
+    int inserted_at = lines > 10 ? 3 : 0;
+
+    for (int i = 0; i < lines; i++) {
+        size_t len = append_line(old_buf + o, i);
+
+        if (i == inserted_at) {
+            n += (size_t)snprintf(new_buf + n, BENCH_LINE_LEN + 1, "    // inserted line\n");
+        }
+        if ((double)(rng_next() % 10000) < percent * 100.0) {
+            n += append_line(new_buf + n, lines + i);
+        } else {
+            memcpy(new_buf + n, old_buf + o, len);
+            n += len;
+        }
+        o += len;
+    }
+    old_buf[o] = '\0';
+    new_buf[n] = '\0';
+
+    *old_text = old_buf;
+    *old_len = o;
+    *new_text = new_buf;
+    *new_len = n;
+}
+
+// Caminho antigo acima de 1000 linhas: str_split_lines nos dois lados e comparação
+// posicional (simple_diff_algorithm), linha i contra linha i, com uma operação por
+// posição diferente
+static long positional_diff(const char* old_text, const char* new_text) {
+    int old_count, new_count;
+    char** old_lines = str_split_lines(old_text, &old_count);
+    char** new_lines = str_split_lines(new_text, &new_count);
+    long ops = 0;
+    int i = 0, j = 0;
+
+    while (i < old_count || j < new_count) {
+        Operation* op = NULL;
+        if (i >= old_count) {
+            op = operation_create("insert", j, 0, new_lines[j], "bench");
+            j++;
+        } else if (j >= new_count) {
+            op = operation_create("delete", i, 0, old_lines[i], "bench");
+            i++;
+        } else {
+            if (strcmp(old_lines[i], new_lines[j]) != 0) {
+                op = operation_create("replace", i, 0, new_lines[j], "bench");
+            }
+            i++;
+            j++;
+        }
+        if (op) {
+            operation_destroy(op);
+            ops++;
+        }
+    }
+
+    str_free_lines(old_lines, old_count);
+    str_free_lines(new_lines, new_count);
+    return ops;
+}
+
+// Operação de várias linhas, como as do versionamento
+static void range_operation(const char* type, const LineView* lines, int count) {
+    if (count <= 0) return;
+    size_t len = (size_t)(lines[count - 1].content + lines[count - 1].length - lines[0].content);
+    Operation* op = operation_create_n(type, 0, 0, lines[0].content, len, "bench");
+    op->line_count = count;
+    operation_destroy(op);
+}
+
+// Caminho atual: índice de linhas com hash, patience e no máximo um delete e um
+// insert de várias linhas por trecho (sem diff dentro da linha)
+static long patience_diff(const char* old_text, size_t old_len, const char* new_text, size_t new_len) {
+    LineIndex old_index, new_index;
+    line_index_build(&old_index, old_text, old_len, 1);
+    line_index_build(&new_index, new_text, new_len, 1);
+
+    long ops = -1;
+    DiffScript script = {0};
+    if (diff_patience(old_index.lines, old_index.count, new_index.lines, new_index.count, &script) == 0) {
+        ops = 0;
+        for (int h = 0; h < script.count; h++) {
+            const DiffHunk* hunk = &script.hunks[h];
+            range_operation("delete", &old_index.lines[hunk->old_start], hunk->old_count);
+            range_operation("insert", &new_index.lines[hunk->new_start], hunk->new_count);
+            ops += (hunk->old_count > 0) + (hunk->new_count > 0);
+        }
+    }
+
+    diff_script_free(&script);
+    line_index_free(&old_index);
+    line_index_free(&new_index);
+    return ops;
+}
+
+static void run_size(int lines, double percent) {
+    char *old_text, *new_text;
+    size_t old_len, new_len;
+    build_contents(lines, percent, &old_text, &old_len, &new_text, &new_len);
+
+    long positional_ops = 0;
+    int runs = 0;
+    long long start = now_ns(), elapsed;
+    do {
+        positional_ops = positional_diff(old_text, new_text);
+        runs++;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS && runs < BENCH_MAX_RUNS);
+    double positional_ms = elapsed / 1e6 / runs;
+
+    long patience_ops = 0;
+    runs = 0;
+    start = now_ns();
+    do {
+        patience_ops = patience_diff(old_text, old_len, new_text, new_len);
+        runs++;
+        elapsed = now_ns() - start;
+    } while (patience_ops >= 0 && elapsed < BENCH_MIN_NS && runs < BENCH_MAX_RUNS);
+    double patience_ms = elapsed / 1e6 / runs;
+
+    if (patience_ops < 0) {
+        log_message(LOG_ERROR, "Patience diff failed for %d lines", lines);
+    }
+    printf("%9d  %12ld  %10.3f  %12ld  %10.3f\n",
+           lines, positional_ops, positional_ms, patience_ops, patience_ms);
+
+    safe_free(old_text);
+    safe_free(new_text);
+}
+
+int main(int argc, char* argv[]) {
+    static const int default_sizes[] = {1000, 10000, 100000, 1000000};
+    double percent = 2.0;
+    uint64_t seed = 42;
+
+    int c;
+    while ((c = getopt(argc, argv, "c:s:h")) != -1) {
+        switch (c) {
+            case 'c':
+                percent = atof(optarg);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-c PERCENT] [-s SEED] [LINES...]\n", argv[0]);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    printf("One line inserted near the top, %.1f%% of lines changed\n", percent);
+    printf("%9s  %12s  %10s  %12s  %10s\n", "lines", "positional", "ms", "patience", "ms");
+
+    if (optind < argc) {
+        for (int i = optind; i < argc; i++) {
+            int lines = atoi(argv[i]);
+            if (lines > 0) run_size(lines, percent);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(default_sizes) / sizeof(default_sizes[0]); i++) {
+            run_size(default_sizes[i], percent);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef BLOCK_DELTA_H
+#define BLOCK_DELTA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLOCK_DELTA_MIN_BLOCK 512
+#define BLOCK_DELTA_MAX_BLOCK (128 * 1024)
+#define BLOCK_DELTA_SEED 0x626c6f636b73756dULL    // "blocksum"
+#define BLOCK_SIGNATURE_MAGIC "MYVCSIG1"
+
+// Soma de um bloco: fraca (rolante, estilo rsync) para achar candidatos em
+// qualquer deslocamento e forte para confirmar
+typedef struct {
+    uint32_t weak;
+    uint64_t strong;
+} BlockSum;
+
+// Assinatura do conteúdo antigo: basta ela (sem o conteúdo) para gerar o delta.
+// O último bloco pode ser menor que block_size.
+typedef struct {
+    uint32_t block_size;
+    uint64_t size;
+    uint64_t content_hash;        // hash_bytes64 do conteúdo inteiro
+    uint32_t block_count;
+    BlockSum* blocks;
+    int* buckets;                 // Soma fraca -> primeiro bloco (-1 = vazio)
+    int* chain;                   // Próximo bloco no mesmo bucket
+    uint32_t bucket_mask;
+} BlockSignature;
+
+// Tamanho de bloco ~ raiz quadrada do tamanho, como no rsync
+uint32_t block_delta_block_size(size_t size);
+
+void block_signature_build(BlockSignature* sig, const void* data, size_t len);
+void block_signature_free(BlockSignature* sig);
+size_t block_signature_memory(const BlockSignature* sig);
+
+// Forma serializada (guardada no snapshot store quando o baseline é despejado)
+void* block_signature_encode(const BlockSignature* sig, size_t* len);
+int block_signature_decode(BlockSignature* sig, const void* data, size_t len);
+
+// Delta binário compacto:
+//   varint(block_size) varint(tamanho antigo) u64(hash antigo) varint(tamanho novo) u64(hash novo)
+//   'C' varint(primeiro bloco) varint(blocos)   copia blocos do conteúdo antigo
+//   'I' varint(len) bytes                       insere bytes literais
+// `copied` (opcional) recebe quantos bytes vieram de blocos do conteúdo antigo.
+unsigned char* block_delta_encode(const BlockSignature* sig, const void* data, size_t len,
+                                  size_t* delta_len, size_t* copied);
+
+// Confere os hashes do conteúdo antigo e do resultado; NULL se o delta não se aplica
+char* block_delta_apply(const void* old_data, size_t old_len, const void* delta, size_t delta_len,
+                        size_t* new_len);
+
+#endif // BLOCK_DELTA_H
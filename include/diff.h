@@ -0,0 +1,93 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "line_index.h"
+
+#define DIFF_INITIAL_DCAP 64                   // Diagonais iniciais dos vetores V
+#define DIFF_PATIENCE_MIN_REGION 64            // Regiões menores vão direto para o Myers
+#define DIFF_AUTO_SMALL_WINDOW 256             // Janelas até aqui usam Myers sem medir
+#define DIFF_AUTO_MYERS_COST 4000000LL         // (N + M) * D estimado aceitável para o Myers
+#define DIFF_AUTO_MIN_UNIQUE_RATIO 0.05        // Linhas únicas (sobre min(N, M)) para o patience
+#define DIFF_AUTO_SAMPLE_LINES 65536           // Acima disso, as medidas da janela usam uma amostra
+
+// Trecho alterado: old[old_start, old_start + old_count) vira new[new_start, new_start + new_count)
+typedef struct {
+    int old_start;
+    int old_count;
+    int new_start;
+    int new_count;
+} DiffHunk;
+
+// Script de edição: trechos em ordem crescente, separados por linhas iguais
+typedef struct {
+    DiffHunk* hunks;
+    int count;
+    int capacity;
+} DiffScript;
+
+// Prefixo e sufixo comuns de dois buffers, alinhados a fronteiras de linha: o prefixo
+// termina logo após um '\n' e o sufixo começa logo após um '\n' (nos dois lados)
+typedef struct {
+    size_t prefix;             // Bytes comuns no início
+    size_t suffix;             // Bytes comuns no fim (não se sobrepõe ao prefixo)
+    int prefix_lines;          // Linhas completas no prefixo
+} DiffTrim;
+
+// Comparação vetorizada (SSE2 quando disponível, palavras de 64 bits caso contrário)
+size_t diff_common_prefix(const char* a, const char* b, size_t len);
+size_t diff_common_suffix(const char* a_end, const char* b_end, size_t len);
+void diff_trim_common(const char* a, size_t a_len, const char* b, size_t b_len, DiffTrim* trim);
+
+// Myers O(ND) com refinamento em espaço linear (middle snake): tempo proporcional
+// a (N + M) * D e memória proporcional a D, o número de linhas alteradas
+int diff_myers(const LineView* old_lines, int old_count,
+               const LineView* new_lines, int new_count, DiffScript* script);
+
+// Patience: ancora nas linhas únicas dos dois lados (maior subsequência crescente) e
+// usa o Myers entre âncoras. Quase mínimo e O(N log N) por nível, mesmo com muitas
+// alterações espalhadas em arquivos grandes
+int diff_patience(const LineView* old_lines, int old_count,
+                  const LineView* new_lines, int new_count, DiffScript* script);
+
+typedef enum {
+    DIFF_ENGINE_MYERS,
+    DIFF_ENGINE_PATIENCE,
+    DIFF_ENGINE_COUNT
+} DiffEngine;
+
+typedef enum {
+    DIFF_REASON_SMALL_WINDOW,      // Poucas linhas: Myers é barato de qualquer forma
+    DIFF_REASON_LOW_COST,          // (N + M) * D estimado pequeno: Myers, resultado mínimo
+    DIFF_REASON_UNIQUE_ANCHORS,    // Caro, mas com linhas únicas para ancorar: patience
+    DIFF_REASON_FEW_UNIQUE,        // Caro e sem âncoras: Myers limitado pelo orçamento
+    DIFF_REASON_COUNT
+} DiffReason;
+
+// Medidas da janela e decisão tomada por diff_auto
+typedef struct {
+    int window_lines;              // N + M (após o corte de prefixo/sufixo)
+    long estimated_edits;          // Limite inferior de D pelas contagens (estimado por amostra em janelas grandes)
+    double unique_ratio;           // Pares de linhas únicas / min(N, M), idem
+    DiffEngine engine;
+    DiffReason reason;
+    int budget_exhausted;          // Parte do resultado saiu como substituição em bloco
+    long long elapsed_ns;
+} DiffPlan;
+
+// Escolhe o algoritmo pelas medidas da janela e limita o tempo gasto: esgotado o
+// orçamento (`budget_ns`, 0 = sem limite), as regiões ainda não resolvidas viram
+// uma substituição em bloco. O script continua correto, apenas não mínimo.
+int diff_auto(const LineView* old_lines, int old_count, const LineView* new_lines, int new_count,
+              long long budget_ns, DiffScript* script, DiffPlan* plan);
+const char* diff_engine_name(DiffEngine engine);
+const char* diff_reason_name(DiffReason reason);
+
+void diff_script_free(DiffScript* script);
+
+#endif // DIFF_H
@@ -0,0 +1,26 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef DIFF_POOL_H
+#define DIFF_POOL_H
+
+#define DIFF_POOL_MAX_THREADS 64
+
+// Tarefa executada por um worker (recebe e libera o próprio argumento)
+typedef void (*DiffPoolTask)(void* arg);
+
+typedef struct DiffPool DiffPool;
+
+// Cada chave (caminho do arquivo) é atribuída sempre ao mesmo worker: tarefas da
+// mesma chave rodam na ordem de envio e nunca em paralelo; chaves diferentes se
+// espalham pelos workers
+DiffPool* diff_pool_create(int threads);
+void diff_pool_destroy(DiffPool* pool);      // Executa o que estiver na fila antes de parar
+int diff_pool_submit(DiffPool* pool, const char* key, DiffPoolTask task, void* arg);
+void diff_pool_wait(DiffPool* pool);         // Aguarda todas as tarefas enviadas até agora
+
+// Um worker por núcleo disponível
+int diff_pool_default_threads(void);
+
+#endif // DIFF_POOL_H
@@ -0,0 +1,61 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "operation.h"
+
+// Buffer somente-acréscimo com as posições de cada '\n' (para achar linhas
+// dentro de uma peça por busca binária, sem varrer o texto)
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+    size_t* newlines;
+    size_t newline_count;
+    size_t newline_capacity;
+} DocumentBuffer;
+
+typedef struct DocumentPiece DocumentPiece;
+
+// Piece table: o texto é a sequência de peças (trechos do buffer original ou do
+// buffer de acréscimos) guardada numa treap implícita, com tamanho e quantidade
+// de '\n' agregados por subárvore. Localizar (linha, coluna), inserir e remover
+// custam O(log n) no número de peças.
+typedef struct {
+    DocumentBuffer original;
+    DocumentBuffer added;
+    DocumentPiece* root;
+    uint32_t seed;
+    int empty;                   // Sem nenhuma linha (todas removidas); "" normal tem uma linha vazia
+} Document;
+
+// `content` (alocado com safe_malloc) passa a pertencer ao documento
+void document_init(Document* doc, char* content, size_t size);
+void document_reset(Document* doc, char* content, size_t size);
+void document_free(Document* doc);
+
+size_t document_size(const Document* doc);
+int document_line_count(const Document* doc);   // Como str_split_lines: N '\n' = N + 1 linhas
+int document_line_offset(const Document* doc, int line, size_t* offset);
+
+int document_insert(Document* doc, size_t offset, const char* text, size_t len);
+int document_delete(Document* doc, size_t offset, size_t len);
+int document_read(const Document* doc, size_t offset, size_t len, char* out);
+
+// Aplica uma operação (insert/delete/replace de linhas, ins_text/del_text em
+// colunas, create). Remoções conferem o texto removido; -1 se não bater.
+int document_apply(Document* doc, const Operation* op);
+
+// Texto contínuo terminado em '\0'. Consolida as peças num único buffer quando
+// há edições (O(n) uma vez); sem edições devolve o buffer original.
+const char* document_text(Document* doc, size_t* size);
+
+// Grava as peças em ordem, numa única escrita do arquivo
+int document_write(const Document* doc, const char* filepath);
+
+#endif // DOCUMENT_H
@@ -0,0 +1,35 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Checksums (CRC-32 IEEE, usado para validar registros em disco)
+uint32_t hash_crc32(const void* data, size_t len);
+uint32_t hash_crc32_update(uint32_t crc, const void* data, size_t len);
+
+// Hash não criptográfico de 64 bits (MurmurHash64A, processa 8 bytes por vez)
+uint64_t hash_bytes64(const void* data, size_t len, uint64_t seed);
+
+// SHA-256 (identificação de conteúdo)
+#define HASH_SHA256_SIZE 32
+#define HASH_SHA256_HEX_SIZE (HASH_SHA256_SIZE * 2 + 1)
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    unsigned char buffer[64];
+    size_t buffer_len;
+} HashSha256;
+
+void hash_sha256_init(HashSha256* ctx);
+void hash_sha256_update(HashSha256* ctx, const void* data, size_t len);
+void hash_sha256_final(HashSha256* ctx, unsigned char digest[HASH_SHA256_SIZE]);
+void hash_sha256(const void* data, size_t len, unsigned char digest[HASH_SHA256_SIZE]);
+void hash_to_hex(const unsigned char* digest, size_t len, char* out);
+
+#endif // HASH_H
@@ -0,0 +1,104 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JOURNAL_DIR "journal"
+#define JOURNAL_SEGMENT_SIZE (16 * 1024 * 1024)  // Tamanho alvo de cada segmento
+#define JOURNAL_MAX_RECORD (64 * 1024 * 1024)    // Limite de sanidade para um registro
+#define JOURNAL_VERSION 1
+#define JOURNAL_OFFSETS_EXT ".off"   // Offsets (u32) de cada registro do segmento, em ordem
+
+// Posição de um registro no journal: (id do segmento << 40) | offset
+typedef uint64_t JournalPos;
+
+#define JOURNAL_POS(segment, offset) (((uint64_t)(segment) << 40) | (uint64_t)(offset))
+#define JOURNAL_POS_SEGMENT(pos) ((uint32_t)((pos) >> 40))
+#define JOURNAL_POS_OFFSET(pos) ((uint64_t)(pos) & ((1ULL << 40) - 1))
+
+// Cabeçalho de cada arquivo de segmento (<id>.seg)
+typedef struct {
+    char magic[8];          // "MYVCJRNL"
+    uint32_t version;
+    uint32_t segment_id;
+    uint64_t base_count;    // Registros existentes antes deste segmento
+    uint64_t reserved[5];
+} JournalSegmentHeader;
+
+// Cada registro: [u32 length][u32 crc32(payload)][payload][u32 length]
+// O comprimento repetido no final permite percorrer o segmento de trás para frente.
+#define JOURNAL_RECORD_HEADER 8
+#define JOURNAL_RECORD_TRAILER 4
+#define JOURNAL_RECORD_OVERHEAD (JOURNAL_RECORD_HEADER + JOURNAL_RECORD_TRAILER)
+
+typedef struct {
+    char dir[512];
+    int fd;                  // Segmento ativo (somente escrita)
+    int off_fd;              // Offsets do segmento ativo
+    int lock_fd;             // Lock exclusivo do escritor
+    int read_only;           // Outro processo detém o lock
+    uint32_t segment_id;     // Id do segmento ativo
+    uint64_t segment_size;   // Bytes válidos no segmento ativo
+    uint64_t base_count;     // Registros antes do segmento ativo
+    uint64_t record_count;   // Total de registros no journal (= último número de sequência)
+    unsigned char* staging;  // Buffer para escrita em lote
+    size_t staging_capacity;
+} Journal;
+
+// Leitor baseado em mmap: os segmentos são mapeados sob demanda
+typedef struct JournalReader JournalReader;
+
+// Visão de um registro dentro do segmento mapeado (válida enquanto o leitor estiver aberto)
+typedef struct {
+    const void* payload;
+    size_t length;
+    JournalPos pos;
+} JournalRecord;
+
+// Cursor para iteração em qualquer direção
+typedef struct {
+    JournalReader* reader;
+    int segment_index;
+    uint64_t offset;         // Fronteira entre registros dentro do segmento
+} JournalCursor;
+
+// Abrir/fechar (executa a varredura de recuperação no segmento ativo)
+Journal* journal_open(const char* dir);
+void journal_close(Journal* journal);
+
+// Escrita
+int journal_append(Journal* journal, const void* payload, size_t len, JournalPos* pos);
+int journal_append_batch(Journal* journal, const void* const* payloads, const size_t* lens,
+                         int count, JournalPos* positions);
+int journal_sync(Journal* journal);
+
+// Leitura
+JournalReader* journal_reader_open(const char* dir);
+void journal_reader_close(JournalReader* reader);
+uint64_t journal_reader_count(JournalReader* reader);
+int journal_reader_end(JournalReader* reader, JournalPos* end, uint64_t* count);
+int journal_reader_get(JournalReader* reader, JournalPos pos, JournalRecord* record);
+
+// Números de sequência: o n-ésimo registro do journal (a partir de 1) tem seq n.
+// A busca usa os arquivos de offsets (O(1) dentro do segmento).
+int journal_reader_get_seq(JournalReader* reader, uint64_t seq, JournalRecord* record);
+uint64_t journal_reader_seq_of(JournalReader* reader, JournalPos pos);
+
+// Cursores: next avança em direção ao fim, prev em direção ao início
+int journal_cursor_first(JournalReader* reader, JournalCursor* cursor);
+int journal_cursor_last(JournalReader* reader, JournalCursor* cursor);
+int journal_cursor_seek(JournalReader* reader, JournalPos pos, JournalCursor* cursor);
+int journal_cursor_next(JournalCursor* cursor, JournalRecord* record);
+int journal_cursor_prev(JournalCursor* cursor, JournalRecord* record);
+
+// Utilitários
+int journal_list_segments(const char* dir, uint32_t** ids, int* count);
+void journal_segment_path(const char* dir, uint32_t segment_id, char* out, size_t out_size);
+void journal_offsets_path(const char* dir, uint32_t segment_id, char* out, size_t out_size);
+
+#endif // JOURNAL_H
@@ -0,0 +1,44 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define LINE_HASH_SEED 0x6d79766364696666ULL   // "myvcdiff"
+
+// Linha como visão sobre o buffer original (sem o '\n'); nada é copiado
+typedef struct {
+    const char* content;
+    size_t length;
+    uint64_t hash;
+} LineView;
+
+// Índice de linhas de um buffer. Como str_split_lines, N quebras de linha geram
+// N + 1 linhas (a última vazia quando o texto termina em '\n').
+typedef struct {
+    const char* text;
+    size_t size;
+    LineView* lines;
+    int count;
+    int capacity;
+} LineIndex;
+
+// Varre as quebras de linha 16 bytes por vez (SSE2) ou com memchr. O buffer precisa
+// continuar válido enquanto o índice for usado. `with_hash` preenche LineView.hash.
+int line_index_build(LineIndex* index, const char* text, size_t size, int with_hash);
+void line_index_free(LineIndex* index);
+
+// Quantidade de '\n' no buffer
+int line_index_count_newlines(const char* text, size_t size);
+
+static inline int line_view_equal(const LineView* a, const LineView* b) {
+    return a->hash == b->hash && a->length == b->length &&
+           (a->length == 0 || memcmp(a->content, b->content, a->length) == 0);
+}
+
+#endif // LINE_INDEX_H
@@ -6,17 +6,38 @@
 #define LOG_H
 
 #include "operation.h"
+#include "journal.h"
+#include "log_index.h"
+#include "hash.h"
+#include "snapshot_store.h"
 #include "stdio.h"
 
 #define LOG_DIR ".myvc"
-#define LOG_FILE "log.json"
-#define OPS_DIR "ops"
+#define LOG_FILE "log.json"   // Formato legado, migrado para o journal
+#define OPS_DIR "ops"         // Formato legado, migrado para o journal
 #define VERSIONS_DIR "versions"
+#define CHECKPOINT_INDEX "checkpoints"   // Registros de tamanho fixo, somente anexados
+#define CHECKPOINT_MESSAGE_LEN 256
+
+// Checkpoint: ponteiro para um prefixo do journal e o digest desse prefixo.
+// O digest é encadeado (digest anterior + registros desde o checkpoint anterior),
+// então criar um checkpoint custa apenas as operações novas.
+typedef struct {
+    uint64_t id;                              // Começa em 1
+    uint64_t end_count;                       // Operações cobertas
+    uint64_t end_pos;                         // Posição logo após a última operação coberta
+    int64_t timestamp;
+    unsigned char digest[HASH_SHA256_SIZE];
+    char author[MAX_AUTHOR_LEN];
+    char message[CHECKPOINT_MESSAGE_LEN];
+} Checkpoint;
 
 typedef struct {
     char project_path[256];
     char log_path[512];
-    FILE* log_file;
+    Journal* journal;
+    LogIndex* index;       // Índices secundários (NULL em modo somente leitura)
+    SnapshotStore* snapshots;
 } LogManager;
 
 // Funções do gerenciador de logs
@@ -24,9 +45,20 @@ LogManager* log_create(const char* project_path);
 void log_destroy(LogManager* lm);
 int log_init_directory(const char* project_path);
 int log_save_operation(LogManager* lm, const Operation* op);
+int log_save_operations(LogManager* lm, const Operation* const* ops, int count);
+int log_sync(LogManager* lm);
 int log_save_snapshot(LogManager* lm, const char* filepath, const char* content);
+// Conteúdo (possivelmente binário) depois das operações emitidas; `hlc` é o da última
+// delas e ancora o snapshot no histórico (ver log_gc.h)
+int log_save_snapshot_n(LogManager* lm, const char* filepath, const void* content, size_t size, int64_t hlc);
 Operation** log_load_operations(LogManager* lm, int* count);
-char* log_load_snapshot(LogManager* lm, const char* version_id);
+JournalReader* log_open_reader(LogManager* lm);
+int log_query(LogManager* lm, JournalReader* reader, const LogQuery* query,
+              JournalPos** positions, size_t* count);
+char* log_load_snapshot(LogManager* lm, const char* version_id, size_t* size);
+char* log_load_snapshot_at(LogManager* lm, const char* filepath, long timestamp, size_t* size);
 int log_create_checkpoint(LogManager* lm, const char* message);
+Checkpoint* log_load_checkpoints(LogManager* lm, int* count);
+int log_last_checkpoint(LogManager* lm, Checkpoint* checkpoint);
 
 #endif // LOG_H
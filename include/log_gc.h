@@ -0,0 +1,53 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef LOG_GC_H
+#define LOG_GC_H
+
+#include <stdint.h>
+#include "log.h"
+#include "snapshot_store.h"
+
+#define LOG_BASELINE_FILE "baseline"
+#define LOG_BASELINE_MAGIC "MYVCBASE"
+#define LOG_BASELINE_VERSION 2          // 2: horizonte em relógio híbrido (ns)
+#define LOG_GC_LOCK "gc.lock"
+
+// Manifesto de baseline: estado de cada arquivo no ponto em que o histórico foi
+// compactado. O cabeçalho é seguido de `count` SnapshotRef ordenados por caminho.
+// O baseline de um arquivo é o snapshot ancorado (pelo relógio híbrido) na sua
+// última operação compactada, não o vigente num instante: edições do mesmo
+// segundo de um lado e do outro do horizonte não se confundem.
+typedef struct {
+    char magic[8];              // "MYVCBASE"
+    uint32_t version;
+    uint32_t count;
+    uint64_t first_pos;         // Primeiro registro mantido no journal
+    uint64_t folded_count;      // Operações incorporadas ao baseline (acumulado)
+    int64_t horizon;            // Relógio híbrido (ns) da última operação incorporada
+    uint64_t reserved[3];
+} LogBaselineHeader;
+
+typedef struct {
+    long before;                // Compactar operações até este instante (0 = sem limite)
+    uint64_t checkpoint_id;     // Compactar até este checkpoint (0 = último, se before == 0)
+    int force;                  // Descartar arquivos sem snapshot no horizonte
+} LogGcOptions;
+
+typedef struct {
+    int segments;               // Segmentos removidos
+    uint64_t operations;        // Operações incorporadas
+    uint64_t bytes;             // Bytes liberados no journal
+    int files;                  // Arquivos no baseline
+    int missing;                // Arquivos sem snapshot no horizonte
+} LogGcStats;
+
+// Compacta segmentos selados anteriores ao horizonte; pode rodar com `watch` ativo
+// (nunca toca o segmento ativo nem o lock do journal)
+int log_gc(LogManager* lm, const LogGcOptions* options, LogGcStats* stats);
+
+// Baseline atual (entries == NULL quando não há baseline)
+int log_load_baseline(LogManager* lm, LogBaselineHeader* header, SnapshotRef** entries);
+
+#endif // LOG_GC_H
@@ -0,0 +1,66 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "journal.h"
+#include "operation.h"
+
+#define LOG_INDEX_VERSION 1
+#define LOG_INDEX_SEALED_EXT ".idx"    // Run ordenado de um segmento selado
+#define LOG_INDEX_PENDING_EXT ".pidx"  // Entradas do segmento ativo, na ordem de escrita
+
+// Entrada gravada incrementalmente para cada operação anexada ao journal
+typedef struct {
+    int64_t timestamp;
+    uint64_t author_key;
+    uint64_t file_key;
+    uint64_t pos;
+} LogIndexEntry;
+
+// Entrada de um run ordenado: (chave, posição)
+typedef struct {
+    uint64_t key;
+    uint64_t pos;
+} LogIndexKey;
+
+// Arquivo <segmento>.idx: cabeçalho seguido de três runs de `count` entradas,
+// ordenados por (timestamp, pos), (autor, pos) e (arquivo, pos)
+typedef struct {
+    char magic[8];            // "MYVCIDX1"
+    uint32_t version;
+    uint32_t segment_id;
+    uint64_t count;
+    int64_t min_timestamp;
+    int64_t max_timestamp;
+    uint64_t reserved[3];
+} LogIndexHeader;
+
+// Filtros de consulta (campos zerados/NULL não filtram)
+typedef struct {
+    long since;
+    long until;
+    const char* author;
+    const char* file;
+} LogQuery;
+
+typedef struct LogIndex LogIndex;
+
+// Manutenção incremental (apenas no processo que escreve no journal)
+LogIndex* log_index_open(Journal* journal);
+void log_index_close(LogIndex* index);
+int log_index_add(LogIndex* index, const Operation* const* ops, const JournalPos* positions, int count);
+
+// Consulta: retorna as posições que satisfazem os filtros, em ordem crescente
+int log_index_query(const char* journal_dir, JournalReader* reader, const LogQuery* query,
+                    JournalPos** positions, size_t* count);
+
+// Chaves
+uint64_t log_index_author_key(const char* author, size_t len);
+uint64_t log_index_file_key(const char* filepath, size_t len);
+
+#endif // LOG_INDEX_H
@@ -0,0 +1,50 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include "log.h"
+#include "operation.h"
+
+#define LOG_WRITER_QUEUE_CAPACITY 4096
+#define LOG_WRITER_DEFAULT_INTERVAL_MS 200
+#define LOG_WRITER_MAX_BATCH 1024
+
+// Política de durabilidade (quando chamar fdatasync no journal)
+typedef enum {
+    LOG_SYNC_EVERY_OP,      // Após cada escrita em grupo
+    LOG_SYNC_INTERVAL,      // No máximo a cada interval_ms
+    LOG_SYNC_RECORDS        // A cada sync_records registros escritos
+} LogSyncPolicy;
+
+typedef struct {
+    LogSyncPolicy policy;
+    int interval_ms;
+    int sync_records;
+    int queue_capacity;
+} LogWriterConfig;
+
+typedef struct {
+    unsigned long long operations;   // Operações persistidas
+    unsigned long long writes;       // Escritas em grupo no journal
+    unsigned long long syncs;        // Chamadas de fdatasync
+} LogWriterStats;
+
+typedef struct LogWriter LogWriter;
+
+// Criar e destruir (destroy drena a fila e sincroniza antes de retornar)
+void log_writer_default_config(LogWriterConfig* config);
+int log_writer_parse_policy(const char* spec, LogWriterConfig* config);
+LogWriter* log_writer_create(LogManager* lm, const LogWriterConfig* config);
+void log_writer_destroy(LogWriter* writer);
+
+// Enfileira a operação (assume a posse); bloqueia apenas quando a fila está cheia
+int log_writer_submit(LogWriter* writer, Operation* op);
+
+// Aguarda até que tudo o que foi enfileirado esteja escrito e sincronizado
+int log_writer_flush(LogWriter* writer);
+void log_writer_get_stats(LogWriter* writer, LogWriterStats* stats);
+
+#endif // LOG_WRITER_H
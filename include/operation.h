@@ -6,10 +6,15 @@
 #define OPERATION_H
 
 #include <time.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #define MAX_OP_TYPE_LEN 10
 #define MAX_AUTHOR_LEN 32
 #define MAX_TEXT_LEN 4096
+#define MAX_OP_PATH_LEN 256
+#define OPERATION_ENCODING_VERSION 4
+#define OPERATION_NS_PER_SEC 1000000000LL
 
 typedef enum {
     OP_INSERT,
@@ -18,20 +23,57 @@ typedef enum {
 } OpType;
 
 typedef struct {
-    char op_type[MAX_OP_TYPE_LEN];  // "insert", "delete", "replace"
-    int line;                        // Linha afetada
+    char op_type[MAX_OP_TYPE_LEN];  // "insert", "delete", "replace" (linhas inteiras) ou
+                                     // "ins_text", "del_text" (trecho a partir de column),
+                                     // "create" ou "blocks" (delta de blocos em base64, ver block_delta.h)
+                                     // e "remove" (remoção do arquivo)
+    int line;                        // Linha afetada (primeira, em operações de bloco)
     int column;                      // Coluna afetada
+    int line_count;                  // Linhas cobertas por insert/delete (texto unido por '\n')
     char* text;                      // Texto inserido/removido
     char author[MAX_AUTHOR_LEN];     // Autor da operação
     long timestamp;                  // Tempo UNIX
+    char filepath[MAX_OP_PATH_LEN];  // Arquivo afetado ("" se desconhecido)
+    uint64_t seq;                    // Número de sequência no journal (0 = ainda não gravada)
+    int64_t hlc;                     // Tempo híbrido lógico em nanossegundos
 } Operation;
 
+// Visão sem cópia de uma operação codificada (aponta para o buffer de origem)
+typedef struct {
+    const char* op_type;
+    size_t op_type_len;
+    const char* author;
+    size_t author_len;
+    const char* text;
+    size_t text_len;
+    const char* filepath;
+    size_t filepath_len;
+    int line;
+    int column;
+    int line_count;                  // 1 em registros antigos
+    long timestamp;
+    uint64_t seq;                    // 0 em registros antigos (derivar da posição)
+    int64_t hlc;
+} OperationView;
+
 // Funções para manipular operações
 Operation* operation_create(const char* type, int line, int column,
                            const char* text, const char* author);
+Operation* operation_create_n(const char* type, int line, int column,
+                             const char* text, size_t text_len, const char* author);
+Operation* operation_copy(const Operation* op);
+void operation_set_file(Operation* op, const char* filepath);
 void operation_destroy(Operation* op);
 char* operation_serialize(const Operation* op);
 Operation* operation_deserialize(const char* json_str);
+void* operation_encode(const Operation* op, size_t* size);
+void* operation_encode_seq(const Operation* op, uint64_t seq, size_t* size);
+Operation* operation_decode(const void* data, size_t size);
+int operation_view(const void* data, size_t size, OperationView* view);
 int operation_apply_to_file(const Operation* op, const char* filepath);
 
+// Relógio híbrido lógico (ns, monotônico por processo)
+int64_t operation_clock_now(void);
+void operation_clock_observe(int64_t remote);
+
 #endif // OPERATION_H
@@ -0,0 +1,99 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef SNAPSHOT_STORE_H
+#define SNAPSHOT_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash.h"
+#include "operation.h"
+
+#define SNAPSHOT_OBJECTS_DIR "objects"   // objects/<2 hex>/<62 hex>
+#define SNAPSHOT_REFS_FILE "refs"        // Índice caminho -> snapshots, somente anexado
+
+#define SNAPSHOT_DEFAULT_MAX_DEPTH 16    // Deltas até um objeto completo
+#define SNAPSHOT_MAX_CHAIN_LIMIT 1000    // Limite de sanidade na reconstrução
+#define SNAPSHOT_COMPRESSION_LEVEL 6
+#define SNAPSHOT_DELTA_MIN_MATCH 16      // Menor trecho copiado da base
+#define SNAPSHOT_DELTA_BLOCK 64          // Intervalo das âncoras em conteúdo sem linhas
+
+#define SNAPSHOT_OBJECT_MAGIC "MYVCOBJ1"
+#define SNAPSHOT_LEGACY_SECONDS_MAX 100000000000LL   // Abaixo disso, `timestamp` está em segundos
+
+typedef enum {
+    SNAPSHOT_OBJECT_FULL = 0,
+    SNAPSHOT_OBJECT_DELTA = 1
+} SnapshotObjectKind;
+
+typedef enum {
+    SNAPSHOT_COMPRESS_NONE = 0,
+    SNAPSHOT_COMPRESS_ZLIB = 1
+} SnapshotCompression;
+
+// Cabeçalho de cada objeto; o corpo (possivelmente comprimido) vem em seguida.
+// Objetos sem o magic são conteúdo bruto do formato anterior.
+typedef struct {
+    char magic[8];
+    uint8_t kind;                              // SnapshotObjectKind
+    uint8_t compression;                       // SnapshotCompression
+    uint16_t depth;                            // Deltas entre este objeto e um completo
+    uint32_t reserved;
+    uint64_t size;                             // Tamanho do conteúdo reconstruído
+    uint64_t body_size;                        // Tamanho do corpo descomprimido
+    unsigned char base[HASH_SHA256_SIZE];      // Objeto base (apenas deltas)
+} SnapshotObjectHeader;
+
+// Referência de um snapshot: o conteúdo do arquivo `path` no instante `timestamp`,
+// o relógio híbrido (ns) da última operação refletida no conteúdo. Referências do
+// formato anterior guardam segundos (ver snapshot_ref_hlc).
+typedef struct {
+    int64_t timestamp;
+    unsigned char digest[HASH_SHA256_SIZE];
+    char path[MAX_OP_PATH_LEN];
+} SnapshotRef;
+
+typedef struct {
+    unsigned long long objects;       // Objetos gravados
+    unsigned long long deltas;        // Dos quais armazenados como delta
+    unsigned long long bytes;         // Bytes gravados
+    unsigned long long bytes_before;  // Bytes ocupados antes (repack)
+} SnapshotStoreStats;
+
+typedef struct SnapshotStore SnapshotStore;
+
+static inline int64_t snapshot_ref_hlc(const SnapshotRef* ref) {
+    return ref->timestamp < SNAPSHOT_LEGACY_SECONDS_MAX ? ref->timestamp * OPERATION_NS_PER_SEC : ref->timestamp;
+}
+
+// Abrir/fechar o armazenamento em <versions_dir>
+SnapshotStore* snapshot_store_open(const char* versions_dir);
+void snapshot_store_close(SnapshotStore* store);
+void snapshot_store_set_max_depth(SnapshotStore* store, int max_depth);
+
+// Objetos endereçados por conteúdo (SHA-256); conteúdo repetido não ocupa espaço novo
+int snapshot_store_put_object(SnapshotStore* store, const void* data, size_t len,
+                              unsigned char digest[HASH_SHA256_SIZE]);
+char* snapshot_store_get_object(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE],
+                                size_t* len);
+int snapshot_store_has_object(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE]);
+
+// Snapshots de arquivos: grava o objeto e registra a referência (se o conteúdo mudou).
+// `hlc`: relógio híbrido da última operação refletida em `data`.
+int snapshot_store_save(SnapshotStore* store, const char* path, const void* data, size_t len,
+                        int64_t hlc, unsigned char digest[HASH_SHA256_SIZE]);
+
+// Resolução: último snapshot de `path` até o segundo `at` (0 = mais recente)
+int snapshot_store_resolve(SnapshotStore* store, const char* path, long at, SnapshotRef* ref);
+// Último snapshot de `path` que reflete operações até `hlc` (inclusive)
+int snapshot_store_resolve_hlc(SnapshotStore* store, const char* path, int64_t hlc, SnapshotRef* ref);
+// Digest a partir de um prefixo hexadecimal (mínimo 4 caracteres, deve ser único)
+int snapshot_store_resolve_digest(SnapshotStore* store, const char* hex_prefix,
+                                  unsigned char digest[HASH_SHA256_SIZE]);
+SnapshotRef* snapshot_store_list(SnapshotStore* store, const char* path, int* count);
+
+// Regrava as cadeias de deltas de cada arquivo respeitando a profundidade máxima atual
+int snapshot_store_repack(SnapshotStore* store, SnapshotStoreStats* stats);
+
+#endif // SNAPSHOT_STORE_H
@@ -25,10 +25,14 @@ char* str_duplicate(const char* str);
 char** str_split_lines(const char* text, int* line_count);
 void str_free_lines(char** lines, int line_count);
 char* str_trim(char* str);
+// Base64 (RFC 4648) para transportar conteúdo binário em campos de texto
+char* str_base64_encode(const void* data, size_t len, size_t* out_len);
+void* str_base64_decode(const char* text, size_t len, size_t* out_len);
 
 // Funções de tempo
 long time_get_unix(void);
 char* time_format(long timestamp);
+int time_parse(const char* text, long* timestamp);
 
 // Funções de memória
 void* safe_malloc(size_t size);
@@ -4,32 +4,132 @@
 #ifndef VERSIONING_H
 #define VERSIONING_H
 
+#include <stdint.h>
+#include <pthread.h>
 #include "operation.h"
+#include "line_index.h"
+#include "document.h"
+#include "diff.h"
+#include "snapshot_store.h"
+#include "worktree_index.h"
+#include "block_delta.h"
 
 #define MAX_FILEPATH_LEN 256
 #define BUFFER_SIZE 1024
+#define VERSIONING_INTRALINE_DEFAULT "*"      // Extensões com diff dentro da linha ("*" = todas)
+#define VERSIONING_INTRALINE_MIN_COMMON 50    // % mínimo da linha em comum para editar no lugar
+#define VERSIONING_DIFF_BUDGET_MS 5           // Tempo máximo do algoritmo de diff por mudança
+#define VERSIONING_LATENCY_BUCKETS 32
+#define VERSIONING_MEMORY_BUDGET_MB 256       // Baselines residentes (0 = sem limite)
+#define VERSIONING_BLOCK_MIN_SIZE (8 * 1024 * 1024)   // A partir daqui, deltas de blocos em vez de linhas
+#define VERSIONING_BINARY_SNIFF 8000          // Bytes examinados atrás de NUL (conteúdo binário)
+#define VERSIONING_BUCKET_EMPTY (-1)
+#define VERSIONING_BUCKET_REMOVED (-2)
 
-typedef struct {
+typedef struct FileState {
     char filepath[MAX_FILEPATH_LEN];
-    char* last_content;
-    size_t last_content_size;
-    time_t last_modified;
+    uint64_t path_hash;          // Hash do caminho sem "./" (chave da tabela)
+    int slot;                    // Posição em VersioningManager.files
+    Document content;            // Baseline como piece table (recebe operações remotas)
+    LineIndex lines;             // Linhas do baseline, com hashes (reaproveitadas a cada diff)
+    WorktreeStat stat;           // Do arquivo quando o baseline foi lido ou gravado
+    int blocks;                  // Binário ou grande: o baseline é só `signature` (sem content/lines)
+    BlockSignature signature;
+
+    // Cache de baselines (campos abaixo protegidos por cache_mutex)
+    int resident;                // content e lines (ou signature) em memória
+    int pins;                    // Usos em andamento; baseline fixado não é despejado
+    int busy;                    // Sendo despejado ou recarregado
+    int baseline_empty;          // Document.empty do baseline despejado
+    size_t baseline_size;        // Tamanho do baseline despejado
+    unsigned char baseline_digest[HASH_SHA256_SIZE];   // Objeto do baseline despejado
+    size_t resident_bytes;
+    struct FileState* lru_prev;  // Lista dos residentes, do mais recente ao mais antigo
+    struct FileState* lru_next;
 } FileState;
 
+// Contadores dos diffs: algoritmo escolhido, motivo e latência
+typedef struct {
+    unsigned long long diffs;
+    unsigned long long engines[DIFF_ENGINE_COUNT];
+    unsigned long long reasons[DIFF_REASON_COUNT];
+    unsigned long long budget_exhausted;
+    unsigned long long latency[VERSIONING_LATENCY_BUCKETS];   // latency[i]: diffs com menos de 2^i µs
+    long long max_ns;
+} VersioningDiffStats;
+
+typedef struct {
+    unsigned long long evictions;
+    unsigned long long reloads;
+    unsigned long long reload_failures;   // Objeto ausente; baseline refeito do disco
+    size_t resident_bytes;
+    size_t peak_bytes;
+    int resident_files;
+    int lazy_files;                       // Registrados pelo índice, sem leitura
+} VersioningCacheStats;
+
+// Arquivos num vetor denso (iteração sequencial; remoção troca com o último) e uma
+// tabela hash de endereçamento aberto do caminho para a posição no vetor. Os
+// FileState não mudam de endereço enquanto monitorados. `lock` protege apenas o
+// vetor e a tabela; o estado de cada arquivo pertence a quem processa aquele
+// arquivo (um worker por vez, ver diff_pool.h). Com orçamento de memória, os
+// baselines menos usados recentemente são despejados para o snapshot store e
+// recarregados no próximo diff do arquivo.
 typedef struct {
     FileState** files;
     int file_count;
     int capacity;
+    int* buckets;                // Índice em files, VERSIONING_BUCKET_EMPTY ou _REMOVED
+    int bucket_count;            // Potência de 2
+    int bucket_used;             // Ocupados + removidos (controla o rehash)
+    pthread_rwlock_t lock;
+    long long diff_budget_ns;    // 0 = sem limite
+    pthread_mutex_t stats_mutex;
+    VersioningDiffStats stats;
+    SnapshotStore* baseline_store;  // Destino dos baselines despejados (NULL = sem despejo)
+    size_t memory_budget;        // Bytes de baselines residentes (0 = sem limite)
+    pthread_mutex_t cache_mutex;
+    pthread_cond_t cache_cond;   // Sinalizado ao fim de cada despejo/recarga
+    FileState* lru_head;
+    FileState* lru_tail;
+    VersioningCacheStats cache;
+    WorktreeIndex* worktree;     // Stat e baseline de cada arquivo entre execuções (opcional)
+    char intraline[256];         // "*", "none" ou extensões separadas por vírgula
 } VersioningManager;
 
 // Funções do gerenciador de versões
 VersioningManager* versioning_create(void);
 void versioning_destroy(VersioningManager* vm);
-int versioning_add_file(VersioningManager* vm, const char* filepath);
+int versioning_add_file(VersioningManager* vm, const char* filepath);   // 1 se já era monitorado
+// Como versioning_add_file, devolvendo o conteúdo lido (liberar com safe_free; NULL se retornar 1)
+int versioning_add_file_content(VersioningManager* vm, const char* filepath, char** content, size_t* size);
 int versioning_remove_file(VersioningManager* vm, const char* filepath);
-Operation** versioning_detect_changes(VersioningManager* vm, const char* filepath, int* op_count);
+void versioning_set_intraline(VersioningManager* vm, const char* extensions);
+void versioning_set_diff_budget(VersioningManager* vm, int budget_ms);
+void versioning_get_stats(VersioningManager* vm, VersioningDiffStats* stats);
+long long versioning_stats_percentile(const VersioningDiffStats* stats, double percentile);
+// Baselines menos usados recentemente vão para `store` quando os residentes passam de `budget_bytes`
+void versioning_set_memory_budget(VersioningManager* vm, SnapshotStore* store, size_t budget_bytes);
+void versioning_get_cache_stats(VersioningManager* vm, VersioningCacheStats* stats);
+// Índice da árvore de trabalho (requer o snapshot store de versioning_set_memory_budget):
+// arquivos com o stat igual ao do índice são registrados sem leitura. Associar antes
+// de adicionar os arquivos; o flush grava os baselines residentes, com os workers parados.
+void versioning_set_worktree_index(VersioningManager* vm, WorktreeIndex* index);
+int versioning_flush_worktree_index(VersioningManager* vm);
+// Com `content` não nulo e mudanças detectadas, devolve também o conteúdo lido (liberar com safe_free)
+Operation** versioning_detect_changes(VersioningManager* vm, const char* filepath, int* op_count,
+                                      char** content, size_t* size);
 int versioning_apply_patch(const char* filepath, Operation** ops, int op_count);
+// Operações de um arquivo em lote, com uma gravação por lote. "create"/"blocks" criam o
+// arquivo se ele não existe; "remove" apaga o arquivo e deixa de monitorá-lo.
+int versioning_apply_operations(VersioningManager* vm, const char* filepath,
+                                const Operation* const* ops, int op_count);
 char* versioning_get_file_content(const char* filepath, size_t* size);
 int versioning_diff_lines(const char* old_content, const char* new_content, Operation*** ops);
+// Binário (NUL no início) ou com pelo menos VERSIONING_BLOCK_MIN_SIZE bytes: diff por blocos
+int versioning_is_block_content(const char* content, size_t size);
+// Operação que cria o arquivo: "create" para texto, "blocks" (sobre o conteúdo vazio) para o resto
+Operation* versioning_create_operation(const char* filepath, const char* content, size_t size,
+                                       const char* author);
 
 #endif // VERSIONING_H
@@ -24,7 +24,9 @@ typedef struct {
     int port;
     WebSocketState state;
     char send_buffer[WS_BUFFER_SIZE];
-    char recv_buffer[WS_BUFFER_SIZE];
+    char* recv_buffer;           // Mensagem em montagem (operações em bloco chegam fragmentadas)
+    size_t recv_len;
+    size_t recv_capacity;
     Operation** pending_ops;
     int pending_count;
 } WebSocketClient;
@@ -0,0 +1,79 @@
+//
+// Created by HP on 16/10/2026.
+//
+
+#ifndef WORKTREE_INDEX_H
+#define WORKTREE_INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "hash.h"
+
+#define WORKTREE_INDEX_FILE "worktree"  // Em .myvc ("index" é o índice JSON do repositório)
+#define WORKTREE_INDEX_MAGIC "MYVCWTI1"   // Distinto do LOG_INDEX_MAGIC dos .idx do journal
+#define WORKTREE_INDEX_VERSION 1
+#define WORKTREE_PATH_LEN 256
+#define WORKTREE_INDEX_SEED 0x776f726b74726565ULL   // "worktree"
+
+#define WORKTREE_ENTRY_VALID 0x1
+#define WORKTREE_ENTRY_EMPTY 0x2        // Conteúdo sem nenhuma linha (Document.empty)
+#define WORKTREE_ENTRY_BLOCKS 0x4       // digest é a assinatura de blocos, não o conteúdo
+
+// Dados do stat que identificam uma versão do arquivo
+typedef struct {
+    uint64_t inode;
+    uint64_t size;
+    int64_t mtime_ns;
+} WorktreeStat;
+
+// Registro de tamanho fixo: o conteúdo `digest` (objeto do snapshot store) é o do
+// arquivo enquanto o stat for `stat`. `check` detecta registros rasgados por uma
+// queda no meio da gravação.
+typedef struct {
+    char path[WORKTREE_PATH_LEN];            // Sem "./"
+    WorktreeStat stat;
+    uint32_t flags;                          // WORKTREE_ENTRY_*
+    uint32_t reserved;
+    unsigned char digest[HASH_SHA256_SIZE];
+    uint64_t check;
+} WorktreeEntry;
+
+// Cabeçalho seguido de `count` registros. Removidos ficam sem WORKTREE_ENTRY_VALID
+// e são descartados quando o índice é regravado.
+typedef struct {
+    char magic[8];                           // "MYVCWTI1"
+    uint32_t version;
+    uint32_t entry_size;                     // sizeof(WorktreeEntry)
+    uint64_t count;
+    uint64_t reserved[2];
+} WorktreeIndexHeader;
+
+typedef struct {
+    unsigned long long entries;              // Registros válidos
+    unsigned long long removed;              // Registros removidos ainda no arquivo
+    unsigned long long writes;               // Registros gravados nesta execução
+} WorktreeIndexStats;
+
+typedef struct WorktreeIndex WorktreeIndex;
+
+// O arquivo é mapeado (mmap) na abertura; consultas leem os registros direto do
+// mapeamento. Cada atualização grava só o próprio registro (pwrite no lugar ou no
+// fim do arquivo). Seguro para várias threads.
+WorktreeIndex* worktree_index_open(const char* path);
+void worktree_index_close(WorktreeIndex* index);   // Regrava compactado se houver muitos removidos
+
+int worktree_index_lookup(WorktreeIndex* index, const char* path, WorktreeEntry* entry);
+int worktree_index_update(WorktreeIndex* index, const char* path, const WorktreeStat* stat,
+                          const unsigned char digest[HASH_SHA256_SIZE], uint32_t flags);
+int worktree_index_remove(WorktreeIndex* index, const char* path);
+void worktree_index_get_stats(WorktreeIndex* index, WorktreeIndexStats* stats);
+
+// stat() reduzido aos campos do índice
+int worktree_stat(const char* path, WorktreeStat* stat);
+
+static inline int worktree_stat_equal(const WorktreeStat* a, const WorktreeStat* b) {
+    return a->inode == b->inode && a->size == b->size && a->mtime_ns == b->mtime_ns;
+}
+
+#endif // WORKTREE_INDEX_H
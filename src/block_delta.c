@@ -0,0 +1,359 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "block_delta.h"
+#include "hash.h"
+#include "utils.h"
+
+#define BLOCK_COPY 'C'
+#define BLOCK_INSERT 'I'
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void buffer_append(Buffer* buf, const void* data, size_t len) {
+    if (buf->size + len > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        while (capacity < buf->size + len) capacity *= 2;
+        buf->data = (unsigned char*)safe_realloc(buf->data, capacity);
+        buf->capacity = capacity;
+    }
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+}
+
+static void buffer_put_varint(Buffer* buf, uint64_t value) {
+    unsigned char bytes[10];
+    int n = 0;
+    do {
+        bytes[n] = (unsigned char)(value & 0x7F);
+        value >>= 7;
+        if (value) bytes[n] |= 0x80;
+        n++;
+    } while (value);
+    buffer_append(buf, bytes, n);
+}
+
+static int read_varint(const unsigned char** p, const unsigned char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return -1;
+        unsigned char byte = *(*p)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int read_u64(const unsigned char** p, const unsigned char* end, uint64_t* value) {
+    if (end - *p < 8) return -1;
+    memcpy(value, *p, 8);
+    *p += 8;
+    return 0;
+}
+
+// Soma fraca do rsync: a = soma dos bytes, b = soma ponderada (mod 2^16)
+static uint32_t weak_sum(const unsigned char* data, size_t len, uint32_t* a_out, uint32_t* b_out) {
+    uint32_t a = 0, b = 0;
+    for (size_t i = 0; i < len; i++) {
+        a += data[i];
+        b += (uint32_t)(len - i) * data[i];
+    }
+    *a_out = a & 0xFFFF;
+    *b_out = b & 0xFFFF;
+    return *a_out | (*b_out << 16);
+}
+
+uint32_t block_delta_block_size(size_t size) {
+    uint64_t root = 1;
+    while (root * root < size) root++;
+    root = (root + 63) & ~(uint64_t)63;
+    if (root < BLOCK_DELTA_MIN_BLOCK) root = BLOCK_DELTA_MIN_BLOCK;
+    if (root > BLOCK_DELTA_MAX_BLOCK) root = BLOCK_DELTA_MAX_BLOCK;
+    return (uint32_t)root;
+}
+
+static void build_table(BlockSignature* sig) {
+    uint32_t buckets = 16;
+    while (buckets < sig->block_count * 2) buckets <<= 1;
+
+    sig->bucket_mask = buckets - 1;
+    sig->buckets = (int*)safe_malloc(buckets * sizeof(int));
+    sig->chain = (int*)safe_malloc((sig->block_count + 1) * sizeof(int));
+    for (uint32_t i = 0; i < buckets; i++) sig->buckets[i] = -1;
+
+    // Inserção do último para o primeiro: a cadeia fica em ordem crescente de bloco
+    for (int i = (int)sig->block_count - 1; i >= 0; i--) {
+        uint32_t b = (sig->blocks[i].weak * 2654435761u) & sig->bucket_mask;
+        sig->chain[i] = sig->buckets[b];
+        sig->buckets[b] = i;
+    }
+}
+
+void block_signature_build(BlockSignature* sig, const void* data, size_t len) {
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    memset(sig, 0, sizeof(*sig));
+    sig->block_size = block_delta_block_size(len);
+    sig->size = len;
+    sig->content_hash = hash_bytes64(data, len, BLOCK_DELTA_SEED);
+    sig->block_count = (uint32_t)((len + sig->block_size - 1) / sig->block_size);
+    sig->blocks = (BlockSum*)safe_malloc(((size_t)sig->block_count + 1) * sizeof(BlockSum));
+
+    for (uint32_t i = 0; i < sig->block_count; i++) {
+        size_t offset = (size_t)i * sig->block_size;
+        size_t block_len = len - offset < sig->block_size ? len - offset : sig->block_size;
+        uint32_t a, b;
+        sig->blocks[i].weak = weak_sum(bytes + offset, block_len, &a, &b);
+        sig->blocks[i].strong = hash_bytes64(bytes + offset, block_len, BLOCK_DELTA_SEED);
+    }
+    build_table(sig);
+}
+
+void block_signature_free(BlockSignature* sig) {
+    if (!sig) return;
+    safe_free(sig->blocks);
+    safe_free(sig->buckets);
+    safe_free(sig->chain);
+    memset(sig, 0, sizeof(*sig));
+}
+
+size_t block_signature_memory(const BlockSignature* sig) {
+    return (size_t)sig->block_count * (sizeof(BlockSum) + sizeof(int)) +
+           ((size_t)sig->bucket_mask + 1) * sizeof(int);
+}
+
+// [magic][u32 block_size][u32 block_count][u64 size][u64 content_hash] e as somas
+void* block_signature_encode(const BlockSignature* sig, size_t* len) {
+    Buffer out = {0};
+    buffer_append(&out, BLOCK_SIGNATURE_MAGIC, 8);
+    buffer_append(&out, &sig->block_size, 4);
+    buffer_append(&out, &sig->block_count, 4);
+    buffer_append(&out, &sig->size, 8);
+    buffer_append(&out, &sig->content_hash, 8);
+    for (uint32_t i = 0; i < sig->block_count; i++) {
+        buffer_append(&out, &sig->blocks[i].weak, 4);
+        buffer_append(&out, &sig->blocks[i].strong, 8);
+    }
+    *len = out.size;
+    return out.data;
+}
+
+int block_signature_decode(BlockSignature* sig, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+
+    memset(sig, 0, sizeof(*sig));
+    if (len < 32 || memcmp(p, BLOCK_SIGNATURE_MAGIC, 8) != 0) return -1;
+    memcpy(&sig->block_size, p + 8, 4);
+    memcpy(&sig->block_count, p + 12, 4);
+    memcpy(&sig->size, p + 16, 8);
+    memcpy(&sig->content_hash, p + 24, 8);
+
+    if (sig->block_size == 0 || len != 32 + (size_t)sig->block_count * 12 ||
+        sig->block_count != (sig->size + sig->block_size - 1) / sig->block_size) {
+        memset(sig, 0, sizeof(*sig));
+        return -1;
+    }
+
+    sig->blocks = (BlockSum*)safe_malloc(((size_t)sig->block_count + 1) * sizeof(BlockSum));
+    for (uint32_t i = 0; i < sig->block_count; i++) {
+        memcpy(&sig->blocks[i].weak, p + 32 + (size_t)i * 12, 4);
+        memcpy(&sig->blocks[i].strong, p + 36 + (size_t)i * 12, 8);
+    }
+    build_table(sig);
+    return 0;
+}
+
+static size_t block_length(const BlockSignature* sig, uint32_t block) {
+    size_t offset = (size_t)block * sig->block_size;
+    return sig->size - offset < sig->block_size ? (size_t)(sig->size - offset) : sig->block_size;
+}
+
+// Bloco do conteúdo antigo igual à janela (ou -1); a soma forte só é calculada se a fraca bater
+static int find_block(const BlockSignature* sig, uint32_t weak, const unsigned char* window, size_t len,
+                      int preferred) {
+    uint64_t strong = 0;
+    int have_strong = 0;
+    int found = -1;
+
+    for (int i = sig->buckets[(weak * 2654435761u) & sig->bucket_mask]; i >= 0; i = sig->chain[i]) {
+        if (sig->blocks[i].weak != weak || block_length(sig, (uint32_t)i) != len) continue;
+        if (!have_strong) {
+            strong = hash_bytes64(window, len, BLOCK_DELTA_SEED);
+            have_strong = 1;
+        }
+        if (sig->blocks[i].strong != strong) continue;
+
+        // Preferir o bloco seguinte ao último copiado (estende a cópia anterior)
+        if (i == preferred) return i;
+        if (found < 0) found = i;
+    }
+    return found;
+}
+
+typedef struct {
+    Buffer out;
+    int64_t copy_first;           // Cópia pendente (-1 = nenhuma)
+    uint64_t copy_count;
+} DeltaWriter;
+
+static void flush_copy(DeltaWriter* w) {
+    if (w->copy_first < 0) return;
+    unsigned char cmd = BLOCK_COPY;
+    buffer_append(&w->out, &cmd, 1);
+    buffer_put_varint(&w->out, (uint64_t)w->copy_first);
+    buffer_put_varint(&w->out, w->copy_count);
+    w->copy_first = -1;
+    w->copy_count = 0;
+}
+
+static void emit_copy(DeltaWriter* w, uint32_t block) {
+    if (w->copy_first >= 0 && (uint64_t)w->copy_first + w->copy_count == block) {
+        w->copy_count++;
+        return;
+    }
+    flush_copy(w);
+    w->copy_first = block;
+    w->copy_count = 1;
+}
+
+static void emit_insert(DeltaWriter* w, const unsigned char* data, size_t len) {
+    if (len == 0) return;
+    flush_copy(w);
+    unsigned char cmd = BLOCK_INSERT;
+    buffer_append(&w->out, &cmd, 1);
+    buffer_put_varint(&w->out, len);
+    buffer_append(&w->out, data, len);
+}
+
+unsigned char* block_delta_encode(const BlockSignature* sig, const void* data, size_t len,
+                                  size_t* delta_len, size_t* copied) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t bs = sig->block_size;
+    size_t matched = 0;
+
+    DeltaWriter w;
+    memset(&w, 0, sizeof(w));
+    w.copy_first = -1;
+
+    uint64_t new_hash = hash_bytes64(data, len, BLOCK_DELTA_SEED);
+    buffer_put_varint(&w.out, bs);
+    buffer_put_varint(&w.out, sig->size);
+    buffer_append(&w.out, &sig->content_hash, 8);
+    buffer_put_varint(&w.out, len);
+    buffer_append(&w.out, &new_hash, 8);
+
+    size_t literal = 0;           // Início dos bytes ainda não emitidos
+    size_t pos = 0;
+    int have_sum = 0;
+    uint32_t a = 0, b = 0;
+
+    while (sig->block_count > 0 && pos + bs <= len) {
+        if (!have_sum) {
+            weak_sum(bytes + pos, bs, &a, &b);
+            have_sum = 1;
+        }
+
+        int preferred = w.copy_first >= 0 && literal == pos ? (int)(w.copy_first + w.copy_count) : -1;
+        int block = find_block(sig, a | (b << 16), bytes + pos, bs, preferred);
+        if (block >= 0) {
+            emit_insert(&w, bytes + literal, pos - literal);
+            emit_copy(&w, (uint32_t)block);
+            matched += bs;
+            pos += bs;
+            literal = pos;
+            have_sum = 0;
+            continue;
+        }
+
+        // Rola a janela um byte: sai bytes[pos], entra bytes[pos + bs]
+        if (pos + bs < len) {
+            uint32_t out = bytes[pos], in = bytes[pos + bs];
+            a = (a - out + in) & 0xFFFF;
+            b = (b - (uint32_t)(bs * out) + a) & 0xFFFF;
+        }
+        pos++;
+    }
+
+    // Último bloco do conteúdo antigo (menor que bs) no fim do novo
+    size_t tail = sig->block_count > 0 ? block_length(sig, sig->block_count - 1) : 0;
+    size_t tail_end = len;
+    if (tail > 0 && tail < bs && len - literal >= tail) {
+        uint32_t ta, tb;
+        uint32_t weak = weak_sum(bytes + len - tail, tail, &ta, &tb);
+        int block = find_block(sig, weak, bytes + len - tail, tail, -1);
+        if (block >= 0) tail_end = len - tail;
+    }
+
+    emit_insert(&w, bytes + literal, tail_end - literal);
+    if (tail_end < len) {
+        emit_copy(&w, sig->block_count - 1);
+        matched += tail;
+    }
+    flush_copy(&w);
+
+    if (copied) *copied = matched;
+    *delta_len = w.out.size;
+    return w.out.data;
+}
+
+char* block_delta_apply(const void* old_data, size_t old_len, const void* delta, size_t delta_len,
+                        size_t* new_len) {
+    const unsigned char* p = (const unsigned char*)delta;
+    const unsigned char* end = p + delta_len;
+    const unsigned char* old = (const unsigned char*)old_data;
+
+    uint64_t bs, old_size, old_hash, size, hash;
+    if (read_varint(&p, end, &bs) != 0 || read_varint(&p, end, &old_size) != 0 ||
+        read_u64(&p, end, &old_hash) != 0 || read_varint(&p, end, &size) != 0 ||
+        read_u64(&p, end, &hash) != 0 || bs == 0 || size > ((uint64_t)1 << 40)) {
+        log_message(LOG_ERROR, "Malformed block delta");
+        return NULL;
+    }
+
+    // O delta foi gerado contra outro conteúdo
+    if (old_size != old_len || hash_bytes64(old_data, old_len, BLOCK_DELTA_SEED) != old_hash) {
+        log_message(LOG_ERROR, "Block delta does not match the current content");
+        return NULL;
+    }
+
+    char* out = (char*)safe_malloc((size_t)size + 1);
+    size_t o = 0;
+
+    while (p < end) {
+        unsigned char cmd = *p++;
+        uint64_t first, count;
+        if (cmd == BLOCK_COPY && read_varint(&p, end, &first) == 0 && read_varint(&p, end, &count) == 0 &&
+            first * bs < old_len && count <= old_len / bs + 1) {
+            size_t offset = (size_t)(first * bs);
+            size_t len = (size_t)(count * bs);
+            if (len > old_len - offset) len = old_len - offset;
+            if (len > size - o) break;
+            memcpy(out + o, old + offset, len);
+            o += len;
+        } else if (cmd == BLOCK_INSERT && read_varint(&p, end, &count) == 0 &&
+                   count <= (uint64_t)(end - p) && count <= size - o) {
+            memcpy(out + o, p, (size_t)count);
+            p += count;
+            o += (size_t)count;
+        } else {
+            break;
+        }
+    }
+
+    if (p != end || o != size || hash_bytes64(out, o, BLOCK_DELTA_SEED) != hash) {
+        log_message(LOG_ERROR, "Corrupted block delta");
+        safe_free(out);
+        return NULL;
+    }
+
+    out[o] = '\0';
+    if (new_len) *new_len = o;
+    return out;
+}
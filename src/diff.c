@@ -0,0 +1,559 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "diff.h"
+#include "utils.h"
+#include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Vetores V do Myers (avanço e retorno), indexados pela diagonal k = x - y.
+// Crescem com o número de edições, não com o tamanho dos arquivos.
+typedef struct {
+    const LineView* a;
+    const LineView* b;
+    int* forward;
+    int* backward;
+    int dcap;                  // Diagonais cobertas: [-dcap - 1, dcap + 1]
+    DiffScript* script;
+    long long deadline_ns;     // 0 = sem orçamento
+    int exhausted;             // Orçamento esgotado: regiões restantes viram um trecho só
+} MyersContext;
+
+typedef struct {
+    int x_start, y_start;      // Início da diagonal de linhas iguais
+    int x_end, y_end;          // Fim (exclusivo)
+} MiddleSnake;
+
+size_t diff_common_prefix(const char* a, const char* b, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffffu;
+        if (mask) return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, 8);
+        memcpy(&wb, b + i, 8);
+        if (wa != wb) break;
+    }
+    while (i < len && a[i] == b[i]) i++;
+    return i;
+}
+
+size_t diff_common_suffix(const char* a_end, const char* b_end, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a_end - i - 16));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b_end - i - 16));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) ^ 0xffffu;
+        if (mask) return i + (size_t)__builtin_clz(mask << 16);
+    }
+#endif
+
+    for (; i + 8 <= len; i += 8) {
+        uint64_t wa, wb;
+        memcpy(&wa, a_end - i - 8, 8);
+        memcpy(&wb, b_end - i - 8, 8);
+        if (wa != wb) break;
+    }
+    while (i < len && a_end[-(ptrdiff_t)i - 1] == b_end[-(ptrdiff_t)i - 1]) i++;
+    return i;
+}
+
+void diff_trim_common(const char* a, size_t a_len, const char* b, size_t b_len, DiffTrim* trim) {
+    size_t shortest = a_len < b_len ? a_len : b_len;
+
+    // Prefixo: recuar até depois do último '\n' comum
+    size_t prefix = diff_common_prefix(a, b, shortest);
+    if (!(prefix == a_len && prefix == b_len)) {
+        while (prefix > 0 && a[prefix - 1] != '\n') prefix--;
+    }
+
+    // Sufixo: sem sobrepor o prefixo, e começando no início de uma linha dos dois lados
+    size_t suffix = diff_common_suffix(a + a_len, b + b_len, shortest - prefix);
+    while (suffix > 0) {
+        size_t a_start = a_len - suffix, b_start = b_len - suffix;
+        if ((a_start == prefix || a[a_start - 1] == '\n') &&
+            (b_start == prefix || b[b_start - 1] == '\n')) {
+            break;
+        }
+        const char* newline = memchr(a + a_start, '\n', suffix);
+        suffix = newline ? (size_t)(a + a_len - (newline + 1)) : 0;
+    }
+
+    trim->prefix = prefix;
+    trim->suffix = suffix;
+    trim->prefix_lines = line_index_count_newlines(a, prefix);
+}
+
+static long long monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int budget_exhausted(MyersContext* ctx) {
+    if (!ctx->exhausted && ctx->deadline_ns && monotonic_ns() >= ctx->deadline_ns) {
+        ctx->exhausted = 1;
+    }
+    return ctx->exhausted;
+}
+
+// Acrescenta um trecho, unindo-o ao anterior quando são adjacentes
+static void script_add(DiffScript* script, int old_start, int old_count, int new_start, int new_count) {
+    if (old_count == 0 && new_count == 0) return;
+
+    if (script->count > 0) {
+        DiffHunk* last = &script->hunks[script->count - 1];
+        if (last->old_start + last->old_count == old_start &&
+            last->new_start + last->new_count == new_start) {
+            last->old_count += old_count;
+            last->new_count += new_count;
+            return;
+        }
+    }
+
+    if (script->count >= script->capacity) {
+        script->capacity = script->capacity ? script->capacity * 2 : 16;
+        script->hunks = (DiffHunk*)safe_realloc(script->hunks, script->capacity * sizeof(DiffHunk));
+    }
+
+    DiffHunk* hunk = &script->hunks[script->count++];
+    hunk->old_start = old_start;
+    hunk->old_count = old_count;
+    hunk->new_start = new_start;
+    hunk->new_count = new_count;
+}
+
+static int* grow_vector(int* vector, int old_cap, int new_cap) {
+    int* grown = (int*)safe_malloc((size_t)(2 * new_cap + 3) * sizeof(int));
+    if (vector) {
+        memcpy(grown + (new_cap - old_cap), vector, (size_t)(2 * old_cap + 3) * sizeof(int));
+        safe_free(vector);
+    }
+    return grown;
+}
+
+static void ensure_dcap(MyersContext* ctx, int d) {
+    if (d <= ctx->dcap) return;
+
+    int new_cap = ctx->dcap ? ctx->dcap : DIFF_INITIAL_DCAP;
+    while (new_cap < d) new_cap *= 2;
+
+    ctx->forward = grow_vector(ctx->forward, ctx->dcap, new_cap);
+    ctx->backward = grow_vector(ctx->backward, ctx->dcap, new_cap);
+    ctx->dcap = new_cap;
+}
+
+// Busca simultânea a partir das duas pontas até os caminhos se sobreporem; a diagonal
+// de sobreposição divide o problema em duas metades com metade das edições cada
+static void find_middle_snake(MyersContext* ctx, int a0, int a1, int b0, int b1, MiddleSnake* snake) {
+    const LineView* a = ctx->a;
+    const LineView* b = ctx->b;
+    int n = a1 - a0, m = b1 - b0;
+    int delta = n - m;
+    int odd = delta & 1;
+    int max_d = (n + m + 1) / 2;
+
+    ensure_dcap(ctx, 1);
+    int* vf = ctx->forward + ctx->dcap + 1;
+    int* vb = ctx->backward + ctx->dcap + 1;
+    vf[1] = 0;
+    vb[-1] = n;     // Retorno indexado por k - delta
+
+    for (int d = 0; d <= max_d; d++) {
+        // Orçamento conferido a cada 8 passos de d (cada um cobre d diagonais)
+        if ((d & 7) == 7 && budget_exhausted(ctx)) return;
+
+        if (d + 1 > ctx->dcap) {
+            ensure_dcap(ctx, d + 1);
+            vf = ctx->forward + ctx->dcap + 1;
+            vb = ctx->backward + ctx->dcap + 1;
+        }
+
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && vf[k - 1] < vf[k + 1])) ? vf[k + 1] : vf[k - 1] + 1;
+            int y = x - k;
+            int x0 = x, y0 = y;
+            while (x < n && y < m && line_view_equal(&a[a0 + x], &b[b0 + y])) {
+                x++;
+                y++;
+            }
+            vf[k] = x;
+
+            int kb = k - delta;
+            if (odd && kb >= -(d - 1) && kb <= d - 1 && vb[kb] <= x) {
+                snake->x_start = a0 + x0;
+                snake->y_start = b0 + y0;
+                snake->x_end = a0 + x;
+                snake->y_end = b0 + y;
+                return;
+            }
+        }
+
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == d || (k != -d && vb[k - 1] < vb[k + 1])) ? vb[k - 1] : vb[k + 1] - 1;
+            int kf = k + delta;
+            int y = x - kf;
+            int x1 = x, y1 = y;
+            while (x > 0 && y > 0 && line_view_equal(&a[a0 + x - 1], &b[b0 + y - 1])) {
+                x--;
+                y--;
+            }
+            vb[k] = x;
+
+            if (!odd && kf >= -d && kf <= d && x <= vf[kf]) {
+                snake->x_start = a0 + x;
+                snake->y_start = b0 + y;
+                snake->x_end = a0 + x1;
+                snake->y_end = b0 + y1;
+                return;
+            }
+        }
+    }
+
+    // Inalcançável: os caminhos sempre se encontram até max_d
+    snake->x_start = snake->x_end = a0;
+    snake->y_start = snake->y_end = b1;
+}
+
+static void myers_compare(MyersContext* ctx, int a0, int a1, int b0, int b1) {
+    const LineView* a = ctx->a;
+    const LineView* b = ctx->b;
+
+    for (;;) {
+        // Prefixo e sufixo comuns não participam da busca
+        while (a0 < a1 && b0 < b1 && line_view_equal(&a[a0], &b[b0])) {
+            a0++;
+            b0++;
+        }
+        while (a0 < a1 && b0 < b1 && line_view_equal(&a[a1 - 1], &b[b1 - 1])) {
+            a1--;
+            b1--;
+        }
+
+        if (a0 == a1 || b0 == b1) {
+            script_add(ctx->script, a0, a1 - a0, b0, b1 - b0);
+            return;
+        }
+
+        MiddleSnake snake;
+        if (!ctx->exhausted) {
+            find_middle_snake(ctx, a0, a1, b0, b1, &snake);
+        }
+
+        // Sem orçamento: a região inteira vira uma substituição (correta, não mínima)
+        if (ctx->exhausted) {
+            script_add(ctx->script, a0, a1 - a0, b0, b1 - b0);
+            return;
+        }
+
+        // Primeira metade por recursão, segunda no próprio laço (trechos saem em ordem)
+        myers_compare(ctx, a0, snake.x_start, b0, snake.y_start);
+        a0 = snake.x_end;
+        b0 = snake.y_end;
+    }
+}
+
+// Patience: linhas que aparecem exatamente uma vez em cada lado da região
+typedef struct {
+    int line;                  // Linha representante (old ou new)
+    int old_count;
+    int new_count;
+    int old_index;
+    int new_index;
+} UniqueSlot;
+
+typedef struct {
+    int old_index;
+    int new_index;
+} PatienceAnchor;
+
+// Âncoras: maior subsequência crescente (em old) das linhas únicas, na ordem de new.
+// Retorna o número de âncoras; *anchors é alocado pela função.
+static int patience_find_anchors(const LineView* a, int a0, int a1, const LineView* b, int b0, int b1,
+                                 PatienceAnchor** anchors) {
+    int size = 16;
+    while (size < ((a1 - a0) + (b1 - b0)) * 2) size <<= 1;
+    int mask = size - 1;
+
+    UniqueSlot* slots = (UniqueSlot*)safe_malloc((size_t)size * sizeof(UniqueSlot));
+    for (int i = 0; i < size; i++) slots[i].line = -1;
+
+    // Tabela aberta com sondagem linear; linhas de new ficam com índice deslocado
+    for (int i = a0; i < a1; i++) {
+        int h = (int)(a[i].hash & (uint64_t)mask);
+        while (slots[h].line >= 0 && !line_view_equal(&a[slots[h].line], &a[i])) h = (h + 1) & mask;
+        if (slots[h].line < 0) {
+            slots[h].line = i;
+            slots[h].old_count = 0;
+            slots[h].new_count = 0;
+        }
+        slots[h].old_count++;
+        slots[h].old_index = i;
+    }
+    for (int j = b0; j < b1; j++) {
+        int h = (int)(b[j].hash & (uint64_t)mask);
+        while (slots[h].line >= 0 && !line_view_equal(&a[slots[h].line], &b[j])) h = (h + 1) & mask;
+        if (slots[h].line < 0) continue;   // Apenas linhas presentes em old interessam
+        slots[h].new_count++;
+        slots[h].new_index = j;
+    }
+
+    // Pares únicos na ordem de new
+    int pair_count = 0;
+    PatienceAnchor* pairs = (PatienceAnchor*)safe_malloc((size_t)((b1 - b0) ? (b1 - b0) : 1) * sizeof(PatienceAnchor));
+    for (int j = b0; j < b1; j++) {
+        int h = (int)(b[j].hash & (uint64_t)mask);
+        while (slots[h].line >= 0 && !line_view_equal(&a[slots[h].line], &b[j])) h = (h + 1) & mask;
+        if (slots[h].line >= 0 && slots[h].old_count == 1 && slots[h].new_count == 1) {
+            pairs[pair_count].old_index = slots[h].old_index;
+            pairs[pair_count].new_index = j;
+            pair_count++;
+        }
+    }
+    safe_free(slots);
+
+    if (pair_count == 0) {
+        safe_free(pairs);
+        *anchors = NULL;
+        return 0;
+    }
+
+    // Paciência: topo de cada pilha e predecessor de cada carta, busca binária por pilha
+    int* tops = (int*)safe_malloc((size_t)pair_count * sizeof(int));
+    int* previous = (int*)safe_malloc((size_t)pair_count * sizeof(int));
+    int piles = 0;
+    for (int p = 0; p < pair_count; p++) {
+        int lo = 0, hi = piles;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (pairs[tops[mid]].old_index < pairs[p].old_index) lo = mid + 1;
+            else hi = mid;
+        }
+        previous[p] = lo > 0 ? tops[lo - 1] : -1;
+        tops[lo] = p;
+        if (lo == piles) piles++;
+    }
+
+    PatienceAnchor* result = (PatienceAnchor*)safe_malloc((size_t)piles * sizeof(PatienceAnchor));
+    for (int p = tops[piles - 1], k = piles - 1; p >= 0; p = previous[p], k--) {
+        result[k] = pairs[p];
+    }
+
+    safe_free(tops);
+    safe_free(previous);
+    safe_free(pairs);
+    *anchors = result;
+    return piles;
+}
+
+static void patience_compare(MyersContext* ctx, int a0, int a1, int b0, int b1) {
+    const LineView* a = ctx->a;
+    const LineView* b = ctx->b;
+
+    while (a0 < a1 && b0 < b1 && line_view_equal(&a[a0], &b[b0])) {
+        a0++;
+        b0++;
+    }
+    while (a0 < a1 && b0 < b1 && line_view_equal(&a[a1 - 1], &b[b1 - 1])) {
+        a1--;
+        b1--;
+    }
+
+    if (a0 == a1 || b0 == b1 || ctx->exhausted) {
+        script_add(ctx->script, a0, a1 - a0, b0, b1 - b0);
+        return;
+    }
+
+    // Regiões pequenas ou sem linhas únicas em comum: Myers dá o resultado mínimo
+    PatienceAnchor* anchors = NULL;
+    int anchor_count = (a1 - a0) + (b1 - b0) <= DIFF_PATIENCE_MIN_REGION
+        ? 0 : patience_find_anchors(a, a0, a1, b, b0, b1, &anchors);
+    if (anchor_count == 0) {
+        myers_compare(ctx, a0, a1, b0, b1);
+        return;
+    }
+
+    // Cada intervalo entre âncoras consecutivas é resolvido de forma independente
+    for (int k = 0; k < anchor_count; k++) {
+        patience_compare(ctx, a0, anchors[k].old_index, b0, anchors[k].new_index);
+        a0 = anchors[k].old_index + 1;
+        b0 = anchors[k].new_index + 1;
+    }
+    safe_free(anchors);
+
+    patience_compare(ctx, a0, a1, b0, b1);
+}
+
+static int run_engine(DiffEngine engine, const LineView* old_lines, int old_count,
+                      const LineView* new_lines, int new_count, long long deadline_ns,
+                      DiffScript* script, int* exhausted) {
+    if (!script || old_count < 0 || new_count < 0) return -1;
+    if ((old_count && !old_lines) || (new_count && !new_lines)) return -1;
+
+    MyersContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.a = old_lines;
+    ctx.b = new_lines;
+    ctx.script = script;
+    ctx.deadline_ns = deadline_ns;
+
+    if (engine == DIFF_ENGINE_PATIENCE) {
+        patience_compare(&ctx, 0, old_count, 0, new_count);
+    } else {
+        myers_compare(&ctx, 0, old_count, 0, new_count);
+    }
+
+    safe_free(ctx.forward);
+    safe_free(ctx.backward);
+    if (exhausted) *exhausted = ctx.exhausted;
+    return 0;
+}
+
+int diff_myers(const LineView* old_lines, int old_count,
+               const LineView* new_lines, int new_count, DiffScript* script) {
+    return run_engine(DIFF_ENGINE_MYERS, old_lines, old_count, new_lines, new_count, 0, script, NULL);
+}
+
+int diff_patience(const LineView* old_lines, int old_count,
+                  const LineView* new_lines, int new_count, DiffScript* script) {
+    return run_engine(DIFF_ENGINE_PATIENCE, old_lines, old_count, new_lines, new_count, 0, script, NULL);
+}
+
+// Amostra pelo hash: com `shift` > 0, só as linhas cujos `shift` bits mais altos do
+// hash são zero (as mesmas linhas dos dois lados, já que linhas iguais têm o mesmo hash)
+static inline int in_sample(const LineView* line, int shift) {
+    return shift == 0 || (line->hash >> (64 - shift)) == 0;
+}
+
+// Contagem com tabela hash sobre uma amostra das linhas: para cada linha distinta,
+// |ocorrências em old - ocorrências em new| precisa ser inserido ou removido (limite
+// inferior de D), e as linhas com exatamente uma ocorrência de cada lado são as
+// âncoras do patience. Janelas com mais de DIFF_AUTO_SAMPLE_LINES linhas contam só
+// 1 em 2^shift linhas (escolhidas pelo hash) e multiplicam o resultado por 2^shift:
+// a varredura continua O(N + M), mas a tabela e as sondagens ficam limitadas pela
+// amostra e as contagens viram estimativas.
+static void measure_window(const LineView* a, int n, const LineView* b, int m,
+                           long* estimated_edits, int* unique_pairs) {
+    int shift = 0;
+    while (shift < 16 && ((long)n + m) >> shift > DIFF_AUTO_SAMPLE_LINES) shift++;
+
+    int sampled = 0;
+    for (int i = 0; i < n; i++) sampled += in_sample(&a[i], shift);
+    for (int j = 0; j < m; j++) sampled += in_sample(&b[j], shift);
+
+    int size = 16;
+    while (size < sampled * 2) size <<= 1;
+    int mask = size - 1;
+
+    UniqueSlot* slots = (UniqueSlot*)safe_malloc((size_t)size * sizeof(UniqueSlot));
+    for (int i = 0; i < size; i++) slots[i].line = -1;
+
+    long edits = 0;
+    for (int i = 0; i < n; i++) {
+        if (!in_sample(&a[i], shift)) continue;
+        int h = (int)(a[i].hash & (uint64_t)mask);
+        while (slots[h].line >= 0 && !line_view_equal(&a[slots[h].line], &a[i])) h = (h + 1) & mask;
+        if (slots[h].line < 0) {
+            slots[h].line = i;
+            slots[h].old_count = 0;
+            slots[h].new_count = 0;
+        }
+        slots[h].old_count++;
+    }
+    for (int j = 0; j < m; j++) {
+        if (!in_sample(&b[j], shift)) continue;
+        int h = (int)(b[j].hash & (uint64_t)mask);
+        while (slots[h].line >= 0 && !line_view_equal(&a[slots[h].line], &b[j])) h = (h + 1) & mask;
+        if (slots[h].line < 0) {
+            edits++;                       // Linha que só existe em new
+            continue;
+        }
+        slots[h].new_count++;
+    }
+
+    long unique = 0;
+    for (int i = 0; i < size; i++) {
+        if (slots[i].line < 0) continue;
+        int diff = slots[i].old_count - slots[i].new_count;
+        edits += diff < 0 ? -diff : diff;
+        if (slots[i].old_count == 1 && slots[i].new_count == 1) unique++;
+    }
+    safe_free(slots);
+
+    // Extrapolar a amostra para a janela inteira
+    int shortest = n < m ? n : m;
+    unique <<= shift;
+    *estimated_edits = edits << shift;
+    *unique_pairs = unique < shortest ? (int)unique : shortest;
+}
+
+int diff_auto(const LineView* old_lines, int old_count, const LineView* new_lines, int new_count,
+              long long budget_ns, DiffScript* script, DiffPlan* plan) {
+    if (!plan) return -1;
+
+    long long start = monotonic_ns();
+    memset(plan, 0, sizeof(*plan));
+    plan->window_lines = old_count + new_count;
+    plan->engine = DIFF_ENGINE_MYERS;
+
+    if (plan->window_lines <= DIFF_AUTO_SMALL_WINDOW) {
+        plan->reason = DIFF_REASON_SMALL_WINDOW;
+    } else {
+        int unique_pairs;
+        measure_window(old_lines, old_count, new_lines, new_count, &plan->estimated_edits, &unique_pairs);
+        int shortest = old_count < new_count ? old_count : new_count;
+        plan->unique_ratio = shortest > 0 ? (double)unique_pairs / shortest : 0.0;
+
+        // Custo do Myers ~ (N + M) * D; o patience só ajuda se houver âncoras
+        long long myers_cost = (long long)plan->window_lines * (plan->estimated_edits > 0 ? plan->estimated_edits : 1);
+        if (myers_cost <= DIFF_AUTO_MYERS_COST) {
+            plan->reason = DIFF_REASON_LOW_COST;
+        } else if (plan->unique_ratio >= DIFF_AUTO_MIN_UNIQUE_RATIO) {
+            plan->engine = DIFF_ENGINE_PATIENCE;
+            plan->reason = DIFF_REASON_UNIQUE_ANCHORS;
+        } else {
+            plan->reason = DIFF_REASON_FEW_UNIQUE;
+        }
+    }
+
+    int status = run_engine(plan->engine, old_lines, old_count, new_lines, new_count,
+                            budget_ns > 0 ? start + budget_ns : 0, script, &plan->budget_exhausted);
+    plan->elapsed_ns = monotonic_ns() - start;
+    return status;
+}
+
+const char* diff_engine_name(DiffEngine engine) {
+    return engine == DIFF_ENGINE_PATIENCE ? "patience" : "myers";
+}
+
+const char* diff_reason_name(DiffReason reason) {
+    switch (reason) {
+        case DIFF_REASON_SMALL_WINDOW: return "small window";
+        case DIFF_REASON_LOW_COST: return "low estimated cost";
+        case DIFF_REASON_UNIQUE_ANCHORS: return "unique-line anchors";
+        case DIFF_REASON_FEW_UNIQUE: return "few unique lines";
+        default: return "unknown";
+    }
+}
+
+void diff_script_free(DiffScript* script) {
+    if (!script) return;
+    safe_free(script->hunks);
+    script->hunks = NULL;
+    script->count = 0;
+    script->capacity = 0;
+}
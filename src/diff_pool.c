@@ -0,0 +1,166 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "../include/diff_pool.h"
+#include "../include/hash.h"
+#include "../include/utils.h"
+
+#define DIFF_POOL_KEY_SEED 0x64696666706f6f6cULL   // "diffpool"
+
+typedef struct PoolItem {
+    DiffPoolTask task;
+    void* arg;
+    struct PoolItem* next;
+} PoolItem;
+
+// Fila própria de cada worker: um único consumidor preserva a ordem por chave
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t idle;
+    PoolItem* head;
+    PoolItem* tail;
+    int busy;
+    int running;
+} PoolWorker;
+
+struct DiffPool {
+    PoolWorker* workers;
+    int count;
+};
+
+static void* worker_thread_func(void* arg) {
+    PoolWorker* worker = (PoolWorker*)arg;
+
+    pthread_mutex_lock(&worker->mutex);
+    for (;;) {
+        while (!worker->head && worker->running) {
+            pthread_cond_wait(&worker->not_empty, &worker->mutex);
+        }
+        if (!worker->head) break;
+
+        PoolItem* item = worker->head;
+        worker->head = item->next;
+        if (!worker->head) worker->tail = NULL;
+        worker->busy = 1;
+        pthread_mutex_unlock(&worker->mutex);
+
+        item->task(item->arg);
+        safe_free(item);
+
+        pthread_mutex_lock(&worker->mutex);
+        worker->busy = 0;
+        if (!worker->head) {
+            pthread_cond_broadcast(&worker->idle);
+        }
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return NULL;
+}
+
+int diff_pool_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    return cpus > DIFF_POOL_MAX_THREADS ? DIFF_POOL_MAX_THREADS : (int)cpus;
+}
+
+DiffPool* diff_pool_create(int threads) {
+    if (threads <= 0) return NULL;
+    if (threads > DIFF_POOL_MAX_THREADS) threads = DIFF_POOL_MAX_THREADS;
+
+    DiffPool* pool = (DiffPool*)safe_malloc(sizeof(DiffPool));
+    pool->workers = (PoolWorker*)safe_malloc((size_t)threads * sizeof(PoolWorker));
+    pool->count = 0;
+
+    for (int i = 0; i < threads; i++) {
+        PoolWorker* worker = &pool->workers[i];
+        memset(worker, 0, sizeof(*worker));
+        pthread_mutex_init(&worker->mutex, NULL);
+        pthread_cond_init(&worker->not_empty, NULL);
+        pthread_cond_init(&worker->idle, NULL);
+        worker->running = 1;
+
+        if (pthread_create(&worker->thread, NULL, worker_thread_func, worker) != 0) {
+            log_message(LOG_ERROR, "Failed to create diff worker %d", i);
+            pthread_mutex_destroy(&worker->mutex);
+            pthread_cond_destroy(&worker->not_empty);
+            pthread_cond_destroy(&worker->idle);
+            break;
+        }
+        pool->count++;
+    }
+
+    if (pool->count == 0) {
+        safe_free(pool->workers);
+        safe_free(pool);
+        return NULL;
+    }
+
+    log_message(LOG_DEBUG, "Started diff pool with %d workers", pool->count);
+    return pool;
+}
+
+void diff_pool_destroy(DiffPool* pool) {
+    if (!pool) return;
+
+    for (int i = 0; i < pool->count; i++) {
+        PoolWorker* worker = &pool->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        worker->running = 0;
+        pthread_cond_signal(&worker->not_empty);
+        pthread_mutex_unlock(&worker->mutex);
+    }
+
+    for (int i = 0; i < pool->count; i++) {
+        PoolWorker* worker = &pool->workers[i];
+        pthread_join(worker->thread, NULL);
+        pthread_mutex_destroy(&worker->mutex);
+        pthread_cond_destroy(&worker->not_empty);
+        pthread_cond_destroy(&worker->idle);
+    }
+
+    safe_free(pool->workers);
+    safe_free(pool);
+}
+
+int diff_pool_submit(DiffPool* pool, const char* key, DiffPoolTask task, void* arg) {
+    if (!pool || !key || !task) return -1;
+
+    // Mesma normalização de operation_set_file: "./a.c" e "a.c" caem no mesmo worker
+    if (strncmp(key, "./", 2) == 0) key += 2;
+    uint64_t hash = hash_bytes64(key, strlen(key), DIFF_POOL_KEY_SEED);
+    PoolWorker* worker = &pool->workers[hash % (uint64_t)pool->count];
+
+    PoolItem* item = (PoolItem*)safe_malloc(sizeof(PoolItem));
+    item->task = task;
+    item->arg = arg;
+    item->next = NULL;
+
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->tail) {
+        worker->tail->next = item;
+    } else {
+        worker->head = item;
+    }
+    worker->tail = item;
+    pthread_cond_signal(&worker->not_empty);
+    pthread_mutex_unlock(&worker->mutex);
+    return 0;
+}
+
+void diff_pool_wait(DiffPool* pool) {
+    if (!pool) return;
+
+    for (int i = 0; i < pool->count; i++) {
+        PoolWorker* worker = &pool->workers[i];
+        pthread_mutex_lock(&worker->mutex);
+        while (worker->head || worker->busy) {
+            pthread_cond_wait(&worker->idle, &worker->mutex);
+        }
+        pthread_mutex_unlock(&worker->mutex);
+    }
+}
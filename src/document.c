@@ -0,0 +1,453 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include <stdio.h>
+#include <string.h>
+#include "../include/document.h"
+#include "../include/utils.h"
+#include "../include/block_delta.h"
+
+#define DOCUMENT_ORIGINAL 0
+#define DOCUMENT_ADDED 1
+#define DOCUMENT_INITIAL_CAPACITY 4096
+
+struct DocumentPiece {
+    DocumentPiece* left;
+    DocumentPiece* right;
+    uint32_t priority;
+    int buffer;                  // DOCUMENT_ORIGINAL ou DOCUMENT_ADDED
+    size_t start;
+    size_t length;
+    size_t newline_first;        // Índice em buffer->newlines do primeiro '\n' da peça
+    size_t newline_count;
+    size_t total_length;         // Agregados da subárvore
+    size_t total_newlines;
+};
+
+static const DocumentBuffer* piece_buffer(const Document* doc, const DocumentPiece* piece) {
+    return piece->buffer == DOCUMENT_ORIGINAL ? &doc->original : &doc->added;
+}
+
+// Primeiro índice de `newlines` com posição >= pos
+static size_t newline_lower_bound(const DocumentBuffer* buf, size_t pos) {
+    size_t lo = 0, hi = buf->newline_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (buf->newlines[mid] < pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void buffer_index_newlines(DocumentBuffer* buf, size_t from) {
+    const char* p = buf->data + from;
+    const char* end = buf->data + buf->size;
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        if (buf->newline_count == buf->newline_capacity) {
+            buf->newline_capacity = buf->newline_capacity ? buf->newline_capacity * 2 : 64;
+            buf->newlines = (size_t*)safe_realloc(buf->newlines, buf->newline_capacity * sizeof(size_t));
+        }
+        buf->newlines[buf->newline_count++] = (size_t)(p - buf->data);
+        p++;
+    }
+}
+
+static void buffer_free(DocumentBuffer* buf) {
+    safe_free(buf->data);
+    safe_free(buf->newlines);
+    memset(buf, 0, sizeof(*buf));
+}
+
+static size_t tree_length(const DocumentPiece* node) {
+    return node ? node->total_length : 0;
+}
+
+static size_t tree_newlines(const DocumentPiece* node) {
+    return node ? node->total_newlines : 0;
+}
+
+static void piece_update(DocumentPiece* node) {
+    node->total_length = tree_length(node->left) + node->length + tree_length(node->right);
+    node->total_newlines = tree_newlines(node->left) + node->newline_count + tree_newlines(node->right);
+}
+
+static void piece_measure(const Document* doc, DocumentPiece* piece) {
+    const DocumentBuffer* buf = piece_buffer(doc, piece);
+    piece->newline_first = newline_lower_bound(buf, piece->start);
+    piece->newline_count = newline_lower_bound(buf, piece->start + piece->length) - piece->newline_first;
+    piece_update(piece);
+}
+
+static DocumentPiece* piece_create(Document* doc, int buffer, size_t start, size_t length) {
+    DocumentPiece* piece = (DocumentPiece*)safe_malloc(sizeof(DocumentPiece));
+    piece->left = NULL;
+    piece->right = NULL;
+
+    // xorshift32: prioridades aleatórias mantêm a treap balanceada
+    doc->seed ^= doc->seed << 13;
+    doc->seed ^= doc->seed >> 17;
+    doc->seed ^= doc->seed << 5;
+    piece->priority = doc->seed;
+
+    piece->buffer = buffer;
+    piece->start = start;
+    piece->length = length;
+    piece_measure(doc, piece);
+    return piece;
+}
+
+static void tree_free(DocumentPiece* node) {
+    if (!node) return;
+    tree_free(node->left);
+    tree_free(node->right);
+    safe_free(node);
+}
+
+static DocumentPiece* tree_merge(DocumentPiece* a, DocumentPiece* b) {
+    if (!a) return b;
+    if (!b) return a;
+
+    if (a->priority > b->priority) {
+        a->right = tree_merge(a->right, b);
+        piece_update(a);
+        return a;
+    }
+    b->left = tree_merge(a, b->left);
+    piece_update(b);
+    return b;
+}
+
+// Separa os primeiros `offset` bytes; uma peça atravessada pelo corte vira duas
+static void tree_split(Document* doc, DocumentPiece* node, size_t offset,
+                       DocumentPiece** left, DocumentPiece** right) {
+    if (!node) {
+        *left = *right = NULL;
+        return;
+    }
+
+    size_t left_len = tree_length(node->left);
+    if (offset <= left_len) {
+        tree_split(doc, node->left, offset, left, &node->left);
+        piece_update(node);
+        *right = node;
+    } else if (offset >= left_len + node->length) {
+        tree_split(doc, node->right, offset - left_len - node->length, &node->right, right);
+        piece_update(node);
+        *left = node;
+    } else {
+        size_t cut = offset - left_len;
+        DocumentPiece* tail = piece_create(doc, node->buffer, node->start + cut, node->length - cut);
+        node->length = cut;
+        *right = tree_merge(tail, node->right);
+        node->right = NULL;
+        piece_measure(doc, node);
+        *left = node;
+    }
+}
+
+void document_init(Document* doc, char* content, size_t size) {
+    memset(doc, 0, sizeof(*doc));
+    doc->seed = 0x9E3779B9u;
+    document_reset(doc, content, size);
+}
+
+void document_reset(Document* doc, char* content, size_t size) {
+    tree_free(doc->root);
+    buffer_free(&doc->original);
+    buffer_free(&doc->added);
+    doc->root = NULL;
+    doc->empty = 0;
+
+    doc->original.data = content;
+    doc->original.size = size;
+    doc->original.capacity = size;
+    buffer_index_newlines(&doc->original, 0);
+
+    if (size > 0) {
+        doc->root = piece_create(doc, DOCUMENT_ORIGINAL, 0, size);
+    }
+}
+
+void document_free(Document* doc) {
+    if (!doc) return;
+    tree_free(doc->root);
+    buffer_free(&doc->original);
+    buffer_free(&doc->added);
+    doc->root = NULL;
+}
+
+size_t document_size(const Document* doc) {
+    return tree_length(doc->root);
+}
+
+int document_line_count(const Document* doc) {
+    return doc->empty ? 0 : (int)tree_newlines(doc->root) + 1;
+}
+
+int document_line_offset(const Document* doc, int line, size_t* offset) {
+    if (line < 0 || line >= document_line_count(doc)) return -1;
+    if (line == 0) {
+        *offset = 0;
+        return 0;
+    }
+
+    // A linha começa logo após o line-ésimo '\n'
+    size_t target = (size_t)line;
+    size_t base = 0;
+    const DocumentPiece* node = doc->root;
+    while (node) {
+        size_t left_newlines = tree_newlines(node->left);
+        if (target <= left_newlines) {
+            node = node->left;
+        } else if (target <= left_newlines + node->newline_count) {
+            const DocumentBuffer* buf = piece_buffer(doc, node);
+            size_t pos = buf->newlines[node->newline_first + (target - left_newlines) - 1];
+            *offset = base + tree_length(node->left) + (pos - node->start) + 1;
+            return 0;
+        } else {
+            target -= left_newlines + node->newline_count;
+            base += tree_length(node->left) + node->length;
+            node = node->right;
+        }
+    }
+    return -1;
+}
+
+int document_insert(Document* doc, size_t offset, const char* text, size_t len) {
+    if (offset > document_size(doc)) return -1;
+    if (len == 0) return 0;
+
+    DocumentBuffer* buf = &doc->added;
+    if (buf->size + len + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : DOCUMENT_INITIAL_CAPACITY;
+        while (capacity < buf->size + len + 1) capacity *= 2;
+        buf->data = (char*)safe_realloc(buf->data, capacity);
+        buf->capacity = capacity;
+    }
+    size_t start = buf->size;
+    memcpy(buf->data + start, text, len);
+    buf->size += len;
+    buf->data[buf->size] = '\0';
+    buffer_index_newlines(buf, start);
+
+    DocumentPiece* left;
+    DocumentPiece* right;
+    tree_split(doc, doc->root, offset, &left, &right);
+    DocumentPiece* piece = piece_create(doc, DOCUMENT_ADDED, start, len);
+    doc->root = tree_merge(tree_merge(left, piece), right);
+    doc->empty = 0;
+    return 0;
+}
+
+int document_delete(Document* doc, size_t offset, size_t len) {
+    if (offset > document_size(doc) || len > document_size(doc) - offset) return -1;
+    if (len == 0) return 0;
+
+    DocumentPiece* left;
+    DocumentPiece* middle;
+    DocumentPiece* right;
+    tree_split(doc, doc->root, offset, &left, &right);
+    tree_split(doc, right, len, &middle, &right);
+    tree_free(middle);
+    doc->root = tree_merge(left, right);
+    return 0;
+}
+
+// Copia as peças que se sobrepõem a [offset, offset + len) da subárvore
+static void tree_read(const Document* doc, const DocumentPiece* node, size_t offset, size_t len, char* out) {
+    if (!node || len == 0) return;
+
+    size_t left_len = tree_length(node->left);
+    if (offset < left_len) {
+        size_t n = left_len - offset < len ? left_len - offset : len;
+        tree_read(doc, node->left, offset, n, out);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+    if (len > 0 && offset < left_len + node->length) {
+        size_t from = offset - left_len;
+        size_t n = node->length - from < len ? node->length - from : len;
+        memcpy(out, piece_buffer(doc, node)->data + node->start + from, n);
+        out += n;
+        offset += n;
+        len -= n;
+    }
+    if (len > 0) {
+        tree_read(doc, node->right, offset - left_len - node->length, len, out);
+    }
+}
+
+int document_read(const Document* doc, size_t offset, size_t len, char* out) {
+    if (offset > document_size(doc) || len > document_size(doc) - offset) return -1;
+    tree_read(doc, doc->root, offset, len, out);
+    return 0;
+}
+
+// Remove [offset, offset + len) se o trecho for igual a `expected`
+static int delete_expected(Document* doc, size_t offset, size_t len, const char* expected, size_t expected_len) {
+    if (expected && expected_len != len) return -1;
+
+    if (expected && len > 0) {
+        char* current = (char*)safe_malloc(len);
+        int matches = document_read(doc, offset, len, current) == 0 && memcmp(current, expected, len) == 0;
+        safe_free(current);
+        if (!matches) return -1;
+    }
+    return document_delete(doc, offset, len);
+}
+
+// Insere `count` linhas (texto sem o '\n' final) antes da linha `line`; line igual
+// à quantidade de linhas acrescenta ao fim
+static int insert_lines(Document* doc, int line, const char* text, size_t len) {
+    if (doc->empty) {
+        if (line != 0) return -1;
+        doc->empty = 0;
+        return document_insert(doc, 0, text, len);
+    }
+
+    int count = document_line_count(doc);
+    size_t offset;
+    if (line < count) {
+        if (document_line_offset(doc, line, &offset) != 0) return -1;
+        if (document_insert(doc, offset, "\n", 1) != 0) return -1;
+        return document_insert(doc, offset, text, len);
+    }
+    if (line == count) {
+        offset = document_size(doc);
+        if (document_insert(doc, offset, "\n", 1) != 0) return -1;
+        return document_insert(doc, offset + 1, text, len);
+    }
+    return -1;
+}
+
+// Remove `count` linhas a partir de `line` com seus '\n'. Se chegar à última
+// linha, leva o '\n' anterior; removendo tudo, o documento fica sem linhas.
+static int delete_lines(Document* doc, int line, int count, const char* expected, size_t expected_len) {
+    int total = document_line_count(doc);
+    if (line < 0 || count <= 0 || line + count > total) return -1;
+
+    size_t start, end;
+    if (document_line_offset(doc, line, &start) != 0) return -1;
+
+    if (line + count < total) {
+        if (document_line_offset(doc, line + count, &end) != 0) return -1;
+        return delete_expected(doc, start, end - start - 1, expected, expected_len) == 0
+            ? document_delete(doc, start, 1) : -1;
+    }
+
+    end = document_size(doc);
+    if (delete_expected(doc, start, end - start, expected, expected_len) != 0) return -1;
+    if (line > 0) return document_delete(doc, start - 1, 1);
+
+    doc->empty = 1;
+    return 0;
+}
+
+int document_apply(Document* doc, const Operation* op) {
+    if (!doc || !op) return -1;
+
+    const char* text = op->text ? op->text : "";
+    size_t len = strlen(text);
+    int count = op->line_count > 0 ? op->line_count : 1;
+    size_t offset;
+
+    if (strcmp(op->op_type, "insert") == 0) {
+        return insert_lines(doc, op->line, text, len);
+    }
+    if (strcmp(op->op_type, "delete") == 0) {
+        return delete_lines(doc, op->line, count, op->text, len);
+    }
+    if (strcmp(op->op_type, "replace") == 0) {
+        if (delete_lines(doc, op->line, count, NULL, 0) != 0) return -1;
+        return insert_lines(doc, op->line, text, len);
+    }
+    if (strcmp(op->op_type, "ins_text") == 0 || strcmp(op->op_type, "del_text") == 0) {
+        size_t line_end;
+        if (op->column < 0 || document_line_offset(doc, op->line, &offset) != 0) return -1;
+        if (document_line_offset(doc, op->line + 1, &line_end) == 0) {
+            line_end--;
+        } else {
+            line_end = document_size(doc);
+        }
+
+        offset += (size_t)op->column;
+        if (op->text == NULL || offset > line_end) return -1;
+        if (op->op_type[0] == 'i') {
+            return document_insert(doc, offset, text, len);
+        }
+        return offset + len <= line_end ? delete_expected(doc, offset, len, text, len) : -1;
+    }
+    if (strcmp(op->op_type, "create") == 0) {
+        document_delete(doc, 0, document_size(doc));
+        doc->empty = 0;
+        return document_insert(doc, 0, text, len);
+    }
+    if (strcmp(op->op_type, "blocks") == 0) {
+        // Delta de blocos em base64, aplicado ao conteúdo inteiro
+        size_t delta_len, old_len, new_len;
+        unsigned char* delta = (unsigned char*)str_base64_decode(text, len, &delta_len);
+        if (!delta) return -1;
+        const char* old = document_text(doc, &old_len);
+        char* result = block_delta_apply(old, old_len, delta, delta_len, &new_len);
+        safe_free(delta);
+        if (!result) return -1;
+        document_reset(doc, result, new_len);
+        doc->empty = 0;
+        return 0;
+    }
+
+    log_message(LOG_WARNING, "Unsupported operation type %s", op->op_type);
+    return -1;
+}
+
+static void tree_copy(const Document* doc, const DocumentPiece* node, char** out) {
+    if (!node) return;
+    tree_copy(doc, node->left, out);
+    memcpy(*out, piece_buffer(doc, node)->data + node->start, node->length);
+    *out += node->length;
+    tree_copy(doc, node->right, out);
+}
+
+const char* document_text(Document* doc, size_t* size) {
+    size_t total = document_size(doc);
+    if (size) *size = total;
+
+    const DocumentPiece* root = doc->root;
+    int pristine = root && !root->left && !root->right && root->buffer == DOCUMENT_ORIGINAL &&
+                   root->start == 0 && root->length == doc->original.size;
+    if (pristine) return doc->original.data;
+    if (total == 0 && doc->original.size == 0 && doc->original.data) return doc->original.data;
+
+    char* text = (char*)safe_malloc(total + 1);
+    char* p = text;
+    tree_copy(doc, doc->root, &p);
+    text[total] = '\0';
+
+    int empty = doc->empty;
+    document_reset(doc, text, total);
+    doc->empty = empty;
+    return text;
+}
+
+static int tree_write(const Document* doc, const DocumentPiece* node, FILE* file) {
+    if (!node) return 0;
+    if (tree_write(doc, node->left, file) != 0) return -1;
+    if (fwrite(piece_buffer(doc, node)->data + node->start, 1, node->length, file) != node->length) return -1;
+    return tree_write(doc, node->right, file);
+}
+
+int document_write(const Document* doc, const char* filepath) {
+    FILE* file = fopen(filepath, "wb");
+    if (!file) {
+        log_message(LOG_ERROR, "Failed to open %s for writing", filepath);
+        return -1;
+    }
+
+    int status = tree_write(doc, doc->root, file);
+    if (fclose(file) != 0) status = -1;
+    if (status != 0) {
+        log_message(LOG_ERROR, "Failed to write %s", filepath);
+    }
+    return status;
+}
@@ -54,42 +54,29 @@ static int should_ignore_file(const char* filename) {
     return 0;
 }
 
-static int is_text_file(const char* filepath) {
-    // Verificar extensões de texto conhecidas
-    const char* ext = strrchr(filepath, '.');
-    if (!ext) return 0;
-
-    const char* text_extensions[] = {
-        ".c", ".h", ".cpp", ".hpp", ".cc", ".hh",
-        ".py", ".js", ".ts", ".html", ".css", ".json",
-        ".txt", ".md", ".xml", ".yaml", ".yml",
-        ".java", ".go", ".rs", ".rb", ".php",
-        ".sh", ".bash", ".zsh", ".fish",
-        NULL
-    };
-
-    for (int i = 0; text_extensions[i]; i++) {
-        if (strcasecmp(ext, text_extensions[i]) == 0) {
-            return 1;
-        }
-    }
+// Arquivos regulares fora de .myvc, de qualquer tipo: texto é versionado por linhas,
+// binários e arquivos grandes por deltas de blocos (ver versioning.h)
+static int is_tracked_file(const char* filepath, const struct stat* st) {
+    if (!S_ISREG(st->st_mode)) return 0;
+    return strstr(filepath, "/.myvc/") == NULL && strncmp(filepath, ".myvc/", 6) != 0;
+}
 
-    return 0;
+static int is_tracked_path(const char* filepath) {
+    struct stat st;
+    return stat(filepath, &st) == 0 && is_tracked_file(filepath, &st);
+}
+
+// Hash simples baseado em tamanho e timestamp
+static void format_file_hash(const struct stat* st, char* hash, size_t size) {
+    snprintf(hash, size, "%ld_%ld", (long)st->st_size, (long)st->st_mtime);
 }
 
 static char* get_file_hash(const char* filepath) {
     static char hash[32];
-    FILE* file = fopen(filepath, "rb");
-    if (!file) return NULL;
-
-    // Hash simples baseado em tamanho e timestamp
     struct stat st;
-    if (fstat(fileno(file), &st) == 0) {
-        snprintf(hash, sizeof(hash), "%ld_%ld",
-                 (long)st.st_size, (long)st.st_mtime);
-    }
+    if (stat(filepath, &st) != 0) return NULL;
 
-    fclose(file);
+    format_file_hash(&st, hash, sizeof(hash));
     return hash;
 }
 
@@ -102,11 +89,8 @@ static WatchedFile* find_watched_file(FileWatcher* watcher, const char* filepath
     return NULL;
 }
 
-static int add_watched_file(FileWatcher* watcher, const char* filepath) {
-    if (find_watched_file(watcher, filepath)) {
-        return 0; // Já existe
-    }
-
+// Acrescenta sem procurar duplicatas, com o stat já obtido por quem chama
+static void append_watched_file(FileWatcher* watcher, const char* filepath, const struct stat* st) {
     // Expandir array se necessário
     if (watcher->file_count >= watcher->file_capacity) {
         watcher->file_capacity *= 2;
@@ -117,22 +101,26 @@ static int add_watched_file(FileWatcher* watcher, const char* filepath) {
     }
 
     WatchedFile* file = &watcher->files[watcher->file_count++];
+    memset(file, 0, sizeof(*file));
     strncpy(file->filepath, filepath, MAX_PATH_LEN - 1);
     file->filepath[MAX_PATH_LEN - 1] = '\0';
 
-    struct stat st;
-    if (stat(filepath, &st) == 0) {
-        file->last_modified = st.st_mtime;
-        file->size = st.st_size;
+    if (st) {
+        file->last_modified = st->st_mtime;
+        file->size = st->st_size;
+        format_file_hash(st, file->hash, sizeof(file->hash));
     }
 
-    char* hash = get_file_hash(filepath);
-    if (hash) {
-        strncpy(file->hash, hash, sizeof(file->hash) - 1);
-        file->hash[sizeof(file->hash) - 1] = '\0';
+    log_message(LOG_DEBUG, "Added file to watch: %s", filepath);
+}
+
+static int add_watched_file(FileWatcher* watcher, const char* filepath) {
+    if (find_watched_file(watcher, filepath)) {
+        return 0; // Já existe
     }
 
-    log_message(LOG_DEBUG, "Added file to watch: %s", filepath);
+    struct stat st;
+    append_watched_file(watcher, filepath, stat(filepath, &st) == 0 ? &st : NULL);
     return 1;
 }
 
@@ -174,8 +162,9 @@ static int scan_directory(FileWatcher* watcher, const char* dir_path) {
         if (S_ISDIR(st.st_mode)) {
             // Recursivamente escanear subdiretórios
             scan_directory(watcher, full_path);
-        } else if (S_ISREG(st.st_mode) && is_text_file(full_path)) {
-            add_watched_file(watcher, full_path);
+        } else if (is_tracked_file(full_path, &st)) {
+            // Cada caminho aparece uma vez na varredura: sem busca e sem outro stat
+            append_watched_file(watcher, full_path, &st);
         }
     }
 
@@ -193,7 +182,7 @@ static void handle_inotify_event(FileWatcher* watcher, struct inotify_event* eve
     pthread_mutex_lock(&watcher->mutex);
 
     if (event->mask & IN_CREATE) {
-        if (is_text_file(full_path)) {
+        if (is_tracked_path(full_path)) {
             add_watched_file(watcher, full_path);
             if (watcher->callback) {
                 watcher->callback(full_path, FILE_CREATED, watcher->user_data);
@@ -237,7 +226,7 @@ static void handle_inotify_event(FileWatcher* watcher, struct inotify_event* eve
     }
 
     if (event->mask & IN_MOVED_TO) {
-        if (is_text_file(full_path)) {
+        if (is_tracked_path(full_path)) {
             add_watched_file(watcher, full_path);
             if (watcher->callback) {
                 watcher->callback(full_path, FILE_CREATED, watcher->user_data);
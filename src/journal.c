@@ -0,0 +1,880 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "journal.h"
+#include "hash.h"
+#include "utils.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+
+#define JOURNAL_MAGIC "MYVCJRNL"
+#define JOURNAL_LOCK_FILE "LOCK"
+
+#define SEGMENT_END UINT64_MAX
+
+typedef struct {
+    uint32_t id;
+    const unsigned char* data;   // Segmento mapeado (NULL até o primeiro acesso)
+    size_t size;
+    size_t valid_end;            // Fim do último registro válido (0 = desconhecido)
+    uint64_t base_count;
+    int invalid;
+    const uint32_t* offsets;     // Offset de cada registro (NULL = ausente ou não carregado)
+    size_t offsets_size;         // Tamanho mapeado (0 = tabela montada em memória)
+    size_t offset_count;
+    int offsets_loaded;
+    int offsets_complete;
+} ReaderSegment;
+
+struct JournalReader {
+    char dir[512];
+    ReaderSegment* segments;
+    int segment_count;
+};
+
+void journal_segment_path(const char* dir, uint32_t segment_id, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%010u.seg", dir, segment_id);
+}
+
+void journal_offsets_path(const char* dir, uint32_t segment_id, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%010u%s", dir, segment_id, JOURNAL_OFFSETS_EXT);
+}
+
+static int compare_segment_ids(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+int journal_list_segments(const char* dir, uint32_t** ids, int* count) {
+    if (!dir || !ids || !count) return -1;
+
+    *ids = NULL;
+    *count = 0;
+
+    DIR* d = opendir(dir);
+    if (!d) return -1;
+
+    int capacity = 0;
+    struct dirent* entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len < 5 || strcmp(entry->d_name + len - 4, ".seg") != 0) continue;
+
+        char* end;
+        unsigned long id = strtoul(entry->d_name, &end, 10);
+        if (end != entry->d_name + len - 4 || id == 0) continue;
+
+        if (*count >= capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            *ids = (uint32_t*)safe_realloc(*ids, capacity * sizeof(uint32_t));
+        }
+        (*ids)[(*count)++] = (uint32_t)id;
+    }
+    closedir(d);
+
+    if (*count > 1) {
+        qsort(*ids, *count, sizeof(uint32_t), compare_segment_ids);
+    }
+    return 0;
+}
+
+// Valida o registro em buf+offset; retorna seu tamanho total ou 0 se inválido/incompleto
+static size_t record_validate(const unsigned char* buf, size_t size, size_t offset) {
+    if (size - offset < JOURNAL_RECORD_OVERHEAD) return 0;
+
+    uint32_t len, crc, trailer;
+    memcpy(&len, buf + offset, 4);
+    memcpy(&crc, buf + offset + 4, 4);
+
+    if (len > JOURNAL_MAX_RECORD) return 0;
+    if (size - offset - JOURNAL_RECORD_OVERHEAD < len) return 0;
+
+    memcpy(&trailer, buf + offset + JOURNAL_RECORD_HEADER + len, 4);
+    if (trailer != len) return 0;
+
+    if (hash_crc32(buf + offset + JOURNAL_RECORD_HEADER, len) != crc) return 0;
+
+    return JOURNAL_RECORD_OVERHEAD + (size_t)len;
+}
+
+static int header_validate(const unsigned char* data, size_t size, uint32_t segment_id,
+                           JournalSegmentHeader* header) {
+    if (size < sizeof(JournalSegmentHeader)) return -1;
+
+    memcpy(header, data, sizeof(JournalSegmentHeader));
+    if (memcmp(header->magic, JOURNAL_MAGIC, 8) != 0) return -1;
+    if (header->version > JOURNAL_VERSION) return -1;
+    if (header->segment_id != segment_id) return -1;
+    return 0;
+}
+
+static int create_segment(Journal* journal, uint32_t segment_id) {
+    char path[600];
+    journal_segment_path(journal->dir, segment_id, path, sizeof(path));
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND, 0644);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to create journal segment %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    JournalSegmentHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, 8);
+    header.version = JOURNAL_VERSION;
+    header.segment_id = segment_id;
+    header.base_count = journal->record_count;
+
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        log_message(LOG_ERROR, "Failed to write journal segment header %s", path);
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    journal->fd = fd;
+    journal->segment_id = segment_id;
+    journal->segment_size = sizeof(header);
+    journal->base_count = journal->record_count;
+
+    // Offsets são reconstruíveis a partir do segmento: uma falha aqui não é fatal
+    char off_path[600];
+    journal_offsets_path(journal->dir, segment_id, off_path, sizeof(off_path));
+    journal->off_fd = open(off_path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (journal->off_fd < 0) {
+        log_message(LOG_WARNING, "Failed to create journal offsets %s: %s", off_path, strerror(errno));
+    }
+
+    log_message(LOG_DEBUG, "Created journal segment %s", path);
+    return 0;
+}
+
+// Mapeia um arquivo inteiro somente para leitura
+static const unsigned char* map_file(const char* path, size_t* size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        *size = 0;
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) return NULL;
+
+    *size = (size_t)st.st_size;
+    return (const unsigned char*)data;
+}
+
+// Percorre os registros a partir do cabeçalho e retorna o fim do último válido
+static size_t scan_valid_end(const unsigned char* data, size_t size, uint64_t* count) {
+    size_t offset = sizeof(JournalSegmentHeader);
+    size_t record_size;
+    uint64_t n = 0;
+    while ((record_size = record_validate(data, size, offset)) > 0) {
+        offset += record_size;
+        n++;
+    }
+    if (count) *count = n;
+    return offset;
+}
+
+// Ajusta o arquivo de offsets aos registros válidos do segmento (descarta entradas
+// de registros truncados ou reconstrói as que faltam) e o abre para anexação
+static int recover_offsets(const char* dir, uint32_t segment_id, const unsigned char* data,
+                           size_t valid_end, uint64_t count) {
+    char path[600];
+    journal_offsets_path(dir, segment_id, path, sizeof(path));
+
+    long expected = (long)(count * sizeof(uint32_t));
+    long size = file_exists(path) ? file_get_size(path) : -1;
+
+    if (size > expected && truncate(path, (off_t)expected) == 0) {
+        size = expected;
+    }
+
+    if (size == expected) {
+        return open(path, O_WRONLY | O_APPEND);
+    }
+
+    uint32_t* offsets = (uint32_t*)safe_malloc((count ? count : 1) * sizeof(uint32_t));
+    size_t offset = sizeof(JournalSegmentHeader);
+    for (uint64_t i = 0; i < count && offset < valid_end; i++) {
+        uint32_t len;
+        memcpy(&len, data + offset, 4);
+        offsets[i] = (uint32_t)offset;
+        offset += JOURNAL_RECORD_OVERHEAD + (size_t)len;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (fd >= 0 && write(fd, offsets, (size_t)expected) != (ssize_t)expected) {
+        log_message(LOG_WARNING, "Failed to rebuild journal offsets %s", path);
+    }
+    safe_free(offsets);
+
+    log_message(LOG_DEBUG, "Rebuilt journal offsets for segment %u (%llu records)",
+                segment_id, (unsigned long long)count);
+    return fd;
+}
+
+// Varredura de recuperação: valida os registros do segmento ativo e descarta a cauda corrompida
+static int recover_segment(Journal* journal, uint32_t segment_id) {
+    char path[600];
+    journal_segment_path(journal->dir, segment_id, path, sizeof(path));
+
+    size_t size = 0;
+    const unsigned char* data = map_file(path, &size);
+    if (!data) {
+        if (size == 0 && file_exists(path)) return 1;
+        log_message(LOG_ERROR, "Failed to map journal segment %s", path);
+        return -1;
+    }
+
+    JournalSegmentHeader header;
+    if (header_validate(data, size, segment_id, &header) != 0) {
+        munmap((void*)data, size);
+        return 1;
+    }
+
+    uint64_t count;
+    size_t offset = scan_valid_end(data, size, &count);
+    if (!journal->read_only) {
+        journal->off_fd = recover_offsets(journal->dir, segment_id, data, offset, count);
+    }
+    munmap((void*)data, size);
+
+    if (offset < size) {
+        if (journal->read_only) {
+            log_message(LOG_DEBUG, "Journal segment %s has %zu bytes in flight", path, size - offset);
+        } else {
+            log_message(LOG_WARNING, "Truncating %zu bytes of torn records in %s", size - offset, path);
+            if (truncate(path, (off_t)offset) != 0) {
+                log_message(LOG_ERROR, "Failed to truncate %s: %s", path, strerror(errno));
+                return -1;
+            }
+        }
+    }
+
+    journal->segment_id = segment_id;
+    journal->segment_size = offset;
+    journal->base_count = header.base_count;
+    journal->record_count = header.base_count + count;
+
+    if (!journal->read_only) {
+        journal->fd = open(path, O_WRONLY | O_APPEND);
+        if (journal->fd < 0) {
+            log_message(LOG_ERROR, "Failed to open journal segment %s: %s", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    log_message(LOG_DEBUG, "Recovered journal segment %s (%llu records)",
+                path, (unsigned long long)count);
+    return 0;
+}
+
+Journal* journal_open(const char* dir) {
+    if (!dir) return NULL;
+
+    if (!dir_exists(dir) && dir_create(dir) != 0 && errno != EEXIST) {
+        log_message(LOG_ERROR, "Failed to create journal directory %s: %s", dir, strerror(errno));
+        return NULL;
+    }
+
+    Journal* journal = (Journal*)safe_malloc(sizeof(Journal));
+    memset(journal, 0, sizeof(Journal));
+    strncpy(journal->dir, dir, sizeof(journal->dir) - 1);
+    journal->fd = -1;
+    journal->off_fd = -1;
+    journal->lock_fd = -1;
+
+    // Apenas um processo pode escrever; os demais abrem em modo leitura
+    char lock_path[600];
+    snprintf(lock_path, sizeof(lock_path), "%s/%s", dir, JOURNAL_LOCK_FILE);
+    journal->lock_fd = open(lock_path, O_RDWR | O_CREAT, 0644);
+    if (journal->lock_fd < 0 || flock(journal->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        journal->read_only = 1;
+    }
+
+    uint32_t* ids;
+    int count;
+    if (journal_list_segments(dir, &ids, &count) != 0) {
+        journal_close(journal);
+        return NULL;
+    }
+
+    int result = 1;
+    while (count > 0 && result == 1) {
+        result = recover_segment(journal, ids[count - 1]);
+        if (result == 1) {
+            // Segmento sem cabeçalho válido (criação interrompida)
+            char path[600];
+            journal_segment_path(dir, ids[count - 1], path, sizeof(path));
+            if (journal->read_only) {
+                log_message(LOG_ERROR, "Invalid journal segment header in %s", path);
+                result = -1;
+                break;
+            }
+            log_message(LOG_WARNING, "Discarding journal segment with invalid header: %s", path);
+            unlink(path);
+            count--;
+        }
+    }
+
+    if (result == 1) {
+        // Journal vazio
+        result = journal->read_only ? 0 : create_segment(journal, 1);
+    }
+    safe_free(ids);
+
+    if (result != 0) {
+        journal_close(journal);
+        return NULL;
+    }
+
+    log_message(LOG_DEBUG, "Opened journal %s (%llu records%s)", dir,
+                (unsigned long long)journal->record_count,
+                journal->read_only ? ", read-only" : "");
+    return journal;
+}
+
+void journal_close(Journal* journal) {
+    if (!journal) return;
+
+    if (journal->fd >= 0) {
+        journal_sync(journal);
+        close(journal->fd);
+    }
+
+    if (journal->off_fd >= 0) {
+        close(journal->off_fd);
+    }
+
+    if (journal->lock_fd >= 0) {
+        close(journal->lock_fd);
+    }
+
+    safe_free(journal->staging);
+    safe_free(journal);
+}
+
+int journal_sync(Journal* journal) {
+    if (!journal || journal->fd < 0) return -1;
+    return fdatasync(journal->fd);
+}
+
+// Garante espaço no segmento ativo, rotacionando quando necessário
+static int ensure_segment_space(Journal* journal, size_t bytes) {
+    if (journal->segment_size > sizeof(JournalSegmentHeader) &&
+        journal->segment_size + bytes > JOURNAL_SEGMENT_SIZE) {
+        journal_sync(journal);
+        close(journal->fd);
+        journal->fd = -1;
+        if (journal->off_fd >= 0) {
+            close(journal->off_fd);
+            journal->off_fd = -1;
+        }
+
+        if (create_segment(journal, journal->segment_id + 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Escreve buf no segmento ativo; desfaz escrita parcial em caso de erro.
+// Os offsets vão depois dos registros: se faltarem, são reconstruídos na abertura.
+static int write_records(Journal* journal, const void* buf, size_t size,
+                         const void* offsets, int count) {
+    ssize_t written = write(journal->fd, buf, size);
+    if (written != (ssize_t)size) {
+        log_message(LOG_ERROR, "Failed to append journal records: %s",
+                    written < 0 ? strerror(errno) : "short write");
+        if (written > 0 && ftruncate(journal->fd, (off_t)journal->segment_size) != 0) {
+            log_message(LOG_ERROR, "Failed to roll back partial journal record");
+        }
+        return -1;
+    }
+
+    size_t offsets_size = (size_t)count * sizeof(uint32_t);
+    if (journal->off_fd >= 0 && write(journal->off_fd, offsets, offsets_size) != (ssize_t)offsets_size) {
+        log_message(LOG_WARNING, "Failed to append journal offsets, disabling until reopen");
+        close(journal->off_fd);
+        journal->off_fd = -1;
+    }
+    return 0;
+}
+
+int journal_append(Journal* journal, const void* payload, size_t len, JournalPos* pos) {
+    return journal_append_batch(journal, &payload, &len, 1, pos);
+}
+
+int journal_append_batch(Journal* journal, const void* const* payloads, const size_t* lens,
+                         int count, JournalPos* positions) {
+    if (!journal || !payloads || !lens || count <= 0) return -1;
+
+    if (journal->read_only || journal->fd < 0) {
+        log_message(LOG_ERROR, "Journal is locked by another process");
+        return -1;
+    }
+
+    int i = 0;
+    while (i < count) {
+        if (!payloads[i] || lens[i] > JOURNAL_MAX_RECORD) return -1;
+
+        if (ensure_segment_space(journal, JOURNAL_RECORD_OVERHEAD + lens[i]) != 0) {
+            return -1;
+        }
+
+        // Agrupar todos os registros que cabem no segmento ativo em uma única escrita
+        size_t batch_size = 0;
+        int end = i;
+        while (end < count && lens[end] <= JOURNAL_MAX_RECORD) {
+            size_t record_size = JOURNAL_RECORD_OVERHEAD + lens[end];
+            if (end > i && journal->segment_size + batch_size + record_size > JOURNAL_SEGMENT_SIZE) {
+                break;
+            }
+            batch_size += record_size;
+            end++;
+        }
+
+        // Registros seguidos dos seus offsets no mesmo buffer de staging
+        size_t offsets_size = (size_t)(end - i) * sizeof(uint32_t);
+        if (batch_size + offsets_size > journal->staging_capacity) {
+            journal->staging_capacity = batch_size + offsets_size;
+            journal->staging = (unsigned char*)safe_realloc(journal->staging, journal->staging_capacity);
+        }
+
+        unsigned char* p = journal->staging;
+        unsigned char* offsets = journal->staging + batch_size;
+        uint64_t offset = journal->segment_size;
+        for (int k = i; k < end; k++) {
+            uint32_t len = (uint32_t)lens[k];
+            uint32_t crc = hash_crc32(payloads[k], lens[k]);
+
+            if (positions) positions[k] = JOURNAL_POS(journal->segment_id, offset);
+            uint32_t record_offset = (uint32_t)offset;
+            memcpy(offsets + (size_t)(k - i) * sizeof(uint32_t), &record_offset, sizeof(uint32_t));
+
+            memcpy(p, &len, 4);
+            memcpy(p + 4, &crc, 4);
+            memcpy(p + JOURNAL_RECORD_HEADER, payloads[k], lens[k]);
+            memcpy(p + JOURNAL_RECORD_HEADER + lens[k], &len, 4);
+
+            p += JOURNAL_RECORD_OVERHEAD + lens[k];
+            offset += JOURNAL_RECORD_OVERHEAD + lens[k];
+        }
+
+        if (write_records(journal, journal->staging, batch_size, offsets, end - i) != 0) {
+            return -1;
+        }
+
+        journal->segment_size += batch_size;
+        journal->record_count += (uint64_t)(end - i);
+        i = end;
+    }
+
+    return 0;
+}
+
+// Leitura
+
+JournalReader* journal_reader_open(const char* dir) {
+    if (!dir) return NULL;
+
+    uint32_t* ids;
+    int count;
+    if (journal_list_segments(dir, &ids, &count) != 0) {
+        return NULL;
+    }
+
+    JournalReader* reader = (JournalReader*)safe_malloc(sizeof(JournalReader));
+    memset(reader, 0, sizeof(JournalReader));
+    strncpy(reader->dir, dir, sizeof(reader->dir) - 1);
+
+    reader->segment_count = count;
+    reader->segments = (ReaderSegment*)safe_malloc((count ? count : 1) * sizeof(ReaderSegment));
+    memset(reader->segments, 0, (count ? count : 1) * sizeof(ReaderSegment));
+    for (int i = 0; i < count; i++) {
+        reader->segments[i].id = ids[i];
+    }
+    safe_free(ids);
+
+    return reader;
+}
+
+void journal_reader_close(JournalReader* reader) {
+    if (!reader) return;
+
+    for (int i = 0; i < reader->segment_count; i++) {
+        if (reader->segments[i].data) {
+            munmap((void*)reader->segments[i].data, reader->segments[i].size);
+        }
+        if (reader->segments[i].offsets_size) {
+            munmap((void*)reader->segments[i].offsets, reader->segments[i].offsets_size);
+        } else {
+            safe_free((void*)reader->segments[i].offsets);
+        }
+    }
+    safe_free(reader->segments);
+    safe_free(reader);
+}
+
+// Mapeia o segmento no primeiro acesso; retorna NULL se estiver vazio ou inválido
+static ReaderSegment* reader_segment(JournalReader* reader, int index) {
+    if (index < 0 || index >= reader->segment_count) return NULL;
+
+    ReaderSegment* seg = &reader->segments[index];
+    if (seg->invalid) return NULL;
+    if (seg->data) return seg;
+
+    char path[600];
+    journal_segment_path(reader->dir, seg->id, path, sizeof(path));
+
+    seg->data = map_file(path, &seg->size);
+    if (!seg->data) {
+        seg->invalid = 1;
+        return NULL;
+    }
+
+    JournalSegmentHeader header;
+    if (header_validate(seg->data, seg->size, seg->id, &header) != 0) {
+        log_message(LOG_WARNING, "Skipping journal segment with invalid header: %s", path);
+        munmap((void*)seg->data, seg->size);
+        seg->data = NULL;
+        seg->invalid = 1;
+        return NULL;
+    }
+
+    seg->base_count = header.base_count;
+    return seg;
+}
+
+// Fim do último registro válido; normalmente confirmado apenas pelo registro final
+static size_t segment_valid_end(ReaderSegment* seg) {
+    if (seg->valid_end) return seg->valid_end;
+
+    size_t end = seg->size;
+    if (end >= sizeof(JournalSegmentHeader) + JOURNAL_RECORD_OVERHEAD) {
+        uint32_t len;
+        memcpy(&len, seg->data + end - JOURNAL_RECORD_TRAILER, 4);
+        size_t record_size = JOURNAL_RECORD_OVERHEAD + (size_t)len;
+        if (len <= JOURNAL_MAX_RECORD && record_size <= end - sizeof(JournalSegmentHeader) &&
+            record_validate(seg->data, end, end - record_size) == record_size) {
+            seg->valid_end = end;
+            return end;
+        }
+    } else if (end == sizeof(JournalSegmentHeader)) {
+        seg->valid_end = end;
+        return end;
+    }
+
+    // Cauda incompleta (escrita em andamento ou falha): varrer o segmento
+    seg->valid_end = scan_valid_end(seg->data, seg->size, NULL);
+    return seg->valid_end;
+}
+
+int journal_reader_end(JournalReader* reader, JournalPos* end, uint64_t* count) {
+    if (!reader) return -1;
+
+    for (int i = reader->segment_count - 1; i >= 0; i--) {
+        ReaderSegment* seg = reader_segment(reader, i);
+        if (!seg) continue;
+
+        // Contagem estrutural (sem CRC) dos registros do último segmento
+        size_t valid_end = segment_valid_end(seg);
+        size_t offset = sizeof(JournalSegmentHeader);
+        uint64_t records = 0;
+        while (offset < valid_end) {
+            uint32_t len;
+            memcpy(&len, seg->data + offset, 4);
+            offset += JOURNAL_RECORD_OVERHEAD + (size_t)len;
+            records++;
+        }
+
+        if (end) *end = JOURNAL_POS(seg->id, valid_end);
+        if (count) *count = seg->base_count + records;
+        return 0;
+    }
+
+    if (end) *end = 0;
+    if (count) *count = 0;
+    return 0;
+}
+
+uint64_t journal_reader_count(JournalReader* reader) {
+    uint64_t count = 0;
+    journal_reader_end(reader, NULL, &count);
+    return count;
+}
+
+static int find_segment_index(JournalReader* reader, uint32_t segment_id) {
+    int lo = 0, hi = reader->segment_count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        uint32_t id = reader->segments[mid].id;
+        if (id == segment_id) return mid;
+        if (id < segment_id) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return -1;
+}
+
+static void fill_record(ReaderSegment* seg, size_t offset, JournalRecord* record) {
+    uint32_t len;
+    memcpy(&len, seg->data + offset, 4);
+    record->payload = seg->data + offset + JOURNAL_RECORD_HEADER;
+    record->length = len;
+    record->pos = JOURNAL_POS(seg->id, offset);
+}
+
+// Offsets do segmento: o arquivo .off é mapeado no primeiro acesso. No segmento ativo
+// ele pode estar atrás do journal (ou faltar em segmentos antigos); nesse caso a tabela
+// é completada em memória uma única vez. Cada entrada ainda é validada no uso.
+static void segment_load_offsets(JournalReader* reader, ReaderSegment* seg) {
+    if (seg->offsets_loaded) return;
+    seg->offsets_loaded = 1;
+
+    char path[600];
+    journal_offsets_path(reader->dir, seg->id, path, sizeof(path));
+    if (!file_exists(path)) return;
+
+    seg->offsets = (const uint32_t*)map_file(path, &seg->offsets_size);
+    if (seg->offsets) {
+        seg->offset_count = seg->offsets_size / sizeof(uint32_t);
+    }
+}
+
+static void segment_complete_offsets(ReaderSegment* seg) {
+    if (seg->offsets_complete) return;
+    seg->offsets_complete = 1;
+
+    size_t valid_end = segment_valid_end(seg);
+    size_t count = seg->offset_count;
+    size_t offset = sizeof(JournalSegmentHeader);
+
+    // Descartar entradas além da cauda válida
+    while (count > 0 && seg->offsets[count - 1] >= valid_end) count--;
+    if (count > 0) {
+        uint32_t len;
+        memcpy(&len, seg->data + seg->offsets[count - 1], 4);
+        offset = seg->offsets[count - 1] + JOURNAL_RECORD_OVERHEAD + (size_t)len;
+    }
+    if (offset >= valid_end && count == seg->offset_count) return;
+
+    size_t capacity = count + 1024;
+    uint32_t* offsets = (uint32_t*)safe_malloc(capacity * sizeof(uint32_t));
+    if (count > 0) memcpy(offsets, seg->offsets, count * sizeof(uint32_t));
+
+    while (offset < valid_end) {
+        if (count == capacity) {
+            capacity *= 2;
+            offsets = (uint32_t*)safe_realloc(offsets, capacity * sizeof(uint32_t));
+        }
+        uint32_t len;
+        memcpy(&len, seg->data + offset, 4);
+        offsets[count++] = (uint32_t)offset;
+        offset += JOURNAL_RECORD_OVERHEAD + (size_t)len;
+    }
+
+    if (seg->offsets) munmap((void*)seg->offsets, seg->offsets_size);
+    seg->offsets = offsets;
+    seg->offsets_size = 0;
+    seg->offset_count = count;
+}
+
+// Segmento que contém o registro de número `seq` (base_count < seq <= base_count + registros)
+static int find_segment_for_seq(JournalReader* reader, uint64_t seq) {
+    int lo = 0, hi = reader->segment_count - 1, found = -1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        ReaderSegment* seg = reader_segment(reader, mid);
+        if (!seg) {
+            // Segmento inválido no meio: recorrer à busca linear
+            for (int i = reader->segment_count - 1; i >= 0; i--) {
+                seg = reader_segment(reader, i);
+                if (seg && seg->base_count < seq) return i;
+            }
+            return -1;
+        }
+        if (seg->base_count < seq) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+int journal_reader_get_seq(JournalReader* reader, uint64_t seq, JournalRecord* record) {
+    if (!reader || !record || seq == 0) return -1;
+
+    ReaderSegment* seg = reader_segment(reader, find_segment_for_seq(reader, seq));
+    if (!seg) return -1;
+
+    uint64_t index = seq - 1 - seg->base_count;
+    size_t valid_end = segment_valid_end(seg);
+    segment_load_offsets(reader, seg);
+
+    if (index >= seg->offset_count) segment_complete_offsets(seg);
+    if (index >= seg->offset_count) return -1;
+
+    size_t offset = seg->offsets[index];
+    if (offset < sizeof(JournalSegmentHeader) || offset >= valid_end ||
+        record_validate(seg->data, valid_end, offset) == 0) {
+        return -1;
+    }
+
+    fill_record(seg, offset, record);
+    return 0;
+}
+
+uint64_t journal_reader_seq_of(JournalReader* reader, JournalPos pos) {
+    if (!reader) return 0;
+
+    ReaderSegment* seg = reader_segment(reader, find_segment_index(reader, JOURNAL_POS_SEGMENT(pos)));
+    if (!seg) return 0;
+
+    size_t target = (size_t)JOURNAL_POS_OFFSET(pos);
+    if (target < sizeof(JournalSegmentHeader) || target >= segment_valid_end(seg)) return 0;
+
+    segment_load_offsets(reader, seg);
+    if (seg->offset_count == 0 || seg->offsets[seg->offset_count - 1] < target) {
+        segment_complete_offsets(seg);
+    }
+
+    // Busca binária nos offsets (crescentes)
+    size_t lo = 0, hi = seg->offset_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (seg->offsets[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo < seg->offset_count && seg->offsets[lo] == target) {
+        return seg->base_count + lo + 1;
+    }
+    return 0;
+}
+
+int journal_reader_get(JournalReader* reader, JournalPos pos, JournalRecord* record) {
+    if (!reader || !record) return -1;
+
+    ReaderSegment* seg = reader_segment(reader, find_segment_index(reader, JOURNAL_POS_SEGMENT(pos)));
+    if (!seg) return -1;
+
+    size_t offset = (size_t)JOURNAL_POS_OFFSET(pos);
+    if (offset < sizeof(JournalSegmentHeader) || offset >= seg->size ||
+        record_validate(seg->data, seg->size, offset) == 0) {
+        return -1;
+    }
+
+    fill_record(seg, offset, record);
+    return 0;
+}
+
+int journal_cursor_first(JournalReader* reader, JournalCursor* cursor) {
+    if (!reader || !cursor) return -1;
+
+    cursor->reader = reader;
+    cursor->segment_index = 0;
+    cursor->offset = sizeof(JournalSegmentHeader);
+    return 0;
+}
+
+int journal_cursor_last(JournalReader* reader, JournalCursor* cursor) {
+    if (!reader || !cursor) return -1;
+
+    cursor->reader = reader;
+    cursor->segment_index = reader->segment_count - 1;
+    cursor->offset = SEGMENT_END;
+    return 0;
+}
+
+// Posiciona o cursor imediatamente antes do registro em pos
+int journal_cursor_seek(JournalReader* reader, JournalPos pos, JournalCursor* cursor) {
+    if (!reader || !cursor) return -1;
+
+    int index = find_segment_index(reader, JOURNAL_POS_SEGMENT(pos));
+    if (index < 0) return -1;
+
+    cursor->reader = reader;
+    cursor->segment_index = index;
+    cursor->offset = JOURNAL_POS_OFFSET(pos);
+    return 0;
+}
+
+int journal_cursor_next(JournalCursor* cursor, JournalRecord* record) {
+    if (!cursor || !cursor->reader || !record) return -1;
+
+    JournalReader* reader = cursor->reader;
+    while (cursor->segment_index < reader->segment_count) {
+        ReaderSegment* seg = reader_segment(reader, cursor->segment_index);
+        if (seg && cursor->offset != SEGMENT_END && cursor->offset < seg->size) {
+            size_t record_size = record_validate(seg->data, seg->size, (size_t)cursor->offset);
+            if (record_size > 0) {
+                fill_record(seg, (size_t)cursor->offset, record);
+                cursor->offset += record_size;
+                return 1;
+            }
+
+            if (cursor->segment_index < reader->segment_count - 1) {
+                log_message(LOG_WARNING, "Corrupted record in journal segment %u at offset %llu",
+                            seg->id, (unsigned long long)cursor->offset);
+            }
+        }
+
+        cursor->segment_index++;
+        cursor->offset = sizeof(JournalSegmentHeader);
+    }
+    return 0;
+}
+
+int journal_cursor_prev(JournalCursor* cursor, JournalRecord* record) {
+    if (!cursor || !cursor->reader || !record) return -1;
+
+    JournalReader* reader = cursor->reader;
+    while (cursor->segment_index >= 0) {
+        ReaderSegment* seg = reader_segment(reader, cursor->segment_index);
+        if (seg) {
+            size_t end = segment_valid_end(seg);
+            if (cursor->offset == SEGMENT_END || cursor->offset > end) {
+                cursor->offset = end;
+            }
+
+            size_t boundary = (size_t)cursor->offset;
+            if (boundary >= sizeof(JournalSegmentHeader) + JOURNAL_RECORD_OVERHEAD) {
+                // O comprimento repetido no final do registro leva ao seu início
+                uint32_t len;
+                memcpy(&len, seg->data + boundary - JOURNAL_RECORD_TRAILER, 4);
+                size_t record_size = JOURNAL_RECORD_OVERHEAD + (size_t)len;
+
+                if (len <= JOURNAL_MAX_RECORD &&
+                    record_size <= boundary - sizeof(JournalSegmentHeader) &&
+                    record_validate(seg->data, boundary, boundary - record_size) == record_size) {
+                    fill_record(seg, boundary - record_size, record);
+                    cursor->offset = boundary - record_size;
+                    return 1;
+                }
+
+                if (boundary > sizeof(JournalSegmentHeader)) {
+                    log_message(LOG_WARNING, "Corrupted record in journal segment %u before offset %zu",
+                                seg->id, boundary);
+                }
+            }
+        }
+
+        cursor->segment_index--;
+        cursor->offset = SEGMENT_END;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "line_index.h"
+#include "hash.h"
+#include "utils.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define LINE_INDEX_INITIAL_CAPACITY 64
+
+static void add_line(LineIndex* index, const char* start, size_t length, int with_hash) {
+    if (index->count >= index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : LINE_INDEX_INITIAL_CAPACITY;
+        index->lines = (LineView*)safe_realloc(index->lines, (size_t)index->capacity * sizeof(LineView));
+    }
+
+    LineView* line = &index->lines[index->count++];
+    line->content = start;
+    line->length = length;
+    line->hash = with_hash ? hash_bytes64(start, length, LINE_HASH_SEED) : 0;
+}
+
+int line_index_build(LineIndex* index, const char* text, size_t size, int with_hash) {
+    if (!index || (!text && size > 0)) return -1;
+
+    index->text = text;
+    index->size = size;
+    index->lines = NULL;
+    index->count = 0;
+    index->capacity = 0;
+
+    // Estimativa inicial: evita a maior parte das realocações em texto comum
+    int estimate = (int)(size / 32) + 1;
+    if (estimate > LINE_INDEX_INITIAL_CAPACITY) {
+        index->capacity = estimate;
+        index->lines = (LineView*)safe_malloc((size_t)estimate * sizeof(LineView));
+    }
+
+    const char* start = text;
+    const char* p = text;
+    const char* end = text + size;
+
+#if defined(__SSE2__)
+    // Cada bloco de 16 bytes vira uma máscara de quebras; percorrer os bits ligados
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; p + 16 <= end; p += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+        while (mask) {
+            const char* nl = p + __builtin_ctz(mask);
+            add_line(index, start, (size_t)(nl - start), with_hash);
+            start = nl + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    const char* nl;
+    while (p < end && (nl = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        add_line(index, start, (size_t)(nl - start), with_hash);
+        start = nl + 1;
+        p = nl + 1;
+    }
+
+    // Última linha (vazia quando o texto termina em '\n')
+    add_line(index, start, (size_t)(end - start), with_hash);
+    return 0;
+}
+
+void line_index_free(LineIndex* index) {
+    if (!index) return;
+    safe_free(index->lines);
+    index->lines = NULL;
+    index->count = 0;
+    index->capacity = 0;
+}
+
+int line_index_count_newlines(const char* text, size_t size) {
+    int count = 0;
+    const char* p = text;
+    const char* end = text + size;
+
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; p + 16 <= end; p += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)p);
+        count += __builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+    }
+#endif
+
+    while (p < end && (p = memchr(p, '\n', (size_t)(end - p))) != NULL) {
+        count++;
+        p++;
+    }
+    return count;
+}
@@ -2,10 +2,64 @@
 // Created by HP on 08/07/2025.
 //
 #include "log.h"
+#include "log_gc.h"
 #include "utils.h"
 #include <jansson.h>
 #include <time.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+// Importa o log.json legado (uma operação por arquivo em ops/) para o journal
+static int migrate_legacy_log(LogManager* lm) {
+    char log_file_path[600];
+    snprintf(log_file_path, sizeof(log_file_path), "%s/%s", lm->log_path, LOG_FILE);
+
+    if (!file_exists(log_file_path)) return 0;
+
+    size_t size;
+    char* log_content = file_read_all(log_file_path, &size);
+    if (!log_content) return -1;
+
+    json_error_t error;
+    json_t* log_array = json_loads(log_content, 0, &error);
+    safe_free(log_content);
+
+    if (!log_array || !json_is_array(log_array)) {
+        log_message(LOG_WARNING, "Ignoring invalid legacy log file %s", log_file_path);
+        if (log_array) json_decref(log_array);
+        return -1;
+    }
+
+    size_t migrated = 0;
+    for (size_t i = 0; i < json_array_size(log_array); i++) {
+        json_t* entry = json_array_get(log_array, i);
+        const char* op_file = json_string_value(json_object_get(entry, "file"));
+        if (!op_file) continue;
+
+        char* op_content = file_read_all(op_file, NULL);
+        if (!op_content) continue;
+
+        Operation* op = operation_deserialize(op_content);
+        safe_free(op_content);
+
+        if (op) {
+            if (log_save_operation(lm, op) == 0) migrated++;
+            operation_destroy(op);
+        }
+    }
+    json_decref(log_array);
+
+    // Manter o arquivo antigo apenas como referência
+    char migrated_path[640];
+    snprintf(migrated_path, sizeof(migrated_path), "%s.migrated", log_file_path);
+    rename(log_file_path, migrated_path);
+
+    log_message(LOG_INFO, "Migrated %zu operations from legacy log to journal", migrated);
+    return 0;
+}
 
 LogManager* log_create(const char* project_path) {
     if (!project_path) return NULL;
@@ -25,19 +79,80 @@ LogManager* log_create(const char* project_path) {
         return NULL;
     }
 
-    lm->log_file = NULL;
+    // Abrir journal (executa a recuperação do segmento ativo)
+    char journal_path[600];
+    snprintf(journal_path, sizeof(journal_path), "%s/%s", lm->log_path, JOURNAL_DIR);
+    lm->journal = journal_open(journal_path);
+    if (!lm->journal) {
+        log_message(LOG_ERROR, "Failed to open operation journal in %s", journal_path);
+        safe_free(lm);
+        return NULL;
+    }
+
+    char versions_path[600];
+    snprintf(versions_path, sizeof(versions_path), "%s/%s", lm->log_path, VERSIONS_DIR);
+    lm->snapshots = snapshot_store_open(versions_path);
+    if (!lm->snapshots) {
+        journal_close(lm->journal);
+        safe_free(lm);
+        return NULL;
+    }
+
+    // Índices por arquivo, autor e tempo (mantidos apenas pelo escritor)
+    lm->index = log_index_open(lm->journal);
+
+    if (lm->journal->record_count == 0 && !lm->journal->read_only) {
+        migrate_legacy_log(lm);
+    }
 
     log_message(LOG_INFO, "Log manager created for project: %s", project_path);
     return lm;
 }
 
+// Espelha o alocador de IDs (contagem de registros do journal) no arquivo de índice.
+// Informativo: a fonte da verdade continua sendo o journal.
+static void update_last_operation_id(LogManager* lm) {
+    char path[600], tmp_path[620];
+    snprintf(path, sizeof(path), "%s/index", lm->log_path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    size_t size;
+    char* content = file_read_all(path, &size);
+    if (!content) return;
+
+    json_error_t error;
+    json_t* index = json_loads(content, 0, &error);
+    safe_free(content);
+    if (!index || !json_is_object(index)) {
+        if (index) json_decref(index);
+        return;
+    }
+
+    json_int_t last_id = (json_int_t)lm->journal->record_count;
+    if (json_integer_value(json_object_get(index, "last_operation_id")) != last_id) {
+        json_object_set_new(index, "last_operation_id", json_integer(last_id));
+
+        char* json_str = json_dumps(index, JSON_INDENT(2));
+        if (json_str && file_write_all(tmp_path, json_str, strlen(json_str)) == 0 &&
+            rename(tmp_path, path) != 0) {
+            log_message(LOG_WARNING, "Failed to update %s: %s", path, strerror(errno));
+        }
+        free(json_str);
+    }
+    json_decref(index);
+}
+
 void log_destroy(LogManager* lm) {
     if (!lm) return;
 
-    if (lm->log_file) {
-        fclose(lm->log_file);
+    if (!lm->journal->read_only) {
+        update_last_operation_id(lm);
     }
 
+    log_index_close(lm->index);
+    snapshot_store_close(lm->snapshots);
+    journal_close(lm->journal);
+
     safe_free(lm);
 }
 
@@ -56,7 +171,7 @@ int log_init_directory(const char* project_path) {
     }
 
     // Criar subdiretórios
-    snprintf(path, sizeof(path), "%s/%s/%s", project_path, LOG_DIR, OPS_DIR);
+    snprintf(path, sizeof(path), "%s/%s/%s", project_path, LOG_DIR, JOURNAL_DIR);
     if (!dir_exists(path)) {
         if (dir_create(path) != 0 && errno != EEXIST) {
             log_message(LOG_ERROR, "Failed to create directory %s: %s", path, strerror(errno));
@@ -87,216 +202,315 @@ int log_init_directory(const char* project_path) {
         json_decref(index);
     }
 
-    // Criar arquivo de log inicial
-    snprintf(path, sizeof(path), "%s/%s/%s", project_path, LOG_DIR, LOG_FILE);
-    if (!file_exists(path)) {
-        json_t* log_array = json_array();
-        char* json_str = json_dumps(log_array, JSON_INDENT(2));
-        file_write_all(path, json_str, strlen(json_str));
-
-        free(json_str);
-        json_decref(log_array);
-    }
-
     log_message(LOG_INFO, "Initialized version control in %s", project_path);
     return 0;
 }
 
 int log_save_operation(LogManager* lm, const Operation* op) {
     if (!lm || !op) return -1;
+    return log_save_operations(lm, &op, 1);
+}
 
-    // Gerar ID único para a operação
-    char op_filename[512];
-    snprintf(op_filename, sizeof(op_filename), "%s/%s/%ld_%s.json",
-             lm->log_path, OPS_DIR, op->timestamp, op->author);
-
-    // Serializar operação
-    char* json_str = operation_serialize(op);
-    if (!json_str) return -1;
+int log_save_operations(LogManager* lm, const Operation* const* ops, int count) {
+    if (!lm || !ops || count <= 0) return -1;
 
-    // Salvar em arquivo
-    int result = file_write_all(op_filename, json_str, strlen(json_str));
-    free(json_str);
+    void** records = (void**)safe_malloc(count * sizeof(void*));
+    size_t* sizes = (size_t*)safe_malloc(count * sizeof(size_t));
+    const Operation** saved = (const Operation**)safe_malloc(count * sizeof(Operation*));
+    JournalPos* positions = (JournalPos*)safe_malloc(count * sizeof(JournalPos));
 
-    if (result != 0) {
-        log_message(LOG_ERROR, "Failed to save operation to %s", op_filename);
-        return -1;
+    // IDs sequenciais: o número do registro no journal (denso, nunca reutilizado)
+    int encoded = 0;
+    for (int i = 0; i < count; i++) {
+        uint64_t seq = lm->journal->record_count + 1 + (uint64_t)encoded;
+        records[encoded] = operation_encode_seq(ops[i], seq, &sizes[encoded]);
+        if (records[encoded]) saved[encoded++] = ops[i];
     }
 
-    // Atualizar log.json
-    char log_file_path[512];
-    snprintf(log_file_path, sizeof(log_file_path), "%s/%s", lm->log_path, LOG_FILE);
+    // Anexar ao journal: custo O(1) por operação, independente do tamanho do histórico
+    int result = encoded > 0
+        ? journal_append_batch(lm->journal, (const void* const*)records, sizes, encoded, positions)
+        : -1;
 
-    // Ler log existente
-    size_t size;
-    char* log_content = file_read_all(log_file_path, &size);
-    if (!log_content) {
-        log_message(LOG_ERROR, "Failed to read log file");
-        return -1;
+    // Manter os índices secundários em dia com o journal
+    if (result == 0 && lm->index) {
+        log_index_add(lm->index, (const Operation* const*)saved, positions, encoded);
     }
 
-    json_error_t error;
-    json_t* log_array = json_loads(log_content, 0, &error);
-    safe_free(log_content);
+    for (int i = 0; i < encoded; i++) {
+        safe_free(records[i]);
+    }
+    safe_free(records);
+    safe_free(sizes);
+    safe_free(saved);
+    safe_free(positions);
 
-    if (!log_array) {
-        log_message(LOG_ERROR, "Failed to parse log file: %s", error.text);
+    if (result != 0) {
+        log_message(LOG_ERROR, "Failed to append %d operations to journal", count);
         return -1;
     }
 
-    // Adicionar nova entrada
-    json_t* entry = json_object();
-    json_object_set_new(entry, "timestamp", json_integer(op->timestamp));
-    json_object_set_new(entry, "type", json_string(op->op_type));
-    json_object_set_new(entry, "author", json_string(op->author));
-    json_object_set_new(entry, "file", json_string(op_filename));
-    json_array_append_new(log_array, entry);
-
-    // Salvar log atualizado
-    char* updated_log = json_dumps(log_array, JSON_INDENT(2));
-    result = file_write_all(log_file_path, updated_log, strlen(updated_log));
-
-    free(updated_log);
-    json_decref(log_array);
+    log_message(LOG_DEBUG, "Saved %d operations to journal", encoded);
+    return 0;
+}
 
-    log_message(LOG_DEBUG, "Saved operation to %s", op_filename);
-    return result;
+int log_sync(LogManager* lm) {
+    if (!lm) return -1;
+    return journal_sync(lm->journal);
 }
 
 int log_save_snapshot(LogManager* lm, const char* filepath, const char* content) {
-    if (!lm || !filepath || !content) return -1;
+    if (!content) return -1;
+    return log_save_snapshot_n(lm, filepath, content, strlen(content), operation_clock_now());
+}
 
-    // Gerar nome único para o snapshot
-    long timestamp = time_get_unix();
-    char snapshot_filename[512];
-    snprintf(snapshot_filename, sizeof(snapshot_filename), "%s/%s/%ld_%s.snapshot",
-             lm->log_path, VERSIONS_DIR, timestamp, filepath);
+int log_save_snapshot_n(LogManager* lm, const char* filepath, const void* content, size_t size, int64_t hlc) {
+    if (!lm || !filepath || !content) return -1;
 
-    // Salvar conteúdo
-    int result = file_write_all(snapshot_filename, content, strlen(content));
+    // Endereçado por conteúdo: versões repetidas não geram bytes novos
+    unsigned char digest[HASH_SHA256_SIZE];
+    int result = snapshot_store_save(lm->snapshots, filepath, content, size, hlc, digest);
 
     if (result == 0) {
-        log_message(LOG_INFO, "Saved snapshot to %s", snapshot_filename);
+        char hex[HASH_SHA256_HEX_SIZE];
+        hash_to_hex(digest, HASH_SHA256_SIZE, hex);
+        log_message(LOG_DEBUG, "Saved snapshot of %s as %.12s", filepath, hex);
     } else {
-        log_message(LOG_ERROR, "Failed to save snapshot to %s", snapshot_filename);
+        log_message(LOG_ERROR, "Failed to save snapshot of %s", filepath);
     }
 
     return result;
 }
 
-Operation** log_load_operations(LogManager* lm, int* count) {
-    if (!lm || !count) return NULL;
-
-    *count = 0;
+char* log_load_snapshot_at(LogManager* lm, const char* filepath, long timestamp, size_t* size) {
+    if (!lm || !filepath) return NULL;
 
-    // Ler log.json
-    char log_file_path[512];
-    snprintf(log_file_path, sizeof(log_file_path), "%s/%s", lm->log_path, LOG_FILE);
+    SnapshotRef ref;
+    if (snapshot_store_resolve(lm->snapshots, filepath, timestamp, &ref) != 0) return NULL;
 
-    size_t size;
-    char* log_content = file_read_all(log_file_path, &size);
-    if (!log_content) return NULL;
+    return snapshot_store_get_object(lm->snapshots, ref.digest, size);
+}
 
-    json_error_t error;
-    json_t* log_array = json_loads(log_content, 0, &error);
-    safe_free(log_content);
+JournalReader* log_open_reader(LogManager* lm) {
+    if (!lm) return NULL;
 
-    if (!log_array || !json_is_array(log_array)) {
-        log_message(LOG_ERROR, "Invalid log file format");
-        return NULL;
+    JournalReader* reader = journal_reader_open(lm->journal->dir);
+    if (!reader) {
+        log_message(LOG_ERROR, "Failed to open operation journal");
     }
+    return reader;
+}
 
-    size_t array_size = json_array_size(log_array);
-    if (array_size == 0) {
-        json_decref(log_array);
-        return NULL;
-    }
+int log_query(LogManager* lm, JournalReader* reader, const LogQuery* query,
+              JournalPos** positions, size_t* count) {
+    if (!lm || !reader || !query) return -1;
+    return log_index_query(lm->journal->dir, reader, query, positions, count);
+}
 
-    Operation** ops = (Operation**)safe_malloc(array_size * sizeof(Operation*));
-    int op_count = 0;
+Operation** log_load_operations(LogManager* lm, int* count) {
+    if (!lm || !count) return NULL;
 
-    // Carregar cada operação
-    for (size_t i = 0; i < array_size; i++) {
-        json_t* entry = json_array_get(log_array, i);
-        const char* op_file = json_string_value(json_object_get(entry, "file"));
+    *count = 0;
 
-        if (op_file) {
-            size_t op_size;
-            char* op_content = file_read_all(op_file, &op_size);
-            if (op_content) {
-                Operation* op = operation_deserialize(op_content);
-                if (op) {
-                    ops[op_count++] = op;
-                }
-                safe_free(op_content);
-            }
+    JournalReader* reader = log_open_reader(lm);
+    if (!reader) return NULL;
+
+    Operation** ops = NULL;
+    int op_count = 0;
+    int capacity = 0;
+
+    JournalCursor cursor;
+    JournalRecord record;
+    journal_cursor_first(reader, &cursor);
+    while (journal_cursor_next(&cursor, &record) > 0) {
+        Operation* op = operation_decode(record.payload, record.length);
+        if (!op) continue;
+
+        if (op_count >= capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            ops = (Operation**)safe_realloc(ops, capacity * sizeof(Operation*));
         }
+        ops[op_count++] = op;
     }
 
-    json_decref(log_array);
+    journal_reader_close(reader);
 
     *count = op_count;
     return ops;
 }
 
-char* log_load_snapshot(LogManager* lm, const char* version_id) {
+// Conteúdo de `filepath` no manifesto de baseline do último gc
+static char* load_baseline_snapshot(LogManager* lm, const char* filepath, size_t* size) {
+    LogBaselineHeader header;
+    SnapshotRef* entries = NULL;
+    if (log_load_baseline(lm, &header, &entries) != 0) return NULL;
+
+    if (strncmp(filepath, "./", 2) == 0) filepath += 2;
+    char* content = NULL;
+    for (uint32_t i = 0; i < header.count && !content; i++) {
+        if (strncmp(entries[i].path, filepath, MAX_OP_PATH_LEN) == 0) {
+            content = snapshot_store_get_object(lm->snapshots, entries[i].digest, size);
+        }
+    }
+    safe_free(entries);
+    return content;
+}
+
+// version_id: "<caminho>", "<caminho>@<tempo>", "<caminho>@baseline" ou prefixo do
+// digest (>= 4 hex). `size` (opcional) recebe o tamanho: o conteúdo pode ser binário.
+char* log_load_snapshot(LogManager* lm, const char* version_id, size_t* size) {
     if (!lm || !version_id) return NULL;
 
-    char snapshot_path[512];
-    snprintf(snapshot_path, sizeof(snapshot_path), "%s/%s/%s",
-             lm->log_path, VERSIONS_DIR, version_id);
+    char* content = NULL;
+    unsigned char digest[HASH_SHA256_SIZE];
+
+    const char* at = strrchr(version_id, '@');
+    if (at) {
+        long timestamp;
+        char path[MAX_OP_PATH_LEN];
+        snprintf(path, sizeof(path), "%.*s", (int)(at - version_id), version_id);
+        if (strcmp(at + 1, "baseline") == 0) {
+            content = load_baseline_snapshot(lm, path, size);
+        } else if (time_parse(at + 1, &timestamp) == 0) {
+            content = log_load_snapshot_at(lm, path, timestamp, size);
+        }
+    } else if (snapshot_store_resolve_digest(lm->snapshots, version_id, digest) == 0) {
+        content = snapshot_store_get_object(lm->snapshots, digest, size);
+    } else {
+        content = log_load_snapshot_at(lm, version_id, 0, size);
+    }
 
-    size_t size;
-    char* content = file_read_all(snapshot_path, &size);
+    // Snapshots legados (<ts>_<arquivo>.snapshot)
+    if (!content) {
+        char snapshot_path[600];
+        snprintf(snapshot_path, sizeof(snapshot_path), "%s/%s/%s",
+                 lm->log_path, VERSIONS_DIR, version_id);
+        if (strstr(version_id, ".snapshot") && file_exists(snapshot_path)) {
+            content = file_read_all(snapshot_path, size);
+        }
+    }
 
     if (content) {
-        log_message(LOG_INFO, "Loaded snapshot from %s", snapshot_path);
+        log_message(LOG_DEBUG, "Loaded snapshot %s", version_id);
     }
 
     return content;
 }
 
-int log_create_checkpoint(LogManager* lm, const char* message) {
-    if (!lm || !message) return -1;
+static void checkpoint_index_path(LogManager* lm, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%s", lm->log_path, CHECKPOINT_INDEX);
+}
 
-    // Criar arquivo de checkpoint
-    long timestamp = time_get_unix();
-    char checkpoint_path[512];
-    snprintf(checkpoint_path, sizeof(checkpoint_path), "%s/%s/checkpoint_%ld.json",
-             lm->log_path, VERSIONS_DIR, timestamp);
+// Retorna 1 se existe um checkpoint, 0 se não há nenhum e -1 em erro
+int log_last_checkpoint(LogManager* lm, Checkpoint* checkpoint) {
+    if (!lm || !checkpoint) return -1;
 
-    json_t* checkpoint = json_object();
-    json_object_set_new(checkpoint, "timestamp", json_integer(timestamp));
-    json_object_set_new(checkpoint, "message", json_string(message));
-    json_object_set_new(checkpoint, "author", json_string(getenv("USER") ? getenv("USER") : "unknown"));
+    char path[600];
+    checkpoint_index_path(lm, path, sizeof(path));
 
-    // Adicionar lista de operações até este ponto
-    int op_count;
-    Operation** ops = log_load_operations(lm, &op_count);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
 
-    json_t* op_refs = json_array();
-    for (int i = 0; i < op_count; i++) {
-        char op_ref[256];
-        snprintf(op_ref, sizeof(op_ref), "%ld_%s.json", ops[i]->timestamp, ops[i]->author);
-        json_array_append_new(op_refs, json_string(op_ref));
-        operation_destroy(ops[i]);
+    // Apenas o último registro completo (um registro parcial no fim é ignorado)
+    struct stat st;
+    int found = 0;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Checkpoint)) {
+        off_t offset = (st.st_size / sizeof(Checkpoint) - 1) * sizeof(Checkpoint);
+        found = pread(fd, checkpoint, sizeof(Checkpoint), offset) == (ssize_t)sizeof(Checkpoint) ? 1 : -1;
     }
-    safe_free(ops);
+    close(fd);
+    return found;
+}
 
-    json_object_set_new(checkpoint, "operations", op_refs);
+Checkpoint* log_load_checkpoints(LogManager* lm, int* count) {
+    if (!lm || !count) return NULL;
 
-    // Salvar checkpoint
-    char* json_str = json_dumps(checkpoint, JSON_INDENT(2));
-    int result = file_write_all(checkpoint_path, json_str, strlen(json_str));
+    *count = 0;
 
-    free(json_str);
-    json_decref(checkpoint);
+    char path[600];
+    checkpoint_index_path(lm, path, sizeof(path));
+    if (!file_exists(path)) return NULL;
+
+    size_t size;
+    char* data = file_read_all(path, &size);
+    if (!data) return NULL;
+
+    *count = (int)(size / sizeof(Checkpoint));
+    return (Checkpoint*)data;
+}
+
+int log_create_checkpoint(LogManager* lm, const char* message) {
+    if (!lm || !message) return -1;
+
+    JournalReader* reader = log_open_reader(lm);
+    if (!reader) return -1;
+
+    Checkpoint checkpoint;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    checkpoint.timestamp = time_get_unix();
+    strncpy(checkpoint.author, getenv("USER") ? getenv("USER") : "unknown", MAX_AUTHOR_LEN - 1);
+    strncpy(checkpoint.message, message, CHECKPOINT_MESSAGE_LEN - 1);
+
+    JournalPos end;
+    journal_reader_end(reader, &end, &checkpoint.end_count);
+    checkpoint.end_pos = end;
+
+    // Serializar commits concorrentes (ids sequenciais e digests encadeados)
+    char path[600];
+    checkpoint_index_path(lm, path, sizeof(path));
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0 || flock(fd, LOCK_EX) != 0) {
+        log_message(LOG_ERROR, "Failed to open checkpoint index %s: %s", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        journal_reader_close(reader);
+        return -1;
+    }
+
+    Checkpoint previous;
+    int has_previous = log_last_checkpoint(lm, &previous);
+    if (has_previous < 0) {
+        log_message(LOG_ERROR, "Failed to read checkpoint index");
+        close(fd);
+        journal_reader_close(reader);
+        return -1;
+    }
+    checkpoint.id = has_previous ? previous.id + 1 : 1;
+
+    // Encadear o digest: apenas os registros desde o checkpoint anterior são lidos
+    HashSha256 ctx;
+    hash_sha256_init(&ctx);
+    if (has_previous) {
+        hash_sha256_update(&ctx, previous.digest, HASH_SHA256_SIZE);
+    }
+
+    JournalCursor cursor;
+    if (!has_previous || journal_cursor_seek(reader, previous.end_pos, &cursor) != 0) {
+        journal_cursor_first(reader, &cursor);
+    }
+
+    JournalRecord record;
+    while (journal_cursor_next(&cursor, &record) > 0 && record.pos < end) {
+        uint32_t len = (uint32_t)record.length;
+        hash_sha256_update(&ctx, &len, sizeof(len));
+        hash_sha256_update(&ctx, record.payload, record.length);
+    }
+    hash_sha256_final(&ctx, checkpoint.digest);
+    journal_reader_close(reader);
+
+    // Anexar ao índice de checkpoints
+    int result = -1;
+    if (write(fd, &checkpoint, sizeof(checkpoint)) == (ssize_t)sizeof(checkpoint) &&
+        fdatasync(fd) == 0) {
+        result = 0;
+    }
+    close(fd);
 
     if (result == 0) {
-        log_message(LOG_INFO, "Created checkpoint: %s", message);
+        log_message(LOG_INFO, "Created checkpoint %llu at operation %llu: %s",
+                    (unsigned long long)checkpoint.id, (unsigned long long)checkpoint.end_count, message);
     } else {
-        log_message(LOG_ERROR, "Failed to create checkpoint");
+        log_message(LOG_ERROR, "Failed to create checkpoint: %s", strerror(errno));
     }
 
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,511 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "log_gc.h"
+#include "log_index.h"
+#include "document.h"
+#include "utils.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+// Estado de um arquivo no gc: baseline anterior e operações compactadas agora
+typedef struct {
+    SnapshotRef ref;            // Baseline (do manifesto anterior ou resolvido agora)
+    int has_baseline;           // `ref` veio do manifesto anterior
+    int removed;                // Um "remove" foi compactado: o arquivo parte do inexistente
+    JournalPos* ops;            // Operações compactadas depois do último "remove", em ordem
+    int64_t* hlcs;
+    int op_count;
+    int op_capacity;
+} FileEntry;
+
+// Arquivos tocados pelas operações compactadas (endereçamento aberto por caminho)
+typedef struct {
+    FileEntry* entries;
+    int* slots;                 // Índice em entries + 1 (0 = vazio)
+    int count;
+    int capacity;
+    int slot_count;
+} FileSet;
+
+static void file_set_init(FileSet* set) {
+    memset(set, 0, sizeof(*set));
+    set->slot_count = 256;
+    set->slots = (int*)safe_malloc(set->slot_count * sizeof(int));
+    memset(set->slots, 0, set->slot_count * sizeof(int));
+}
+
+static void file_set_free(FileSet* set) {
+    for (int i = 0; i < set->count; i++) {
+        safe_free(set->entries[i].ops);
+        safe_free(set->entries[i].hlcs);
+    }
+    safe_free(set->entries);
+    safe_free(set->slots);
+}
+
+static void file_set_rehash(FileSet* set) {
+    set->slot_count *= 2;
+    set->slots = (int*)safe_realloc(set->slots, set->slot_count * sizeof(int));
+    memset(set->slots, 0, set->slot_count * sizeof(int));
+
+    for (int i = 0; i < set->count; i++) {
+        const char* path = set->entries[i].ref.path;
+        size_t slot = hash_bytes64(path, strlen(path), 0) & (set->slot_count - 1);
+        while (set->slots[slot]) slot = (slot + 1) & (set->slot_count - 1);
+        set->slots[slot] = i + 1;
+    }
+}
+
+static FileEntry* file_set_get(FileSet* set, const char* path, size_t len) {
+    if ((set->count + 1) * 2 > set->slot_count) file_set_rehash(set);
+
+    size_t slot = hash_bytes64(path, len, 0) & (set->slot_count - 1);
+    while (set->slots[slot]) {
+        FileEntry* entry = &set->entries[set->slots[slot] - 1];
+        if (strncmp(entry->ref.path, path, len) == 0 && entry->ref.path[len] == '\0') return entry;
+        slot = (slot + 1) & (set->slot_count - 1);
+    }
+
+    if (set->count >= set->capacity) {
+        set->capacity = set->capacity ? set->capacity * 2 : 64;
+        set->entries = (FileEntry*)safe_realloc(set->entries, set->capacity * sizeof(FileEntry));
+    }
+
+    FileEntry* entry = &set->entries[set->count++];
+    memset(entry, 0, sizeof(*entry));
+    memcpy(entry->ref.path, path, len < MAX_OP_PATH_LEN ? len : MAX_OP_PATH_LEN - 1);
+    set->slots[slot] = set->count;
+    return entry;
+}
+
+static void file_entry_add_op(FileEntry* entry, JournalPos pos, int64_t hlc) {
+    if (entry->op_count >= entry->op_capacity) {
+        entry->op_capacity = entry->op_capacity ? entry->op_capacity * 2 : 8;
+        entry->ops = (JournalPos*)safe_realloc(entry->ops, entry->op_capacity * sizeof(JournalPos));
+        entry->hlcs = (int64_t*)safe_realloc(entry->hlcs, entry->op_capacity * sizeof(int64_t));
+    }
+    entry->ops[entry->op_count] = pos;
+    entry->hlcs[entry->op_count] = hlc;
+    entry->op_count++;
+}
+
+static void baseline_path(LogManager* lm, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%s", lm->log_path, LOG_BASELINE_FILE);
+}
+
+int log_load_baseline(LogManager* lm, LogBaselineHeader* header, SnapshotRef** entries) {
+    if (!lm || !header) return -1;
+
+    memset(header, 0, sizeof(*header));
+    if (entries) *entries = NULL;
+
+    char path[600];
+    baseline_path(lm, path, sizeof(path));
+    if (!file_exists(path)) return 0;
+
+    size_t size;
+    char* data = file_read_all(path, &size);
+    if (!data) return -1;
+
+    if (size < sizeof(LogBaselineHeader) || memcmp(data, LOG_BASELINE_MAGIC, 8) != 0) {
+        log_message(LOG_ERROR, "Invalid baseline manifest %s", path);
+        safe_free(data);
+        return -1;
+    }
+    memcpy(header, data, sizeof(*header));
+
+    // Versão 1 guardava o horizonte em segundos
+    if (header->version < 2) {
+        header->horizon *= OPERATION_NS_PER_SEC;
+    }
+
+    if (sizeof(LogBaselineHeader) + (size_t)header->count * sizeof(SnapshotRef) > size) {
+        log_message(LOG_ERROR, "Truncated baseline manifest %s", path);
+        safe_free(data);
+        return -1;
+    }
+
+    if (entries && header->count > 0) {
+        *entries = (SnapshotRef*)safe_malloc(header->count * sizeof(SnapshotRef));
+        memcpy(*entries, data + sizeof(LogBaselineHeader), header->count * sizeof(SnapshotRef));
+    }
+
+    safe_free(data);
+    return 0;
+}
+
+static int compare_entries(const void* a, const void* b) {
+    return strncmp(((const SnapshotRef*)a)->path, ((const SnapshotRef*)b)->path, MAX_OP_PATH_LEN);
+}
+
+// Escrita atômica do manifesto (tmp + fsync + rename)
+static int write_baseline(LogManager* lm, LogBaselineHeader* header, SnapshotRef* entries, int count) {
+    qsort(entries, count, sizeof(SnapshotRef), compare_entries);
+
+    memcpy(header->magic, LOG_BASELINE_MAGIC, 8);
+    header->version = LOG_BASELINE_VERSION;
+    header->count = (uint32_t)count;
+
+    char path[600], tmp_path[640];
+    baseline_path(lm, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int result = -1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        size_t entries_size = (size_t)count * sizeof(SnapshotRef);
+        if (write(fd, header, sizeof(*header)) == (ssize_t)sizeof(*header) &&
+            write(fd, entries, entries_size) == (ssize_t)entries_size &&
+            fsync(fd) == 0) {
+            result = 0;
+        }
+        close(fd);
+    }
+
+    if (result != 0 || rename(tmp_path, path) != 0) {
+        log_message(LOG_ERROR, "Failed to write baseline manifest %s: %s", path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_segment_header(const char* dir, uint32_t segment_id, JournalSegmentHeader* header) {
+    char path[600];
+    journal_segment_path(dir, segment_id, path, sizeof(path));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    ssize_t n = pread(fd, header, sizeof(*header), 0);
+    close(fd);
+    return n == (ssize_t)sizeof(*header) ? 0 : -1;
+}
+
+// Maior timestamp do segmento: do run selado do índice, ou varrendo os registros
+static int64_t segment_max_timestamp(const char* dir, JournalReader* reader, uint32_t segment_id) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%010u%s", dir, segment_id, LOG_INDEX_SEALED_EXT);
+
+    LogIndexHeader index_header;
+    FILE* file = fopen(path, "rb");
+    if (file) {
+        size_t n = fread(&index_header, 1, sizeof(index_header), file);
+        fclose(file);
+        if (n == sizeof(index_header)) return index_header.max_timestamp;
+    }
+
+    int64_t max_timestamp = INT64_MIN;
+    JournalCursor cursor;
+    JournalRecord record;
+    if (journal_cursor_seek(reader, JOURNAL_POS(segment_id, sizeof(JournalSegmentHeader)), &cursor) != 0) {
+        return max_timestamp;
+    }
+    while (journal_cursor_next(&cursor, &record) > 0 && JOURNAL_POS_SEGMENT(record.pos) == segment_id) {
+        OperationView view;
+        if (operation_view(record.payload, record.length, &view) == 0 && view.timestamp > max_timestamp) {
+            max_timestamp = view.timestamp;
+        }
+    }
+    return max_timestamp;
+}
+
+static void remove_segment_files(const char* dir, uint32_t segment_id, LogGcStats* stats) {
+    char path[600];
+
+    journal_segment_path(dir, segment_id, path, sizeof(path));
+    long size = file_get_size(path);
+    if (unlink(path) == 0) {
+        stats->segments++;
+        stats->bytes += size > 0 ? (uint64_t)size : 0;
+    } else {
+        log_message(LOG_WARNING, "Failed to remove journal segment %s: %s", path, strerror(errno));
+    }
+
+    snprintf(path, sizeof(path), "%s/%010u%s", dir, segment_id, LOG_INDEX_SEALED_EXT);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/%010u%s", dir, segment_id, LOG_INDEX_PENDING_EXT);
+    unlink(path);
+    journal_offsets_path(dir, segment_id, path, sizeof(path));
+    unlink(path);
+}
+
+// Baseline de um arquivo ao fim das operações compactadas. O snapshot ancorado na
+// última delas é o caso comum; sem ele, o conteúdo é reconstruído aplicando as
+// operações restantes sobre o snapshot mais recente anterior (ou o baseline
+// anterior, ou o arquivo vazio se foi criado) e gravado como snapshot novo.
+// 1: baseline em entry->ref; 0: arquivo não existe no horizonte; -1: sem base.
+static int fold_file(LogManager* lm, JournalReader* reader, FileEntry* entry) {
+    if (entry->op_count == 0) return 0;   // Removido e não recriado
+
+    const char* path = entry->ref.path;
+    int64_t last = entry->hlcs[entry->op_count - 1];
+
+    SnapshotRef ref;
+    int has_snapshot = snapshot_store_resolve_hlc(lm->snapshots, path, last, &ref) == 0;
+    int start = -1;
+    if (has_snapshot) {
+        int64_t anchor = snapshot_ref_hlc(&ref);
+        if (anchor == last) {
+            entry->ref = ref;
+            return 1;
+        }
+        for (int i = entry->op_count - 1; i >= 0 && start < 0; i--) {
+            if (entry->hlcs[i] == anchor) start = i + 1;
+        }
+    }
+
+    // Ponto de partida da reconstrução
+    char* content = NULL;
+    size_t size = 0;
+    if (start >= 0) {
+        content = snapshot_store_get_object(lm->snapshots, ref.digest, &size);
+    } else {
+        start = 0;
+        if (entry->removed) {
+            content = str_duplicate("");
+        } else if (entry->has_baseline) {
+            content = snapshot_store_get_object(lm->snapshots, entry->ref.digest, &size);
+        } else if (has_snapshot) {
+            content = snapshot_store_get_object(lm->snapshots, ref.digest, &size);
+        }
+    }
+
+    JournalRecord record;
+    Operation* op = NULL;
+    if (!content && journal_reader_get(reader, entry->ops[0], &record) == 0 &&
+        (op = operation_decode(record.payload, record.length)) != NULL &&
+        (strcmp(op->op_type, "create") == 0 || strcmp(op->op_type, "blocks") == 0)) {
+        content = str_duplicate("");
+    }
+    operation_destroy(op);
+    if (!content) return -1;
+
+    Document doc;
+    document_init(&doc, content, size);
+    int status = 0;
+    for (int i = start; i < entry->op_count && status == 0; i++) {
+        op = NULL;
+        if (journal_reader_get(reader, entry->ops[i], &record) != 0 ||
+            (op = operation_decode(record.payload, record.length)) == NULL ||
+            document_apply(&doc, op) != 0) {
+            log_message(LOG_WARNING, "Operation at %llu does not replay on %s",
+                        (unsigned long long)entry->ops[i], path);
+            status = -1;
+        }
+        operation_destroy(op);
+    }
+
+    unsigned char digest[HASH_SHA256_SIZE];
+    if (status == 0) {
+        const char* text = document_text(&doc, &size);
+        status = snapshot_store_save(lm->snapshots, path, text, size, last, digest);
+    }
+    document_free(&doc);
+    if (status != 0) return -1;
+
+    entry->ref.timestamp = last;
+    memcpy(entry->ref.digest, digest, HASH_SHA256_SIZE);
+    log_message(LOG_INFO, "Rebuilt baseline of %s from %d operations", path, entry->op_count - start);
+    return 1;
+}
+
+// Remove o diretório ops/ do formato legado, já importado para o journal
+static void remove_legacy_ops(LogManager* lm) {
+    char migrated[600], ops_dir[600];
+    snprintf(migrated, sizeof(migrated), "%s/%s.migrated", lm->log_path, LOG_FILE);
+    snprintf(ops_dir, sizeof(ops_dir), "%s/%s", lm->log_path, OPS_DIR);
+    if (!file_exists(migrated) || !dir_exists(ops_dir)) return;
+
+    DIR* dir = opendir(ops_dir);
+    if (!dir) return;
+
+    struct dirent* entry;
+    int removed = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+
+        char path[900];
+        snprintf(path, sizeof(path), "%s/%s", ops_dir, entry->d_name);
+        if (unlink(path) == 0) removed++;
+    }
+    closedir(dir);
+    rmdir(ops_dir);
+
+    log_message(LOG_INFO, "Removed %d legacy operation files", removed);
+}
+
+int log_gc(LogManager* lm, const LogGcOptions* options, LogGcStats* stats) {
+    if (!lm || !options) return -1;
+
+    LogGcStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    // Horizonte: checkpoint (posição no journal) e/ou instante
+    JournalPos horizon_pos = UINT64_MAX;
+    long horizon_time = options->before;
+
+    if (options->checkpoint_id || !options->before) {
+        int count;
+        Checkpoint* checkpoints = log_load_checkpoints(lm, &count);
+        const Checkpoint* checkpoint = NULL;
+        for (int i = 0; i < count; i++) {
+            if (checkpoints[i].id == options->checkpoint_id || (!options->checkpoint_id && i == count - 1)) {
+                checkpoint = &checkpoints[i];
+            }
+        }
+
+        if (!checkpoint) {
+            log_message(LOG_ERROR, options->checkpoint_id ? "Checkpoint %llu not found"
+                                                          : "No checkpoint to compact up to",
+                        (unsigned long long)options->checkpoint_id);
+            safe_free(checkpoints);
+            return -1;
+        }
+        horizon_pos = checkpoint->end_pos;
+        safe_free(checkpoints);
+    }
+
+    // Um gc por vez; o escritor do journal não é bloqueado
+    char lock_path[600];
+    snprintf(lock_path, sizeof(lock_path), "%s/%s", lm->log_path, LOG_GC_LOCK);
+    int lock_fd = open(lock_path, O_RDWR | O_CREAT, 0644);
+    if (lock_fd < 0 || flock(lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        log_message(LOG_ERROR, "Another gc is running");
+        if (lock_fd >= 0) close(lock_fd);
+        return -1;
+    }
+
+    const char* dir = lm->journal->dir;
+    uint32_t* ids;
+    int segment_count;
+    JournalReader* reader = log_open_reader(lm);
+    if (!reader || journal_list_segments(dir, &ids, &segment_count) != 0) {
+        journal_reader_close(reader);
+        close(lock_fd);
+        return -1;
+    }
+
+    // Prefixo de segmentos selados inteiramente antes do horizonte
+    // (o último segmento é o ativo do escritor e nunca é compactado)
+    int eligible = 0;
+    while (eligible < segment_count - 1) {
+        uint32_t id = ids[eligible];
+        JournalPos segment_end = JOURNAL_POS(ids[eligible + 1], 0);
+        if (segment_end > horizon_pos) break;
+        if (horizon_time && segment_max_timestamp(dir, reader, id) > horizon_time) break;
+        eligible++;
+    }
+
+    if (eligible == 0) {
+        log_message(LOG_INFO, "Nothing to compact");
+        journal_reader_close(reader);
+        safe_free(ids);
+        close(lock_fd);
+        return 0;
+    }
+
+    // Arquivos tocados pelas operações compactadas, com as posições delas no journal
+    FileSet files;
+    file_set_init(&files);
+
+    LogBaselineHeader header;
+    SnapshotRef* previous = NULL;
+    log_load_baseline(lm, &header, &previous);
+    for (uint32_t i = 0; i < header.count; i++) {
+        FileEntry* entry = file_set_get(&files, previous[i].path, strlen(previous[i].path));
+        entry->ref = previous[i];
+        entry->has_baseline = 1;
+    }
+    safe_free(previous);
+
+    int64_t folded_until = header.horizon;
+    JournalCursor cursor;
+    JournalRecord record;
+    journal_cursor_seek(reader, JOURNAL_POS(ids[0], sizeof(JournalSegmentHeader)), &cursor);
+    while (journal_cursor_next(&cursor, &record) > 0 && JOURNAL_POS_SEGMENT(record.pos) < ids[eligible]) {
+        OperationView view;
+        if (operation_view(record.payload, record.length, &view) != 0) continue;
+
+        stats->operations++;
+        if (view.hlc > folded_until) folded_until = view.hlc;
+        if (view.filepath_len == 0) continue;
+
+        FileEntry* entry = file_set_get(&files, view.filepath, view.filepath_len);
+        if (view.op_type_len == 6 && strncmp(view.op_type, "remove", 6) == 0) {
+            entry->removed = 1;
+            entry->op_count = 0;
+            continue;
+        }
+        file_entry_add_op(entry, record.pos, view.hlc);
+    }
+
+    // Baseline de cada arquivo tocado: o conteúdo depois da sua última operação compactada
+    SnapshotRef* baselines = (SnapshotRef*)safe_malloc((files.count ? files.count : 1) * sizeof(SnapshotRef));
+    int kept = 0;
+    for (int i = 0; i < files.count; i++) {
+        FileEntry* entry = &files.entries[i];
+        if (entry->removed || entry->op_count > 0) {
+            int status = fold_file(lm, reader, entry);
+            if (status == 0) continue;
+            if (status < 0) {
+                log_message(options->force ? LOG_WARNING : LOG_ERROR,
+                            "No baseline of %s at the compaction horizon", entry->ref.path);
+                stats->missing++;
+                continue;
+            }
+        }
+        baselines[kept++] = entry->ref;
+    }
+    file_set_free(&files);
+
+    if (stats->missing > 0 && !options->force) {
+        log_message(LOG_ERROR, "Refusing to compact: %d files have no baseline snapshot (use --force)",
+                    stats->missing);
+        safe_free(baselines);
+        journal_reader_close(reader);
+        safe_free(ids);
+        close(lock_fd);
+        return -1;
+    }
+
+    // 1. Manifesto de baseline (atômico); 2. só então remover os segmentos.
+    // Uma falha entre os dois passos deixa segmentos já cobertos, removidos no próximo gc.
+    JournalSegmentHeader first_kept;
+    if (read_segment_header(dir, ids[eligible], &first_kept) != 0) {
+        safe_free(baselines);
+        journal_reader_close(reader);
+        safe_free(ids);
+        close(lock_fd);
+        return -1;
+    }
+
+    header.first_pos = JOURNAL_POS(ids[eligible], sizeof(JournalSegmentHeader));
+    header.folded_count = first_kept.base_count;
+    header.horizon = folded_until;
+    stats->files = kept;
+
+    int result = write_baseline(lm, &header, baselines, kept);
+    safe_free(baselines);
+    journal_reader_close(reader);
+
+    if (result == 0) {
+        for (int i = 0; i < eligible; i++) {
+            remove_segment_files(dir, ids[i], stats);
+        }
+        remove_legacy_ops(lm);
+
+        log_message(LOG_INFO, "Compacted %llu operations from %d segments into a baseline of %d files",
+                    (unsigned long long)stats->operations, stats->segments, stats->files);
+    }
+
+    safe_free(ids);
+    close(lock_fd);
+    return result;
+}
@@ -0,0 +1,539 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "log_index.h"
+#include "hash.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define LOG_INDEX_MAGIC "MYVCIDX1"
+#define AUTHOR_SEED 0x61757468ULL
+#define FILE_SEED 0x66696c65ULL
+
+struct LogIndex {
+    char dir[512];
+    int fd;                 // .pidx do segmento ativo
+    uint32_t segment_id;    // Segmento ativo sendo indexado
+};
+
+// Vetor dinâmico de entradas
+typedef struct {
+    LogIndexEntry* items;
+    size_t count;
+    size_t capacity;
+} EntryList;
+
+static void entry_list_push(EntryList* list, const LogIndexEntry* entry) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->items = (LogIndexEntry*)safe_realloc(list->items, list->capacity * sizeof(LogIndexEntry));
+    }
+    list->items[list->count++] = *entry;
+}
+
+uint64_t log_index_author_key(const char* author, size_t len) {
+    return hash_bytes64(author, len, AUTHOR_SEED);
+}
+
+uint64_t log_index_file_key(const char* filepath, size_t len) {
+    // Mesma normalização de operation_set_file
+    if (len >= 2 && filepath[0] == '.' && filepath[1] == '/') {
+        filepath += 2;
+        len -= 2;
+    }
+    return hash_bytes64(filepath, len, FILE_SEED);
+}
+
+static void index_path(const char* dir, uint32_t segment_id, const char* ext, char* out, size_t out_size) {
+    snprintf(out, out_size, "%s/%010u%s", dir, segment_id, ext);
+}
+
+static void entry_from_view(const OperationView* view, JournalPos pos, LogIndexEntry* entry) {
+    entry->timestamp = view->timestamp;
+    entry->author_key = log_index_author_key(view->author, view->author_len);
+    entry->file_key = log_index_file_key(view->filepath, view->filepath_len);
+    entry->pos = pos;
+}
+
+static void entry_from_op(const Operation* op, JournalPos pos, LogIndexEntry* entry) {
+    entry->timestamp = op->timestamp;
+    entry->author_key = log_index_author_key(op->author, strlen(op->author));
+    entry->file_key = log_index_file_key(op->filepath, strlen(op->filepath));
+    entry->pos = pos;
+}
+
+// Indexa os registros do segmento a partir de `after` (exclusivo; 0 = desde o início)
+static void collect_segment_entries(JournalReader* reader, uint32_t segment_id, JournalPos after,
+                                    EntryList* list) {
+    JournalCursor cursor;
+    JournalPos start = after ? after : JOURNAL_POS(segment_id, sizeof(JournalSegmentHeader));
+    if (journal_cursor_seek(reader, start, &cursor) != 0) return;
+
+    JournalRecord record;
+    if (after && journal_cursor_next(&cursor, &record) <= 0) return;
+
+    while (journal_cursor_next(&cursor, &record) > 0) {
+        if (JOURNAL_POS_SEGMENT(record.pos) != segment_id) break;
+
+        OperationView view;
+        if (operation_view(record.payload, record.length, &view) != 0) continue;
+
+        LogIndexEntry entry;
+        entry_from_view(&view, record.pos, &entry);
+        entry_list_push(list, &entry);
+    }
+}
+
+static int load_pending(const char* dir, uint32_t segment_id, EntryList* list) {
+    char path[600];
+    index_path(dir, segment_id, LOG_INDEX_PENDING_EXT, path, sizeof(path));
+
+    size_t size;
+    char* data = file_read_all(path, &size);
+    if (!data) return -1;
+
+    size_t n = size / sizeof(LogIndexEntry);
+    for (size_t i = 0; i < n; i++) {
+        LogIndexEntry entry;
+        memcpy(&entry, data + i * sizeof(LogIndexEntry), sizeof(LogIndexEntry));
+        entry_list_push(list, &entry);
+    }
+    safe_free(data);
+    return 0;
+}
+
+static int compare_keys(const void* a, const void* b) {
+    const LogIndexKey* x = (const LogIndexKey*)a;
+    const LogIndexKey* y = (const LogIndexKey*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+static int compare_time_keys(const void* a, const void* b) {
+    const LogIndexKey* x = (const LogIndexKey*)a;
+    const LogIndexKey* y = (const LogIndexKey*)b;
+    if (x->key != y->key) return (int64_t)x->key < (int64_t)y->key ? -1 : 1;
+    return (x->pos > y->pos) - (x->pos < y->pos);
+}
+
+// Gera o run ordenado de um segmento selado (escrita atômica via rename)
+static int build_sealed(const char* dir, uint32_t segment_id, const EntryList* list) {
+    size_t n = list->count;
+
+    LogIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_INDEX_MAGIC, 8);
+    header.version = LOG_INDEX_VERSION;
+    header.segment_id = segment_id;
+    header.count = n;
+    header.min_timestamp = n ? list->items[0].timestamp : 0;
+    header.max_timestamp = header.min_timestamp;
+
+    size_t runs_size = 3 * n * sizeof(LogIndexKey);
+    LogIndexKey* runs = (LogIndexKey*)safe_malloc(runs_size ? runs_size : 1);
+    LogIndexKey* by_time = runs;
+    LogIndexKey* by_author = runs + n;
+    LogIndexKey* by_file = runs + 2 * n;
+
+    for (size_t i = 0; i < n; i++) {
+        const LogIndexEntry* e = &list->items[i];
+        if (e->timestamp < header.min_timestamp) header.min_timestamp = e->timestamp;
+        if (e->timestamp > header.max_timestamp) header.max_timestamp = e->timestamp;
+
+        by_time[i].key = (uint64_t)e->timestamp;
+        by_time[i].pos = e->pos;
+        by_author[i].key = e->author_key;
+        by_author[i].pos = e->pos;
+        by_file[i].key = e->file_key;
+        by_file[i].pos = e->pos;
+    }
+
+    qsort(by_time, n, sizeof(LogIndexKey), compare_time_keys);
+    qsort(by_author, n, sizeof(LogIndexKey), compare_keys);
+    qsort(by_file, n, sizeof(LogIndexKey), compare_keys);
+
+    char path[600], tmp_path[640];
+    index_path(dir, segment_id, LOG_INDEX_SEALED_EXT, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    int result = -1;
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        if (write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+            write(fd, runs, runs_size) == (ssize_t)runs_size &&
+            fdatasync(fd) == 0) {
+            result = 0;
+        }
+        close(fd);
+    }
+    safe_free(runs);
+
+    if (result != 0 || rename(tmp_path, path) != 0) {
+        log_message(LOG_ERROR, "Failed to write log index %s: %s", path, strerror(errno));
+        unlink(tmp_path);
+        return -1;
+    }
+
+    char pending_path[600];
+    index_path(dir, segment_id, LOG_INDEX_PENDING_EXT, pending_path, sizeof(pending_path));
+    unlink(pending_path);
+
+    log_message(LOG_DEBUG, "Sealed log index for segment %u (%zu entries)", segment_id, n);
+    return 0;
+}
+
+static int seal_segment(const char* dir, uint32_t segment_id) {
+    EntryList list = {0};
+    load_pending(dir, segment_id, &list);
+    int result = build_sealed(dir, segment_id, &list);
+    safe_free(list.items);
+    return result;
+}
+
+static int open_pending(LogIndex* index, uint32_t segment_id) {
+    char path[600];
+    index_path(index->dir, segment_id, LOG_INDEX_PENDING_EXT, path, sizeof(path));
+
+    index->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (index->fd < 0) {
+        log_message(LOG_ERROR, "Failed to open log index %s: %s", path, strerror(errno));
+        return -1;
+    }
+    index->segment_id = segment_id;
+    return 0;
+}
+
+static int write_entries(LogIndex* index, const LogIndexEntry* entries, size_t n) {
+    size_t size = n * sizeof(LogIndexEntry);
+    if (write(index->fd, entries, size) != (ssize_t)size) {
+        log_message(LOG_ERROR, "Failed to append to log index: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+// Recupera o índice após uma falha: sela segmentos antigos e completa o ativo
+static void reconcile(LogIndex* index, Journal* journal) {
+    uint32_t* ids;
+    int count;
+    if (journal_list_segments(index->dir, &ids, &count) != 0) return;
+
+    JournalReader* reader = journal_reader_open(index->dir);
+    if (!reader) {
+        safe_free(ids);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        char path[600];
+        index_path(index->dir, ids[i], LOG_INDEX_SEALED_EXT, path, sizeof(path));
+        if (ids[i] == journal->segment_id || file_exists(path)) continue;
+
+        EntryList list = {0};
+        collect_segment_entries(reader, ids[i], 0, &list);
+        build_sealed(index->dir, ids[i], &list);
+        safe_free(list.items);
+    }
+
+    // Segmento ativo: descartar entrada parcial e indexar registros que faltam
+    char pending_path[600];
+    index_path(index->dir, journal->segment_id, LOG_INDEX_PENDING_EXT, pending_path, sizeof(pending_path));
+    long size = file_exists(pending_path) ? file_get_size(pending_path) : 0;
+    if (size % (long)sizeof(LogIndexEntry) != 0) {
+        size -= size % (long)sizeof(LogIndexEntry);
+        if (truncate(pending_path, size) != 0) {
+            log_message(LOG_WARNING, "Failed to truncate log index %s", pending_path);
+        }
+    }
+
+    JournalPos last = 0;
+    if (size > 0) {
+        EntryList pending = {0};
+        load_pending(index->dir, journal->segment_id, &pending);
+        if (pending.count > 0) last = pending.items[pending.count - 1].pos;
+        safe_free(pending.items);
+    }
+
+    EntryList missing = {0};
+    collect_segment_entries(reader, journal->segment_id, last, &missing);
+    if (missing.count > 0) {
+        log_message(LOG_INFO, "Indexing %zu operations missing from the log index", missing.count);
+        write_entries(index, missing.items, missing.count);
+    }
+    safe_free(missing.items);
+
+    journal_reader_close(reader);
+    safe_free(ids);
+}
+
+LogIndex* log_index_open(Journal* journal) {
+    if (!journal || journal->read_only) return NULL;
+
+    LogIndex* index = (LogIndex*)safe_malloc(sizeof(LogIndex));
+    memset(index, 0, sizeof(LogIndex));
+    snprintf(index->dir, sizeof(index->dir), "%s", journal->dir);
+
+    if (open_pending(index, journal->segment_id) != 0) {
+        safe_free(index);
+        return NULL;
+    }
+
+    reconcile(index, journal);
+    return index;
+}
+
+void log_index_close(LogIndex* index) {
+    if (!index) return;
+    if (index->fd >= 0) close(index->fd);
+    safe_free(index);
+}
+
+int log_index_add(LogIndex* index, const Operation* const* ops, const JournalPos* positions, int count) {
+    if (!index || !ops || !positions || count <= 0) return -1;
+
+    LogIndexEntry* entries = (LogIndexEntry*)safe_malloc(count * sizeof(LogIndexEntry));
+    int result = 0;
+    int start = 0;
+
+    while (start < count) {
+        uint32_t segment_id = JOURNAL_POS_SEGMENT(positions[start]);
+
+        // O journal rotacionou: selar o run do segmento anterior
+        if (segment_id != index->segment_id) {
+            close(index->fd);
+            index->fd = -1;
+            seal_segment(index->dir, index->segment_id);
+            if (open_pending(index, segment_id) != 0) {
+                result = -1;
+                break;
+            }
+        }
+
+        int n = 0;
+        while (start + n < count && JOURNAL_POS_SEGMENT(positions[start + n]) == segment_id) {
+            entry_from_op(ops[start + n], positions[start + n], &entries[n]);
+            n++;
+        }
+
+        if (write_entries(index, entries, n) != 0) {
+            result = -1;
+        }
+        start += n;
+    }
+
+    safe_free(entries);
+    return result;
+}
+
+// Consulta
+
+static size_t lower_bound(const LogIndexKey* keys, size_t n, uint64_t key, int signed_keys) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int less = signed_keys ? (int64_t)keys[mid].key < (int64_t)key : keys[mid].key < key;
+        if (less) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static size_t upper_bound(const LogIndexKey* keys, size_t n, uint64_t key, int signed_keys) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int less_eq = signed_keys ? (int64_t)keys[mid].key <= (int64_t)key : keys[mid].key <= key;
+        if (less_eq) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+typedef struct {
+    JournalPos* items;
+    size_t count;
+    size_t capacity;
+} PosList;
+
+static void pos_list_push(PosList* list, JournalPos pos) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->items = (JournalPos*)safe_realloc(list->items, list->capacity * sizeof(JournalPos));
+    }
+    list->items[list->count++] = pos;
+}
+
+// Confere o registro contra todos os filtros (resolve colisões de hash)
+static int record_matches(JournalReader* reader, JournalPos pos, const LogQuery* query) {
+    JournalRecord record;
+    OperationView view;
+    if (journal_reader_get(reader, pos, &record) != 0 ||
+        operation_view(record.payload, record.length, &view) != 0) {
+        return 0;
+    }
+
+    if (query->since && view.timestamp < query->since) return 0;
+    if (query->until && view.timestamp > query->until) return 0;
+
+    if (query->author) {
+        size_t len = strlen(query->author);
+        if (len != view.author_len || memcmp(query->author, view.author, len) != 0) return 0;
+    }
+
+    if (query->file) {
+        const char* file = query->file;
+        if (strncmp(file, "./", 2) == 0) file += 2;
+        size_t len = strlen(file);
+        if (len != view.filepath_len || memcmp(file, view.filepath, len) != 0) return 0;
+    }
+
+    return 1;
+}
+
+// Segmento selado: escolher o filtro mais seletivo via busca binária nos runs
+static int query_sealed(const char* path, JournalReader* reader, const LogQuery* query,
+                        uint64_t author_key, uint64_t file_key, PosList* out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LogIndexHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+
+    LogIndexHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, LOG_INDEX_MAGIC, 8) != 0 ||
+        sizeof(LogIndexHeader) + 3 * header.count * sizeof(LogIndexKey) > (size_t)st.st_size) {
+        munmap(data, (size_t)st.st_size);
+        return -1;
+    }
+
+    // Poda pelo intervalo de tempo do segmento
+    if ((query->since && header.max_timestamp < query->since) ||
+        (query->until && header.min_timestamp > query->until)) {
+        munmap(data, (size_t)st.st_size);
+        return 0;
+    }
+
+    size_t n = header.count;
+    const LogIndexKey* runs = (const LogIndexKey*)((const char*)data + sizeof(LogIndexHeader));
+
+    const LogIndexKey* best = runs;
+    size_t best_lo = 0, best_hi = n;
+
+    if (query->since || query->until) {
+        size_t lo = query->since ? lower_bound(runs, n, (uint64_t)query->since, 1) : 0;
+        size_t hi = query->until ? upper_bound(runs, n, (uint64_t)query->until, 1) : n;
+        if (hi < lo) hi = lo;
+        best = runs;
+        best_lo = lo;
+        best_hi = hi;
+    }
+
+    if (query->author) {
+        const LogIndexKey* keys = runs + n;
+        size_t lo = lower_bound(keys, n, author_key, 0);
+        size_t hi = upper_bound(keys, n, author_key, 0);
+        if (hi - lo < best_hi - best_lo) {
+            best = keys;
+            best_lo = lo;
+            best_hi = hi;
+        }
+    }
+
+    if (query->file) {
+        const LogIndexKey* keys = runs + 2 * n;
+        size_t lo = lower_bound(keys, n, file_key, 0);
+        size_t hi = upper_bound(keys, n, file_key, 0);
+        if (hi - lo < best_hi - best_lo) {
+            best = keys;
+            best_lo = lo;
+            best_hi = hi;
+        }
+    }
+
+    for (size_t i = best_lo; i < best_hi; i++) {
+        if (record_matches(reader, best[i].pos, query)) {
+            pos_list_push(out, best[i].pos);
+        }
+    }
+
+    munmap(data, (size_t)st.st_size);
+    return 0;
+}
+
+// Segmento sem run ordenado (ativo): filtrar as entradas pendentes
+static void query_pending(const char* dir, JournalReader* reader, uint32_t segment_id,
+                          const LogQuery* query, uint64_t author_key, uint64_t file_key, PosList* out) {
+    EntryList list = {0};
+    load_pending(dir, segment_id, &list);
+
+    // Registros escritos depois da última entrada pendente (ou segmento nunca indexado)
+    JournalPos last = list.count ? list.items[list.count - 1].pos : 0;
+    collect_segment_entries(reader, segment_id, last, &list);
+
+    for (size_t i = 0; i < list.count; i++) {
+        const LogIndexEntry* e = &list.items[i];
+        if (query->since && e->timestamp < query->since) continue;
+        if (query->until && e->timestamp > query->until) continue;
+        if (query->author && e->author_key != author_key) continue;
+        if (query->file && e->file_key != file_key) continue;
+
+        if (record_matches(reader, e->pos, query)) {
+            pos_list_push(out, e->pos);
+        }
+    }
+
+    safe_free(list.items);
+}
+
+static int compare_positions(const void* a, const void* b) {
+    JournalPos x = *(const JournalPos*)a;
+    JournalPos y = *(const JournalPos*)b;
+    return (x > y) - (x < y);
+}
+
+int log_index_query(const char* journal_dir, JournalReader* reader, const LogQuery* query,
+                    JournalPos** positions, size_t* count) {
+    if (!journal_dir || !reader || !query || !positions || !count) return -1;
+
+    *positions = NULL;
+    *count = 0;
+
+    uint32_t* ids;
+    int segment_count;
+    if (journal_list_segments(journal_dir, &ids, &segment_count) != 0) return -1;
+
+    uint64_t author_key = query->author ? log_index_author_key(query->author, strlen(query->author)) : 0;
+    uint64_t file_key = query->file ? log_index_file_key(query->file, strlen(query->file)) : 0;
+
+    PosList out = {0};
+    for (int i = 0; i < segment_count; i++) {
+        char path[600];
+        index_path(journal_dir, ids[i], LOG_INDEX_SEALED_EXT, path, sizeof(path));
+
+        if (!file_exists(path) ||
+            query_sealed(path, reader, query, author_key, file_key, &out) != 0) {
+            query_pending(journal_dir, reader, ids[i], query, author_key, file_key, &out);
+        }
+    }
+    safe_free(ids);
+
+    if (out.count > 1) {
+        qsort(out.items, out.count, sizeof(JournalPos), compare_positions);
+    }
+
+    *positions = out.items;
+    *count = out.count;
+    return 0;
+}
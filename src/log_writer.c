@@ -0,0 +1,302 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "log_writer.h"
+#include "utils.h"
+#include <errno.h>
+#include <pthread.h>
+
+struct LogWriter {
+    LogManager* lm;
+    LogWriterConfig config;
+
+    // Fila circular limitada
+    Operation** queue;
+    int head;
+    int count;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    pthread_cond_t drained;
+    int running;
+
+    unsigned long long submitted;    // Operações enfileiradas
+    unsigned long long completed;    // Operações escritas e sincronizadas
+    int flush_requested;
+    LogWriterStats stats;
+};
+
+static long long monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void log_writer_default_config(LogWriterConfig* config) {
+    if (!config) return;
+
+    config->policy = LOG_SYNC_INTERVAL;
+    config->interval_ms = LOG_WRITER_DEFAULT_INTERVAL_MS;
+    config->sync_records = LOG_WRITER_MAX_BATCH;
+    config->queue_capacity = LOG_WRITER_QUEUE_CAPACITY;
+}
+
+// Formatos aceitos: "op", "interval:MS", "records:N"
+int log_writer_parse_policy(const char* spec, LogWriterConfig* config) {
+    if (!spec || !config) return -1;
+
+    if (strcmp(spec, "op") == 0) {
+        config->policy = LOG_SYNC_EVERY_OP;
+        return 0;
+    }
+
+    const char* colon = strchr(spec, ':');
+    if (!colon) return -1;
+
+    int value = atoi(colon + 1);
+    if (value <= 0) return -1;
+
+    size_t name_len = colon - spec;
+    if (name_len == 8 && strncmp(spec, "interval", 8) == 0) {
+        config->policy = LOG_SYNC_INTERVAL;
+        config->interval_ms = value;
+        return 0;
+    }
+    if (name_len == 7 && strncmp(spec, "records", 7) == 0) {
+        config->policy = LOG_SYNC_RECORDS;
+        config->sync_records = value;
+        return 0;
+    }
+
+    return -1;
+}
+
+static void* writer_thread_func(void* arg) {
+    LogWriter* writer = (LogWriter*)arg;
+    Operation** batch = (Operation**)safe_malloc(LOG_WRITER_MAX_BATCH * sizeof(Operation*));
+
+    long long last_sync = monotonic_ms();
+    unsigned long long unsynced = 0;
+
+    pthread_mutex_lock(&writer->mutex);
+
+    for (;;) {
+        // Aguardar trabalho; na política por intervalo, acordar para sincronizar pendências
+        while (writer->count == 0 && writer->running && !writer->flush_requested) {
+            if (unsynced > 0 && writer->config.policy == LOG_SYNC_INTERVAL) {
+                long long deadline = last_sync + writer->config.interval_ms;
+                if (monotonic_ms() >= deadline) break;
+
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                long long wait_ms = deadline - monotonic_ms();
+                if (wait_ms < 1) wait_ms = 1;
+                ts.tv_sec += wait_ms / 1000;
+                ts.tv_nsec += (wait_ms % 1000) * 1000000;
+                if (ts.tv_nsec >= 1000000000) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000;
+                }
+                pthread_cond_timedwait(&writer->not_empty, &writer->mutex, &ts);
+            } else {
+                pthread_cond_wait(&writer->not_empty, &writer->mutex);
+            }
+        }
+
+        // Retirar um lote inteiro da fila de uma só vez
+        int n = 0;
+        while (writer->count > 0 && n < LOG_WRITER_MAX_BATCH) {
+            batch[n++] = writer->queue[writer->head];
+            writer->head = (writer->head + 1) % writer->config.queue_capacity;
+            writer->count--;
+        }
+
+        int stop = !writer->running && writer->count == 0;
+        int flush = writer->flush_requested || stop;
+
+        if (n > 0) {
+            pthread_cond_broadcast(&writer->not_full);
+        }
+        pthread_mutex_unlock(&writer->mutex);
+
+        if (n > 0) {
+            if (log_save_operations(writer->lm, (const Operation* const*)batch, n) != 0) {
+                log_message(LOG_ERROR, "Log writer failed to persist %d operations", n);
+            }
+            for (int i = 0; i < n; i++) {
+                operation_destroy(batch[i]);
+            }
+            unsynced += n;
+        }
+
+        // Aplicar política de durabilidade
+        int do_sync = 0;
+        if (unsynced > 0) {
+            switch (writer->config.policy) {
+                case LOG_SYNC_EVERY_OP:
+                    do_sync = 1;
+                    break;
+                case LOG_SYNC_INTERVAL:
+                    do_sync = monotonic_ms() - last_sync >= writer->config.interval_ms;
+                    break;
+                case LOG_SYNC_RECORDS:
+                    do_sync = unsynced >= (unsigned long long)writer->config.sync_records;
+                    break;
+            }
+            do_sync = do_sync || flush;
+        }
+
+        if (do_sync) {
+            log_sync(writer->lm);
+            last_sync = monotonic_ms();
+            unsynced = 0;
+        }
+
+        pthread_mutex_lock(&writer->mutex);
+
+        if (n > 0) {
+            writer->stats.operations += n;
+            writer->stats.writes++;
+        }
+        if (do_sync) {
+            writer->stats.syncs++;
+        }
+
+        writer->completed += n;
+        if (writer->flush_requested && writer->count == 0 && unsynced == 0) {
+            writer->flush_requested = 0;
+            pthread_cond_broadcast(&writer->drained);
+        }
+
+        if (stop) break;
+    }
+
+    pthread_cond_broadcast(&writer->drained);
+    pthread_mutex_unlock(&writer->mutex);
+
+    safe_free(batch);
+    return NULL;
+}
+
+LogWriter* log_writer_create(LogManager* lm, const LogWriterConfig* config) {
+    if (!lm) return NULL;
+
+    LogWriter* writer = (LogWriter*)safe_malloc(sizeof(LogWriter));
+    memset(writer, 0, sizeof(LogWriter));
+
+    writer->lm = lm;
+    if (config) {
+        writer->config = *config;
+    } else {
+        log_writer_default_config(&writer->config);
+    }
+    if (writer->config.queue_capacity <= 0) {
+        writer->config.queue_capacity = LOG_WRITER_QUEUE_CAPACITY;
+    }
+
+    writer->queue = (Operation**)safe_malloc(writer->config.queue_capacity * sizeof(Operation*));
+
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->not_empty, NULL);
+    pthread_cond_init(&writer->not_full, NULL);
+    pthread_cond_init(&writer->drained, NULL);
+
+    writer->running = 1;
+    if (pthread_create(&writer->thread, NULL, writer_thread_func, writer) != 0) {
+        log_message(LOG_ERROR, "Failed to create log writer thread");
+        pthread_mutex_destroy(&writer->mutex);
+        pthread_cond_destroy(&writer->not_empty);
+        pthread_cond_destroy(&writer->not_full);
+        pthread_cond_destroy(&writer->drained);
+        safe_free(writer->queue);
+        safe_free(writer);
+        return NULL;
+    }
+
+    log_message(LOG_DEBUG, "Started log writer (policy %d, queue %d)",
+                writer->config.policy, writer->config.queue_capacity);
+    return writer;
+}
+
+void log_writer_destroy(LogWriter* writer) {
+    if (!writer) return;
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->running = 0;
+    pthread_cond_broadcast(&writer->not_empty);
+    pthread_cond_broadcast(&writer->not_full);
+    pthread_mutex_unlock(&writer->mutex);
+
+    pthread_join(writer->thread, NULL);
+
+    log_message(LOG_INFO, "Log writer persisted %llu operations in %llu writes and %llu syncs",
+                writer->stats.operations, writer->stats.writes, writer->stats.syncs);
+
+    // Operações que chegaram depois do encerramento (não deveria acontecer)
+    while (writer->count > 0) {
+        operation_destroy(writer->queue[writer->head]);
+        writer->head = (writer->head + 1) % writer->config.queue_capacity;
+        writer->count--;
+    }
+
+    pthread_mutex_destroy(&writer->mutex);
+    pthread_cond_destroy(&writer->not_empty);
+    pthread_cond_destroy(&writer->not_full);
+    pthread_cond_destroy(&writer->drained);
+    safe_free(writer->queue);
+    safe_free(writer);
+}
+
+int log_writer_submit(LogWriter* writer, Operation* op) {
+    if (!writer || !op) return -1;
+
+    pthread_mutex_lock(&writer->mutex);
+
+    // Contrapressão: bloquear enquanto a fila estiver cheia
+    while (writer->count >= writer->config.queue_capacity && writer->running) {
+        pthread_cond_wait(&writer->not_full, &writer->mutex);
+    }
+
+    if (!writer->running) {
+        pthread_mutex_unlock(&writer->mutex);
+        log_message(LOG_ERROR, "Log writer is stopped, dropping operation");
+        operation_destroy(op);
+        return -1;
+    }
+
+    int tail = (writer->head + writer->count) % writer->config.queue_capacity;
+    writer->queue[tail] = op;
+    writer->count++;
+    writer->submitted++;
+
+    pthread_cond_signal(&writer->not_empty);
+    pthread_mutex_unlock(&writer->mutex);
+    return 0;
+}
+
+int log_writer_flush(LogWriter* writer) {
+    if (!writer) return -1;
+
+    pthread_mutex_lock(&writer->mutex);
+
+    unsigned long long target = writer->submitted;
+    writer->flush_requested = 1;
+    pthread_cond_signal(&writer->not_empty);
+
+    while (writer->running && (writer->completed < target || writer->flush_requested)) {
+        pthread_cond_wait(&writer->drained, &writer->mutex);
+    }
+
+    pthread_mutex_unlock(&writer->mutex);
+    return 0;
+}
+
+void log_writer_get_stats(LogWriter* writer, LogWriterStats* stats) {
+    if (!writer || !stats) return;
+
+    pthread_mutex_lock(&writer->mutex);
+    *stats = writer->stats;
+    pthread_mutex_unlock(&writer->mutex);
+}
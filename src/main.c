@@ -12,8 +12,11 @@
 
 #include "versioning.h"
 #include "log.h"
+#include "log_writer.h"
+#include "log_gc.h"
 #include "websocket_client.h"
 #include "file_watcher.h"
+#include "diff_pool.h"
 #include "utils.h"
 
 #define VERSION "0.1.3"
@@ -24,9 +27,13 @@
 static volatile int running = 1;
 static VersioningManager* vm = NULL;
 static LogManager* lm = NULL;
+static LogWriter* writer = NULL;
 static WebSocketClient* ws = NULL;
 static FileWatcher* fw = NULL;
+static DiffPool* pool = NULL;
+static WorktreeIndex* worktree = NULL;
 static pthread_mutex_t operations_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t serial_mutex = PTHREAD_MUTEX_INITIALIZER;   // Sem pool: um evento por vez
 
 // Handler para sinais
 void signal_handler(int sig) {
@@ -36,132 +43,255 @@ void signal_handler(int sig) {
     }
 }
 
-// Callback para processar operações recebidas do servidor
-void handle_remote_operation(const Operation* op, void* user_data) {
-    (void)user_data;
+// Envia e registra operações locais (o writer assume a posse). Chamado com
+// operations_mutex, que serializa o cliente WebSocket e o journal (o snapshot store
+// aceita gravações concorrentes e fica fora do lock).
+static void emit_operations(Operation** ops, int op_count) {
+    for (int i = 0; i < op_count; i++) {
+        Operation* op = ops[i];
 
-    log_message(LOG_INFO, "Received remote operation from %s: %s at line %d, col %d",
-                op->author, op->op_type, op->line, op->column);
+        // Enviar para servidor
+        if (ws && ws_get_state(ws) == WS_CONNECTED) {
+            ws_send_operation(ws, op);
+        }
 
-    pthread_mutex_lock(&operations_mutex);
+        // Salvar no log (o writer assume a posse da operação)
+        if (writer) {
+            log_writer_submit(writer, op);
+        } else {
+            operation_destroy(op);
+        }
+    }
+}
 
-    // Salvar operação no log local
-    if (lm) {
-        log_save_operation(lm, op);
+// Operações remotas recebidas numa rodada do cliente WebSocket, agrupadas por
+// arquivo na ordem de chegada. Só a thread principal (ws_service) mexe na lista.
+typedef struct RemoteBatch {
+    char filepath[MAX_OP_PATH_LEN];
+    Operation** ops;
+    int count;
+    int capacity;
+    struct RemoteBatch* next;
+} RemoteBatch;
+
+static RemoteBatch* remote_batches = NULL;
+static RemoteBatch* remote_batches_tail = NULL;
+
+static void remote_batch_destroy(RemoteBatch* batch) {
+    for (int i = 0; i < batch->count; i++) {
+        operation_destroy(batch->ops[i]);
     }
+    safe_free(batch->ops);
+    safe_free(batch);
+}
+
+// Registra as operações do lote e aplica de uma vez as que não são nossas: o
+// arquivo é gravado uma vez por lote, não uma vez por operação
+static void process_remote_batch(RemoteBatch* batch) {
+    // Salvar operações no log local
+    pthread_mutex_lock(&operations_mutex);
+    if (writer) {
+        for (int i = 0; i < batch->count; i++) {
+            log_writer_submit(writer, operation_copy(batch->ops[i]));
+        }
+    }
+    pthread_mutex_unlock(&operations_mutex);
+
+    if (!vm || !batch->filepath[0]) return;
 
-    // Aplicar operação ao arquivo local se não for nossa própria operação
     const char* current_user = getenv("USER");
     if (!current_user) current_user = "unknown";
 
-    if (strcmp(op->author, current_user) != 0) {
-        // TODO: Implementar aplicação de operação remota
-        log_message(LOG_DEBUG, "Would apply remote operation to file");
+    const Operation** foreign = (const Operation**)safe_malloc(batch->count * sizeof(Operation*));
+    int foreign_count = 0;
+    for (int i = 0; i < batch->count; i++) {
+        if (strcmp(batch->ops[i]->author, current_user) != 0) {
+            foreign[foreign_count++] = batch->ops[i];
+        }
     }
 
-    pthread_mutex_unlock(&operations_mutex);
+    if (foreign_count > 0 &&
+        versioning_apply_operations(vm, batch->filepath, foreign, foreign_count) != 0) {
+        log_message(LOG_WARNING, "Could not apply %d remote operations to %s", foreign_count, batch->filepath);
+    }
+    safe_free(foreign);
 }
 
-// Callback para mudanças de arquivo detectadas pelo file watcher
-void handle_file_change(const char* filepath, FileChangeType type, void* user_data) {
-    (void)user_data;
+static void remote_batch_task(void* arg) {
+    RemoteBatch* batch = (RemoteBatch*)arg;
+    process_remote_batch(batch);
+    remote_batch_destroy(batch);
+}
 
-    const char* type_str = "";
-    switch (type) {
-        case FILE_CREATED: type_str = "created"; break;
-        case FILE_MODIFIED: type_str = "modified"; break;
-        case FILE_DELETED: type_str = "deleted"; break;
+// Entrega os lotes acumulados: na fila do arquivo, não concorrem com o diff de
+// mudanças locais do mesmo arquivo
+static void flush_remote_operations(void) {
+    RemoteBatch* batch = remote_batches;
+    remote_batches = remote_batches_tail = NULL;
+
+    while (batch) {
+        RemoteBatch* next = batch->next;
+        if (pool && batch->filepath[0]) {
+            diff_pool_submit(pool, batch->filepath, remote_batch_task, batch);
+        } else {
+            pthread_mutex_lock(&serial_mutex);
+            process_remote_batch(batch);
+            pthread_mutex_unlock(&serial_mutex);
+            remote_batch_destroy(batch);
+        }
+        batch = next;
     }
+}
 
-    log_message(LOG_INFO, "File %s: %s", type_str, filepath);
-
-    pthread_mutex_lock(&operations_mutex);
-
-    if (type == FILE_CREATED) {
-        // Adicionar arquivo ao controle de versão
-        if (vm) {
-            versioning_add_file(vm, filepath);
-        }
+// Callback para processar operações recebidas do servidor
+void handle_remote_operation(const Operation* op, void* user_data) {
+    (void)user_data;
 
-        // Criar operação de criação
-        const char* current_user = getenv("USER");
-        if (!current_user) current_user = "unknown";
+    log_message(LOG_INFO, "Received remote operation from %s: %s of %d line(s) at line %d, col %d",
+                op->author, op->op_type, op->line_count, op->line, op->column);
+
+    // Relógio híbrido: operações locais posteriores ficam depois da remota
+    operation_clock_observe(op->hlc);
+
+    // Acumulada no lote do arquivo até o fim da rodada (flush_remote_operations)
+    RemoteBatch* batch = remote_batches;
+    while (batch && strcmp(batch->filepath, op->filepath) != 0) batch = batch->next;
+    if (!batch) {
+        batch = (RemoteBatch*)safe_malloc(sizeof(RemoteBatch));
+        memset(batch, 0, sizeof(RemoteBatch));
+        snprintf(batch->filepath, sizeof(batch->filepath), "%s", op->filepath);
+        if (remote_batches_tail) remote_batches_tail->next = batch;
+        else remote_batches = batch;
+        remote_batches_tail = batch;
+    }
+    if (batch->count >= batch->capacity) {
+        batch->capacity = batch->capacity ? batch->capacity * 2 : 8;
+        batch->ops = (Operation**)safe_realloc(batch->ops, batch->capacity * sizeof(Operation*));
+    }
+    batch->ops[batch->count++] = operation_copy(op);
+}
 
-        size_t content_size;
-        char* content = file_read_all(filepath, &content_size);
-        if (content) {
-            Operation* op = operation_create("create", 0, 0, content, current_user);
+// Processa uma mudança de arquivo: leitura, diff e snapshot fora do lock global,
+// que só é tomado para emitir as operações resultantes
+static void process_file_change(const char* filepath, FileChangeType type) {
+    const char* current_user = getenv("USER");
+    if (!current_user) current_user = "unknown";
 
-            // Salvar no log
+    if (type == FILE_CREATED) {
+        // Uma única leitura: o conteúdo que vira o baseline gera a operação e o snapshot
+        size_t content_size = 0;
+        char* content = NULL;
+        int status = vm ? versioning_add_file_content(vm, filepath, &content, &content_size) : 0;
+        if (!vm) content = file_read_all(filepath, &content_size);
+
+        // Arquivo que já era monitorado (criado por uma operação remota, por exemplo):
+        // só as diferenças para o baseline viram operações
+        if (status == 1) {
+            type = FILE_MODIFIED;
+        } else if (content) {
+            // Criar operação de criação ("blocks" para binários e arquivos grandes)
+            Operation* op = versioning_create_operation(filepath, content, content_size, current_user);
+            int64_t hlc = op->hlc;
+
+            pthread_mutex_lock(&operations_mutex);
+            emit_operations(&op, 1);
+            pthread_mutex_unlock(&operations_mutex);
+
+            // Versão completa no armazenamento de snapshots, depois do journal: um
+            // snapshot nunca fica ancorado numa operação que não foi registrada
             if (lm) {
-                log_save_operation(lm, op);
-            }
-
-            // Enviar para servidor
-            if (ws && ws_get_state(ws) == WS_CONNECTED) {
-                ws_send_operation(ws, op);
+                log_save_snapshot_n(lm, filepath, content, content_size, hlc);
             }
-
-            operation_destroy(op);
-            safe_free(content);
         }
+        safe_free(content);
     }
-    else if (type == FILE_MODIFIED) {
+
+    if (type == FILE_MODIFIED) {
         // Detectar mudanças específicas
         if (vm) {
             int op_count;
-            Operation** ops = versioning_detect_changes(vm, filepath, &op_count);
+            size_t content_size = 0;
+            char* content = NULL;
+            Operation** ops = versioning_detect_changes(vm, filepath, &op_count,
+                                                        lm ? &content : NULL, &content_size);
 
             if (ops && op_count > 0) {
                 log_message(LOG_INFO, "Detected %d changes in %s", op_count, filepath);
 
-                // Processar cada operação
-                for (int i = 0; i < op_count; i++) {
-                    Operation* op = ops[i];
+                int64_t hlc = ops[op_count - 1]->hlc;
 
-                    // Salvar no log
-                    if (lm) {
-                        log_save_operation(lm, op);
-                    }
+                pthread_mutex_lock(&operations_mutex);
+                emit_operations(ops, op_count);
+                pthread_mutex_unlock(&operations_mutex);
 
-                    // Enviar para servidor
-                    if (ws && ws_get_state(ws) == WS_CONNECTED) {
-                        ws_send_operation(ws, op);
-                    }
-
-                    operation_destroy(op);
+                // Conteúdo idêntico a um snapshot existente não ocupa espaço novo
+                if (content) {
+                    log_save_snapshot_n(lm, filepath, content, content_size, hlc);
                 }
-
-                safe_free(ops);
             }
+            safe_free(content);
+            safe_free(ops);
         }
     }
     else if (type == FILE_DELETED) {
-        // Remover arquivo do controle de versão
-        if (vm) {
-            versioning_remove_file(vm, filepath);
+        // Remover arquivo do controle de versão. Se já não era monitorado (removido
+        // por uma operação remota), não há o que propagar.
+        if (vm && versioning_remove_file(vm, filepath) != 0) {
+            return;
         }
 
-        // Criar operação de deleção
-        const char* current_user = getenv("USER");
-        if (!current_user) current_user = "unknown";
+        // Criar operação de remoção do arquivo
+        Operation* op = operation_create("remove", 0, 0, "", current_user);
+        operation_set_file(op, filepath);
 
-        Operation* op = operation_create("delete", 0, 0, "", current_user);
+        pthread_mutex_lock(&operations_mutex);
+        emit_operations(&op, 1);
+        pthread_mutex_unlock(&operations_mutex);
+    }
+}
 
-        // Salvar no log
-        if (lm) {
-            log_save_operation(lm, op);
-        }
+typedef struct {
+    FileChangeType type;
+    char filepath[MAX_FILEPATH_LEN];
+} FileChangeTask;
 
-        // Enviar para servidor
-        if (ws && ws_get_state(ws) == WS_CONNECTED) {
-            ws_send_operation(ws, op);
-        }
+static void file_change_task(void* arg) {
+    FileChangeTask* task = (FileChangeTask*)arg;
+    process_file_change(task->filepath, task->type);
+    safe_free(task);
+}
+
+static void add_file_task(void* arg) {
+    versioning_add_file(vm, (const char*)arg);
+    safe_free(arg);
+}
+
+// Callback para mudanças de arquivo detectadas pelo file watcher
+void handle_file_change(const char* filepath, FileChangeType type, void* user_data) {
+    (void)user_data;
 
-        operation_destroy(op);
+    const char* type_str = "";
+    switch (type) {
+        case FILE_CREATED: type_str = "created"; break;
+        case FILE_MODIFIED: type_str = "modified"; break;
+        case FILE_DELETED: type_str = "deleted"; break;
     }
 
-    pthread_mutex_unlock(&operations_mutex);
+    log_message(LOG_INFO, "File %s: %s", type_str, filepath);
+
+    // Arquivos diferentes são processados em paralelo; eventos do mesmo arquivo,
+    // em ordem e pelo mesmo worker
+    if (pool) {
+        FileChangeTask* task = (FileChangeTask*)safe_malloc(sizeof(FileChangeTask));
+        task->type = type;
+        strncpy(task->filepath, filepath, MAX_FILEPATH_LEN - 1);
+        task->filepath[MAX_FILEPATH_LEN - 1] = '\0';
+        diff_pool_submit(pool, task->filepath, file_change_task, task);
+    } else {
+        pthread_mutex_lock(&serial_mutex);
+        process_file_change(filepath, type);
+        pthread_mutex_unlock(&serial_mutex);
+    }
 }
 
 // Função para monitorar mudanças em arquivos
@@ -187,10 +317,20 @@ void monitor_files(void) {
     WatchedFile* files;
     int file_count;
     if (file_watcher_get_files(fw, &files, &file_count) == 0) {
+        // Leitura e indexação dos arquivos em paralelo
         for (int i = 0; i < file_count; i++) {
-            versioning_add_file(vm, files[i].filepath);
+            if (pool) {
+                diff_pool_submit(pool, files[i].filepath, add_file_task, str_duplicate(files[i].filepath));
+            } else {
+                versioning_add_file(vm, files[i].filepath);
+            }
         }
-        log_message(LOG_INFO, "Added %d existing files to version control", file_count);
+        diff_pool_wait(pool);
+
+        VersioningCacheStats cache;
+        versioning_get_cache_stats(vm, &cache);
+        log_message(LOG_INFO, "Added %d existing files to version control (%d unchanged, not read)",
+                    file_count, cache.lazy_files);
     }
 
     // Loop principal de monitoramento
@@ -198,6 +338,7 @@ void monitor_files(void) {
         // Processar eventos do WebSocket
         if (ws && ws_get_state(ws) == WS_CONNECTED) {
             ws_service(ws, 100);
+            flush_remote_operations();
         }
 
         // Em sistemas sem inotify, fazer polling manual
@@ -212,6 +353,7 @@ void monitor_files(void) {
     }
 
     // Cleanup
+    flush_remote_operations();
     if (fw) {
         file_watcher_stop(fw);
         file_watcher_destroy(fw);
@@ -273,45 +415,212 @@ void show_status(void) {
 }
 
 // Função para exibir histórico
-void show_log(void) {
-    printf("MyVC Log\n");
-    printf("========\n");
+static void print_operation_view(const char* label, const OperationView* op) {
+    char* time_str = time_format(op->timestamp);
+
+    printf("Operation %s:\n", label);
+    printf("  Type: %.*s\n", (int)op->op_type_len, op->op_type);
+    printf("  Author: %.*s\n", (int)op->author_len, op->author);
+    printf("  Time: %s\n", time_str);
+    if (op->filepath_len > 0) {
+        printf("  File: %.*s\n", (int)op->filepath_len, op->filepath);
+    }
+    if (op->line_count > 1) {
+        printf("  Location: lines %d-%d\n", op->line, op->line + op->line_count - 1);
+    } else {
+        printf("  Location: line %d, column %d\n", op->line, op->column);
+    }
+    if (op->text_len > 0 && op->op_type_len == 6 && strncmp(op->op_type, "blocks", 6) == 0) {
+        printf("  Block delta: %zu bytes (base64)\n", op->text_len);
+    } else if (op->text_len > 0) {
+        printf("  Text: %.*s%s\n", op->text_len > 50 ? 50 : (int)op->text_len, op->text,
+               op->text_len > 50 ? "..." : "");
+    }
+    printf("\n");
+}
+
+// Paginação do log: pular as `skip` mais recentes e exibir no máximo `limit` (0 = todas)
+typedef struct {
+    uint64_t skip;
+    uint64_t limit;
+    int pager;
+} LogPage;
+
+static FILE* pager = NULL;
+
+// Redireciona stdout para $PAGER (apenas em terminal); as operações são escritas
+// à medida que são lidas, então a primeira página aparece imediatamente
+static void pager_start(void) {
+    if (!isatty(STDOUT_FILENO)) return;
+
+    const char* command = getenv("PAGER");
+    if (!command || !*command) command = "less -FRX";
+
+    fflush(stdout);
+    pager = popen(command, "w");
+    if (!pager) {
+        log_message(LOG_WARNING, "Failed to start pager: %s", command);
+        return;
+    }
+
+    // Pager encerrado pelo usuário: parar de escrever em vez de morrer com SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    dup2(fileno(pager), STDOUT_FILENO);
+}
+
+static void pager_stop(void) {
+    if (!pager) return;
+
+    fflush(stdout);
+    close(STDOUT_FILENO);
+    pclose(pager);
+    pager = NULL;
+}
 
+// Log filtrado: consulta os índices secundários em vez de varrer o journal
+static void show_filtered_log(JournalReader* reader, const LogQuery* query, const LogPage* page) {
+    JournalPos* positions;
+    size_t count;
+    if (log_query(lm, reader, query, &positions, &count) != 0) {
+        printf("Error: Failed to query operation history\n");
+        return;
+    }
+
+    if (count == 0) {
+        printf("No matching operations found\n");
+        safe_free(positions);
+        return;
+    }
+
+    printf("Found %zu matching operations:\n\n", count);
+
+    // Mais recentes primeiro
+    size_t first = page->skip < count ? count - page->skip : 0;
+    uint64_t shown = 0;
+    for (size_t i = first; i > 0 && (!page->limit || shown < page->limit); i--) {
+        JournalRecord record;
+        OperationView op;
+        if (journal_reader_get(reader, positions[i - 1], &record) != 0 ||
+            operation_view(record.payload, record.length, &op) != 0) {
+            continue;
+        }
+
+        // Registros anteriores aos IDs sequenciais: derivar o número pela posição
+        uint64_t seq = op.seq ? op.seq : journal_reader_seq_of(reader, positions[i - 1]);
+
+        char label[32];
+        snprintf(label, sizeof(label), "%llu", (unsigned long long)seq);
+        print_operation_view(label, &op);
+        shown++;
+
+        if (ferror(stdout)) break;
+    }
+
+    safe_free(positions);
+}
+
+void show_log(const LogQuery* query, const LogPage* page) {
     lm = log_create(".");
     if (!lm) {
         printf("Error: Not a myvc repository\n");
         return;
     }
 
-    int op_count;
-    Operation** ops = log_load_operations(lm, &op_count);
+    if (page->pager) pager_start();
 
-    if (!ops || op_count == 0) {
-        printf("No operations found\n");
-        log_destroy(lm);
-        return;
+    printf("MyVC Log\n");
+    printf("========\n");
+
+    JournalReader* reader = log_open_reader(lm);
+    uint64_t op_count = reader ? journal_reader_count(reader) : 0;
+
+    // Histórico anterior ao último gc: só o estado final de cada arquivo
+    LogBaselineHeader baseline;
+    if (log_load_baseline(lm, &baseline, NULL) == 0 && baseline.count > 0) {
+        printf("%llu earlier operations were folded into a baseline of %u files at %s\n"
+               "(show FILE@baseline)\n\n",
+               (unsigned long long)baseline.folded_count, baseline.count,
+               time_format((long)(baseline.horizon / OPERATION_NS_PER_SEC)));
     }
 
-    printf("Found %d operations:\n\n", op_count);
+    if (op_count == 0) {
+        printf("No operations found\n");
+    } else if (query->since || query->until || query->author || query->file) {
+        show_filtered_log(reader, query, page);
+    } else {
+        printf("Found %llu operations:\n\n", (unsigned long long)op_count);
+
+        // Mais recentes primeiro: percorrer o journal de trás para frente,
+        // decodificando apenas a visão de cada registro impresso. --skip posiciona
+        // o cursor direto pelo número da operação, sem ler as anteriores.
+        JournalCursor cursor;
+        JournalRecord record;
+        uint64_t number = page->skip < op_count ? op_count - page->skip : 0;
+        int positioned = -1;
+        if (number == op_count) {
+            positioned = journal_cursor_last(reader, &cursor);
+        } else if (number > 0 && journal_reader_get_seq(reader, number, &record) == 0) {
+            JournalPos end = record.pos + JOURNAL_RECORD_OVERHEAD + record.length;
+            positioned = journal_cursor_seek(reader, end, &cursor);
+        }
 
-    for (int i = op_count - 1; i >= 0; i--) { // Mais recentes primeiro
-        Operation* op = ops[i];
-        char* time_str = time_format(op->timestamp);
+        uint64_t shown = 0;
+        while (positioned == 0 && (!page->limit || shown < page->limit) &&
+               journal_cursor_prev(&cursor, &record) > 0) {
+            OperationView op;
+            if (operation_view(record.payload, record.length, &op) != 0) {
+                number--;
+                continue;
+            }
 
-        printf("Operation %d:\n", i + 1);
-        printf("  Type: %s\n", op->op_type);
-        printf("  Author: %s\n", op->author);
-        printf("  Time: %s\n", time_str);
-        printf("  Location: line %d, column %d\n", op->line, op->column);
-        if (op->text && strlen(op->text) > 0) {
-            printf("  Text: %.50s%s\n", op->text, strlen(op->text) > 50 ? "..." : "");
+            char label[32];
+            snprintf(label, sizeof(label), "%llu", (unsigned long long)(op.seq ? op.seq : number));
+            number--;
+            print_operation_view(label, &op);
+            shown++;
+
+            if (ferror(stdout)) break;
         }
-        printf("\n");
+    }
+
+    journal_reader_close(reader);
+    log_destroy(lm);
+    pager_stop();
+}
+
+// Listar checkpoints (mais recentes primeiro)
+void show_checkpoints(void) {
+    lm = log_create(".");
+    if (!lm) {
+        printf("Error: Not a myvc repository\n");
+        return;
+    }
 
-        operation_destroy(op);
+    int count;
+    Checkpoint* checkpoints = log_load_checkpoints(lm, &count);
+    if (!checkpoints || count == 0) {
+        printf("No checkpoints found\n");
+        safe_free(checkpoints);
+        log_destroy(lm);
+        return;
     }
 
-    safe_free(ops);
+    for (int i = count - 1; i >= 0; i--) {
+        const Checkpoint* cp = &checkpoints[i];
+        char digest[HASH_SHA256_HEX_SIZE];
+        hash_to_hex(cp->digest, HASH_SHA256_SIZE, digest);
+
+        printf("Checkpoint %llu %s\n", (unsigned long long)cp->id, digest);
+        printf("  Author: %s\n", cp->author);
+        printf("  Time: %s\n", time_format(cp->timestamp));
+        printf("  Operations: %llu", (unsigned long long)cp->end_count);
+        if (i > 0) {
+            printf(" (+%llu)", (unsigned long long)(cp->end_count - checkpoints[i - 1].end_count));
+        }
+        printf("\n\n    %s\n\n", cp->message);
+    }
+
+    safe_free(checkpoints);
     log_destroy(lm);
 }
 
@@ -323,14 +632,45 @@ void print_usage(const char* program_name) {
     printf("  -p, --port PORT        Server port (default: %d)\n", DEFAULT_PORT);
     printf("  -d, --directory DIR    Project directory (default: current)\n");
     printf("  -v, --verbose          Enable verbose logging\n");
+    printf("  --fsync POLICY         Log durability: op, interval:MS or records:N\n");
+    printf("                         (default: interval:%d)\n", LOG_WRITER_DEFAULT_INTERVAL_MS);
+    printf("  --chain-depth N        Maximum snapshot delta chain depth (default: %d)\n",
+           SNAPSHOT_DEFAULT_MAX_DEPTH);
+    printf("  --diff-threads N       Workers diffing changed files (default: one per core,\n");
+    printf("                         0 = on the watcher thread)\n");
+    printf("  --intraline EXTS       File types diffed within lines: *, none or a list\n");
+    printf("                         like .c,.h,.md (default: %s)\n", VERSIONING_INTRALINE_DEFAULT);
+    printf("  --memory-budget MB     Resident file baselines before the least recently used\n");
+    printf("                         are moved to the snapshot store (default: %d, 0 = unlimited)\n",
+           VERSIONING_MEMORY_BUDGET_MB);
+    printf("  --diff-budget MS       Time limit per file diff before falling back to a\n");
+    printf("                         coarser hunk (default: %d, 0 = unlimited)\n", VERSIONING_DIFF_BUDGET_MS);
     printf("  -h, --help             Show this help message\n");
     printf("  --version              Show version information\n");
     printf("\nCommands:\n");
     printf("  init                   Initialize version control in current directory\n");
     printf("  watch                  Start watching files for changes\n");
     printf("  commit MESSAGE         Create a checkpoint with message\n");
+    printf("  checkpoints            List checkpoints\n");
+    printf("  show VERSION           Print a snapshot (FILE, FILE@TIME, FILE@baseline or snapshot id)\n");
+    printf("  repack                 Rebuild snapshot delta chains\n");
+    printf("  gc                     Fold old operations into per-file snapshot baselines\n");
     printf("  status                 Show current status\n");
     printf("  log                    Show operation history\n");
+    printf("\nLog options:\n");
+    printf("  --since TIME           Operations at or after TIME\n");
+    printf("  --until TIME           Operations at or before TIME\n");
+    printf("  --author NAME          Operations by NAME\n");
+    printf("  --file PATH            Operations on PATH\n");
+    printf("                         (TIME: epoch, now, today, yesterday, N[smhdw] ago\n");
+    printf("                          or YYYY-MM-DD[ HH:MM[:SS]])\n");
+    printf("  -n, --limit N          Show at most N operations\n");
+    printf("  --skip N               Skip the N most recent operations\n");
+    printf("  --pager                Page output through $PAGER (default: less -FRX)\n");
+    printf("\nGc options (default horizon: latest checkpoint):\n");
+    printf("  --before TIME          Compact operations older than TIME\n");
+    printf("  --checkpoint N         Compact operations up to checkpoint N\n");
+    printf("  --force                Compact even if some files have no snapshot\n");
 }
 
 int main(int argc, char* argv[]) {
@@ -339,6 +679,19 @@ int main(int argc, char* argv[]) {
     int port = DEFAULT_PORT;
     char* directory = ".";
     int verbose = 0;
+    LogWriterConfig writer_config;
+    log_writer_default_config(&writer_config);
+    int chain_depth = -1;
+    int diff_threads = -1;
+    const char* intraline = VERSIONING_INTRALINE_DEFAULT;
+    int diff_budget = VERSIONING_DIFF_BUDGET_MS;
+    int memory_budget = VERSIONING_MEMORY_BUDGET_MB;
+    LogGcOptions gc_options;
+    memset(&gc_options, 0, sizeof(gc_options));
+    LogQuery log_query_filter;
+    memset(&log_query_filter, 0, sizeof(log_query_filter));
+    LogPage log_page;
+    memset(&log_page, 0, sizeof(log_page));
 
     // Estrutura para getopt_long
     static struct option long_options[] = {
@@ -348,6 +701,22 @@ int main(int argc, char* argv[]) {
         {"verbose", no_argument, 0, 'v'},
         {"help", no_argument, 0, 'h'},
         {"version", no_argument, 0, 0},
+        {"fsync", required_argument, 0, 0},
+        {"chain-depth", required_argument, 0, 0},
+        {"before", required_argument, 0, 0},
+        {"checkpoint", required_argument, 0, 0},
+        {"force", no_argument, 0, 0},
+        {"since", required_argument, 0, 0},
+        {"until", required_argument, 0, 0},
+        {"author", required_argument, 0, 0},
+        {"file", required_argument, 0, 0},
+        {"intraline", required_argument, 0, 0},
+        {"diff-threads", required_argument, 0, 0},
+        {"diff-budget", required_argument, 0, 0},
+        {"memory-budget", required_argument, 0, 0},
+        {"limit", required_argument, 0, 'n'},
+        {"skip", required_argument, 0, 0},
+        {"pager", no_argument, 0, 0},
         {0, 0, 0, 0}
     };
 
@@ -355,13 +724,85 @@ int main(int argc, char* argv[]) {
     int option_index = 0;
     int c;
 
-    while ((c = getopt_long(argc, argv, "s:p:d:vh", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "s:p:d:vhn:", long_options, &option_index)) != -1) {
         switch (c) {
             case 0:
                 if (strcmp(long_options[option_index].name, "version") == 0) {
                     printf("myvc version %s\n", VERSION);
                     return 0;
                 }
+                if (strcmp(long_options[option_index].name, "fsync") == 0) {
+                    if (log_writer_parse_policy(optarg, &writer_config) != 0) {
+                        fprintf(stderr, "Invalid fsync policy: %s\n", optarg);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "chain-depth") == 0) {
+                    chain_depth = atoi(optarg);
+                    if (chain_depth < 0) {
+                        fprintf(stderr, "Invalid chain depth: %s\n", optarg);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "intraline") == 0) {
+                    intraline = optarg;
+                }
+                if (strcmp(long_options[option_index].name, "diff-threads") == 0) {
+                    diff_threads = atoi(optarg);
+                    if (diff_threads < 0 || diff_threads > DIFF_POOL_MAX_THREADS) {
+                        fprintf(stderr, "Invalid thread count: %s (0-%d)\n", optarg, DIFF_POOL_MAX_THREADS);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "diff-budget") == 0) {
+                    diff_budget = atoi(optarg);
+                    if (diff_budget < 0) {
+                        fprintf(stderr, "Invalid diff budget: %s\n", optarg);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "memory-budget") == 0) {
+                    memory_budget = atoi(optarg);
+                    if (memory_budget < 0) {
+                        fprintf(stderr, "Invalid memory budget: %s\n", optarg);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "before") == 0 &&
+                    time_parse(optarg, &gc_options.before) != 0) {
+                    fprintf(stderr, "Invalid time: %s\n", optarg);
+                    return 1;
+                }
+                if (strcmp(long_options[option_index].name, "checkpoint") == 0) {
+                    gc_options.checkpoint_id = strtoull(optarg, NULL, 10);
+                }
+                if (strcmp(long_options[option_index].name, "force") == 0) {
+                    gc_options.force = 1;
+                }
+                if (strcmp(long_options[option_index].name, "since") == 0 ||
+                    strcmp(long_options[option_index].name, "until") == 0) {
+                    long* bound = long_options[option_index].name[0] == 's'
+                        ? &log_query_filter.since : &log_query_filter.until;
+                    if (time_parse(optarg, bound) != 0) {
+                        fprintf(stderr, "Invalid time: %s\n", optarg);
+                        return 1;
+                    }
+                }
+                if (strcmp(long_options[option_index].name, "author") == 0) {
+                    log_query_filter.author = optarg;
+                }
+                if (strcmp(long_options[option_index].name, "file") == 0) {
+                    log_query_filter.file = optarg;
+                }
+                if (strcmp(long_options[option_index].name, "skip") == 0) {
+                    log_page.skip = strtoull(optarg, NULL, 10);
+                }
+                if (strcmp(long_options[option_index].name, "pager") == 0) {
+                    log_page.pager = 1;
+                }
+                break;
+            case 'n':
+                log_page.limit = strtoull(optarg, NULL, 10);
                 break;
             case 's':
                 server = optarg;
@@ -438,12 +879,24 @@ int main(int argc, char* argv[]) {
             // Inicializar componentes
             vm = versioning_create();
             lm = log_create(".");
+            writer = log_writer_create(lm, &writer_config);
             ws = ws_create(server, port);
 
-            if (!vm || !lm || !ws) {
+            if (!vm || !lm || !writer || !ws) {
                 log_message(LOG_ERROR, "Failed to initialize components");
                 goto cleanup;
             }
+            if (chain_depth >= 0) {
+                snapshot_store_set_max_depth(lm->snapshots, chain_depth);
+            }
+            versioning_set_intraline(vm, intraline);
+            versioning_set_diff_budget(vm, diff_budget);
+            versioning_set_memory_budget(vm, lm->snapshots, (size_t)memory_budget * 1024 * 1024);
+            char index_path[600];
+            snprintf(index_path, sizeof(index_path), "%s/%s", lm->log_path, WORKTREE_INDEX_FILE);
+            worktree = worktree_index_open(index_path);
+            versioning_set_worktree_index(vm, worktree);
+            pool = diff_pool_create(diff_threads >= 0 ? diff_threads : diff_pool_default_threads());
 
             // Conectar ao servidor
             if (ws_connect(ws) != 0) {
@@ -475,7 +928,15 @@ int main(int argc, char* argv[]) {
 
             const char* message = argv[optind + 1];
             if (log_create_checkpoint(lm, message) == 0) {
-                printf("Created checkpoint: %s\n", message);
+                Checkpoint checkpoint;
+                if (log_last_checkpoint(lm, &checkpoint) == 1) {
+                    char digest[HASH_SHA256_HEX_SIZE];
+                    hash_to_hex(checkpoint.digest, HASH_SHA256_SIZE, digest);
+                    printf("Created checkpoint %llu (%.12s): %s\n",
+                           (unsigned long long)checkpoint.id, digest, message);
+                } else {
+                    printf("Created checkpoint: %s\n", message);
+                }
             } else {
                 fprintf(stderr, "Failed to create checkpoint\n");
                 return 1;
@@ -484,12 +945,84 @@ int main(int argc, char* argv[]) {
             log_destroy(lm);
             return 0;
         }
+        else if (strcmp(command, "show") == 0) {
+            if (optind + 1 >= argc) {
+                fprintf(stderr, "Error: show requires a version (FILE, FILE@TIME or snapshot id)\n");
+                return 1;
+            }
+
+            lm = log_create(".");
+            if (!lm) {
+                fprintf(stderr, "Error: Not a myvc repository\n");
+                return 1;
+            }
+
+            size_t content_size = 0;
+            char* content = log_load_snapshot(lm, argv[optind + 1], &content_size);
+            if (!content) {
+                fprintf(stderr, "Error: No snapshot found for %s\n", argv[optind + 1]);
+                log_destroy(lm);
+                return 1;
+            }
+
+            // Tamanho do armazenamento: snapshots binários podem conter NUL
+            fwrite(content, 1, content_size, stdout);
+            safe_free(content);
+            log_destroy(lm);
+            return 0;
+        }
+        else if (strcmp(command, "repack") == 0) {
+            lm = log_create(".");
+            if (!lm) {
+                fprintf(stderr, "Error: Not a myvc repository\n");
+                return 1;
+            }
+            if (chain_depth >= 0) {
+                snapshot_store_set_max_depth(lm->snapshots, chain_depth);
+            }
+
+            SnapshotStoreStats stats;
+            if (snapshot_store_repack(lm->snapshots, &stats) != 0) {
+                fprintf(stderr, "Repack finished with errors\n");
+                log_destroy(lm);
+                return 1;
+            }
+
+            printf("Repacked %llu objects (%llu deltas): %llu -> %llu bytes\n",
+                   stats.objects, stats.deltas, stats.bytes_before, stats.bytes);
+            log_destroy(lm);
+            return 0;
+        }
+        else if (strcmp(command, "gc") == 0) {
+            lm = log_create(".");
+            if (!lm) {
+                fprintf(stderr, "Error: Not a myvc repository\n");
+                return 1;
+            }
+
+            LogGcStats stats;
+            if (log_gc(lm, &gc_options, &stats) != 0) {
+                fprintf(stderr, "Error: gc failed\n");
+                log_destroy(lm);
+                return 1;
+            }
+
+            printf("Compacted %llu operations (%d segments, %llu bytes) into a baseline of %d files\n",
+                   (unsigned long long)stats.operations, stats.segments,
+                   (unsigned long long)stats.bytes, stats.files);
+            log_destroy(lm);
+            return 0;
+        }
+        else if (strcmp(command, "checkpoints") == 0) {
+            show_checkpoints();
+            return 0;
+        }
         else if (strcmp(command, "status") == 0) {
             show_status();
             return 0;
         }
         else if (strcmp(command, "log") == 0) {
-            show_log();
+            show_log(&log_query_filter, &log_page);
             return 0;
         }
         else {
@@ -507,10 +1040,21 @@ cleanup:
         file_watcher_stop(fw);
         file_watcher_destroy(fw);
     }
+    if (pool) {
+        diff_pool_destroy(pool);
+    }
     if (ws) {
         ws_disconnect(ws);
         ws_destroy(ws);
     }
+    if (writer) {
+        log_writer_destroy(writer);
+    }
+    if (worktree) {
+        // Baselines para a próxima partida (sem releitura dos arquivos inalterados)
+        versioning_flush_worktree_index(vm);
+        worktree_index_close(worktree);
+    }
     if (lm) {
         log_destroy(lm);
     }
@@ -519,6 +1063,7 @@ cleanup:
     }
 
     pthread_mutex_destroy(&operations_mutex);
+    pthread_mutex_destroy(&serial_mutex);
     log_message(LOG_INFO, "Shutdown complete");
     return 0;
 }
\ No newline at end of file
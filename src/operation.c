@@ -4,11 +4,45 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <jansson.h>
+#include <pthread.h>
+#include <time.h>
 #include "../include/operation.h"
 #include "../include/utils.h"
+#include "../include/document.h"
+
+// Relógio híbrido lógico: nanossegundos do relógio de parede, mas nunca repete nem
+// retrocede (avança 1 ns quando o relógio não andou) e incorpora tempos remotos
+static int64_t clock_last = 0;
+static pthread_mutex_t clock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int64_t operation_clock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    int64_t wall = (int64_t)ts.tv_sec * OPERATION_NS_PER_SEC + ts.tv_nsec;
+
+    pthread_mutex_lock(&clock_mutex);
+    clock_last = wall > clock_last ? wall : clock_last + 1;
+    int64_t now = clock_last;
+    pthread_mutex_unlock(&clock_mutex);
+
+    return now;
+}
+
+void operation_clock_observe(int64_t remote) {
+    pthread_mutex_lock(&clock_mutex);
+    if (remote > clock_last) clock_last = remote;
+    pthread_mutex_unlock(&clock_mutex);
+}
 
 Operation* operation_create(const char* type, int line, int column, const char* text, const char* author) {
+    return operation_create_n(type, line, column, text, text ? strlen(text) : 0, author);
+}
+
+// Texto delimitado por tamanho: aceita visões de linha sem '\0'
+Operation* operation_create_n(const char* type, int line, int column,
+                             const char* text, size_t text_len, const char* author) {
     Operation* op = (Operation*)safe_malloc(sizeof(Operation));
 
     strncpy(op->op_type, type, MAX_OP_TYPE_LEN - 1);
@@ -16,16 +50,47 @@ Operation* operation_create(const char* type, int line, int column, const char*
 
     op->line = line;
     op->column = column;
-    op->text = str_duplicate(text);
+    op->line_count = 1;
+    op->text = NULL;
+    if (text) {
+        op->text = (char*)safe_malloc(text_len + 1);
+        memcpy(op->text, text, text_len);
+        op->text[text_len] = '\0';
+    }
 
     strncpy(op->author, author, MAX_AUTHOR_LEN - 1);
     op->author[MAX_AUTHOR_LEN - 1] = '\0';
 
-    op->timestamp = time_get_unix();
+    op->hlc = operation_clock_now();
+    op->timestamp = (long)(op->hlc / OPERATION_NS_PER_SEC);
+    op->seq = 0;
+    op->filepath[0] = '\0';
 
     return op;
 }
 
+Operation* operation_copy(const Operation* op) {
+    if (!op) return NULL;
+
+    Operation* copy = (Operation*)safe_malloc(sizeof(Operation));
+    memcpy(copy, op, sizeof(Operation));
+    copy->text = str_duplicate(op->text);
+
+    return copy;
+}
+
+void operation_set_file(Operation* op, const char* filepath) {
+    if (!op) return;
+
+    // Caminhos são registrados relativos à raiz do projeto
+    if (filepath && strncmp(filepath, "./", 2) == 0) {
+        filepath += 2;
+    }
+
+    strncpy(op->filepath, filepath ? filepath : "", MAX_OP_PATH_LEN - 1);
+    op->filepath[MAX_OP_PATH_LEN - 1] = '\0';
+}
+
 void operation_destroy(Operation* op) {
     if (op) {
         safe_free(op->text);
@@ -40,9 +105,19 @@ char* operation_serialize(const Operation* op) {
     json_object_set_new(root, "op_type", json_string(op->op_type));
     json_object_set_new(root, "line", json_integer(op->line));
     json_object_set_new(root, "column", json_integer(op->column));
+    if (op->line_count != 1) {
+        json_object_set_new(root, "line_count", json_integer(op->line_count));
+    }
     json_object_set_new(root, "text", json_string(op->text));
     json_object_set_new(root, "author", json_string(op->author));
     json_object_set_new(root, "timestamp", json_integer(op->timestamp));
+    json_object_set_new(root, "hlc", json_integer(op->hlc));
+    if (op->seq) {
+        json_object_set_new(root, "seq", json_integer((json_int_t)op->seq));
+    }
+    if (op->filepath[0]) {
+        json_object_set_new(root, "file", json_string(op->filepath));
+    }
 
     char* json_str = json_dumps(root, JSON_COMPACT);
     json_decref(root);
@@ -68,6 +143,8 @@ Operation* operation_deserialize(const char* json_str) {
 
     op->line = json_integer_value(json_object_get(root, "line"));
     op->column = json_integer_value(json_object_get(root, "column"));
+    json_t* line_count = json_object_get(root, "line_count");
+    op->line_count = line_count ? (int)json_integer_value(line_count) : 1;
 
     const char* text = json_string_value(json_object_get(root, "text"));
     op->text = str_duplicate(text);
@@ -77,6 +154,10 @@ Operation* operation_deserialize(const char* json_str) {
     op->author[MAX_AUTHOR_LEN - 1] = '\0';
 
     op->timestamp = json_integer_value(json_object_get(root, "timestamp"));
+    op->hlc = json_integer_value(json_object_get(root, "hlc"));
+    if (!op->hlc) op->hlc = (int64_t)op->timestamp * OPERATION_NS_PER_SEC;
+    op->seq = (uint64_t)json_integer_value(json_object_get(root, "seq"));
+    operation_set_file(op, json_string_value(json_object_get(root, "file")));
 
     json_decref(root);
     return op;
@@ -89,33 +170,176 @@ int operation_apply_to_file(const Operation* op, const char* filepath) {
     char* content = file_read_all(filepath, &size);
     if (!content) return -1;
 
-    int line_count;
-    char** lines = str_split_lines(content, &line_count);
-    safe_free(content);
+    Document doc;
+    document_init(&doc, content, size);
 
-    if (op->line < 0 || op->line >= line_count) {
-        str_free_lines(lines, line_count);
+    int status = document_apply(&doc, op);
+    if (status == 0) {
+        status = document_write(&doc, filepath);
+    } else {
+        log_message(LOG_ERROR, "Operation %s at line %d, col %d does not apply to %s",
+                    op->op_type, op->line, op->column, filepath);
+    }
+
+    document_free(&doc);
+    return status;
+}
+
+// Codificação binária compacta usada pelo journal:
+// [u8 versão][u8 len tipo][u8 len autor][u8 reservado][i32 linha][i32 coluna]
+// [i64 timestamp][u32 len texto][u16 len arquivo][u16 reservado][u64 seq][i64 hlc]
+// [i32 linhas][tipo][autor][arquivo][texto]
+// A versão 1 não tinha o arquivo (cabeçalho de 24 bytes); a 2, seq e hlc (28 bytes);
+// a 3, a quantidade de linhas (44 bytes).
+#define OPERATION_ENCODED_HEADER_V1 24
+#define OPERATION_ENCODED_HEADER_V2 28
+#define OPERATION_ENCODED_HEADER_V3 44
+#define OPERATION_ENCODED_HEADER 48
+
+void* operation_encode(const Operation* op, size_t* size) {
+    if (!op) return NULL;
+    return operation_encode_seq(op, op->seq, size);
+}
+
+void* operation_encode_seq(const Operation* op, uint64_t seq, size_t* size) {
+    if (!op || !size) return NULL;
+
+    size_t type_len = strlen(op->op_type);
+    size_t author_len = strlen(op->author);
+    size_t file_len = strlen(op->filepath);
+    size_t text_len = op->text ? strlen(op->text) : 0;
+
+    size_t total = OPERATION_ENCODED_HEADER + type_len + author_len + file_len + text_len;
+    unsigned char* buf = (unsigned char*)safe_malloc(total);
+
+    int32_t line = op->line;
+    int32_t column = op->column;
+    int32_t line_count = op->line_count;
+    int64_t timestamp = op->timestamp;
+    uint32_t text_len32 = (uint32_t)text_len;
+    uint16_t file_len16 = (uint16_t)file_len;
+
+    buf[0] = OPERATION_ENCODING_VERSION;
+    buf[1] = (unsigned char)type_len;
+    buf[2] = (unsigned char)author_len;
+    buf[3] = 0;
+    memcpy(buf + 4, &line, 4);
+    memcpy(buf + 8, &column, 4);
+    memcpy(buf + 12, &timestamp, 8);
+    memcpy(buf + 20, &text_len32, 4);
+    memcpy(buf + 24, &file_len16, 2);
+    buf[26] = 0;
+    buf[27] = 0;
+    memcpy(buf + 28, &seq, 8);
+    memcpy(buf + 36, &op->hlc, 8);
+    memcpy(buf + 44, &line_count, 4);
+
+    unsigned char* p = buf + OPERATION_ENCODED_HEADER;
+    memcpy(p, op->op_type, type_len);
+    p += type_len;
+    memcpy(p, op->author, author_len);
+    p += author_len;
+    memcpy(p, op->filepath, file_len);
+    p += file_len;
+    if (text_len > 0) {
+        memcpy(p, op->text, text_len);
+    }
+
+    *size = total;
+    return buf;
+}
+
+int operation_view(const void* data, size_t size, OperationView* view) {
+    if (!data || !view || size < OPERATION_ENCODED_HEADER_V1) return -1;
+
+    const unsigned char* buf = (const unsigned char*)data;
+    if (buf[0] < 1 || buf[0] > OPERATION_ENCODING_VERSION) {
+        log_message(LOG_ERROR, "Unsupported operation encoding version %d", buf[0]);
         return -1;
     }
 
-    // Aplicar operação baseada no tipo
-    if (strcmp(op->op_type, "insert") == 0) {
-        // Implementar lógica de inserção
-        // Por enquanto, vamos apenas logar
-        log_message(LOG_INFO, "Applying INSERT operation at line %d, col %d",
-                    op->line, op->column);
-    } else if (strcmp(op->op_type, "delete") == 0) {
-        // Implementar lógica de deleção
-        log_message(LOG_INFO, "Applying DELETE operation at line %d, col %d",
-                    op->line, op->column);
-    } else if (strcmp(op->op_type, "replace") == 0) {
-        // Implementar lógica de substituição
-        log_message(LOG_INFO, "Applying REPLACE operation at line %d, col %d",
-                    op->line, op->column);
+    size_t header = OPERATION_ENCODED_HEADER_V1;
+    size_t type_len = buf[1];
+    size_t author_len = buf[2];
+
+    int32_t line, column, line_count = 1;
+    int64_t timestamp;
+    uint32_t text_len;
+    uint16_t file_len = 0;
+    uint64_t seq = 0;
+    memcpy(&line, buf + 4, 4);
+    memcpy(&column, buf + 8, 4);
+    memcpy(&timestamp, buf + 12, 8);
+    memcpy(&text_len, buf + 20, 4);
+    int64_t hlc = timestamp * OPERATION_NS_PER_SEC;
+
+    if (buf[0] >= 2) {
+        if (size < OPERATION_ENCODED_HEADER_V2) return -1;
+        header = OPERATION_ENCODED_HEADER_V2;
+        memcpy(&file_len, buf + 24, 2);
+    }
+    if (buf[0] >= 3) {
+        if (size < OPERATION_ENCODED_HEADER_V3) return -1;
+        header = OPERATION_ENCODED_HEADER_V3;
+        memcpy(&seq, buf + 28, 8);
+        memcpy(&hlc, buf + 36, 8);
+    }
+    if (buf[0] >= 4) {
+        if (size < OPERATION_ENCODED_HEADER) return -1;
+        header = OPERATION_ENCODED_HEADER;
+        memcpy(&line_count, buf + 44, 4);
+    }
+
+    if (type_len >= MAX_OP_TYPE_LEN || author_len >= MAX_AUTHOR_LEN || file_len >= MAX_OP_PATH_LEN ||
+        header + type_len + author_len + file_len + text_len != size) {
+        log_message(LOG_ERROR, "Malformed encoded operation");
+        return -1;
     }
 
-    // TODO: Reconstruir o arquivo com as mudanças aplicadas
+    const char* p = (const char*)buf + header;
+    view->op_type = p;
+    view->op_type_len = type_len;
+    view->author = p + type_len;
+    view->author_len = author_len;
+    view->filepath = p + type_len + author_len;
+    view->filepath_len = file_len;
+    view->text = p + type_len + author_len + file_len;
+    view->text_len = text_len;
+    view->line = line;
+    view->column = column;
+    view->line_count = line_count;
+    view->timestamp = (long)timestamp;
+    view->seq = seq;
+    view->hlc = hlc;
 
-    str_free_lines(lines, line_count);
     return 0;
-}
\ No newline at end of file
+}
+
+Operation* operation_decode(const void* data, size_t size) {
+    OperationView view;
+    if (operation_view(data, size, &view) != 0) return NULL;
+
+    Operation* op = (Operation*)safe_malloc(sizeof(Operation));
+
+    memcpy(op->op_type, view.op_type, view.op_type_len);
+    op->op_type[view.op_type_len] = '\0';
+
+    memcpy(op->author, view.author, view.author_len);
+    op->author[view.author_len] = '\0';
+
+    memcpy(op->filepath, view.filepath, view.filepath_len);
+    op->filepath[view.filepath_len] = '\0';
+
+    op->text = (char*)safe_malloc(view.text_len + 1);
+    memcpy(op->text, view.text, view.text_len);
+    op->text[view.text_len] = '\0';
+
+    op->line = view.line;
+    op->column = view.column;
+    op->line_count = view.line_count;
+    op->timestamp = view.timestamp;
+    op->seq = view.seq;
+    op->hlc = view.hlc;
+
+    return op;
+}
@@ -0,0 +1,869 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "snapshot_store.h"
+#include "utils.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define REF_BUCKETS_INITIAL 64
+
+// Versões de um caminho, na ordem em que foram anexadas ao arquivo de referências
+typedef struct {
+    int64_t hlc;
+    unsigned char digest[HASH_SHA256_SIZE];
+} RefVersion;
+
+typedef struct {
+    char path[MAX_OP_PATH_LEN];
+    uint64_t hash;
+    RefVersion* versions;
+    int count;
+    int capacity;
+} RefList;
+
+// Cada buffer comporta o maior valor montado a partir do anterior: snprintf nunca trunca
+#define SNAPSHOT_DIR_LEN 512
+#define SNAPSHOT_SUBDIR_LEN (SNAPSHOT_DIR_LEN + 16)                                // <dir>/objects, <dir>/refs
+#define SNAPSHOT_OBJECT_PATH_LEN (SNAPSHOT_SUBDIR_LEN + HASH_SHA256_HEX_SIZE + 2)  // <objects>/ab/cdef...
+#define SNAPSHOT_TMP_PATH_LEN (SNAPSHOT_OBJECT_PATH_LEN + 48)                      // <objeto>.tmp.<pid>.<id>
+
+struct SnapshotStore {
+    char dir[SNAPSHOT_DIR_LEN];
+    char objects_dir[SNAPSHOT_SUBDIR_LEN];
+    char refs_path[SNAPSHOT_SUBDIR_LEN];
+    int max_depth;          // Comprimento máximo das cadeias de deltas (0 = sem deltas)
+
+    // Referências em memória por caminho: o arquivo é lido uma vez e, depois, só
+    // os registros anexados desde a última leitura (por este ou outro processo)
+    pthread_mutex_t refs_mutex;
+    RefList* ref_lists;
+    int ref_list_count;
+    int ref_list_capacity;
+    int* ref_buckets;       // Índice em ref_lists + 1 (0 = vazio)
+    int ref_bucket_count;   // Potência de 2
+    off_t refs_loaded;      // Bytes do arquivo de referências já carregados
+};
+
+static const char* normalize_path(const char* path) {
+    // Caminhos são registrados relativos à raiz do projeto
+    if (strncmp(path, "./", 2) == 0) path += 2;
+    return path;
+}
+
+static void object_path(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE],
+                        char* out, size_t out_size) {
+    char hex[HASH_SHA256_HEX_SIZE];
+    hash_to_hex(digest, HASH_SHA256_SIZE, hex);
+    snprintf(out, out_size, "%s/%.2s/%s", store->objects_dir, hex, hex + 2);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int hex_decode(const char* hex, unsigned char digest[HASH_SHA256_SIZE]) {
+    for (int i = 0; i < HASH_SHA256_SIZE; i++) {
+        int hi = hex_value(hex[i * 2]);
+        int lo = hex_value(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) return -1;
+        digest[i] = (unsigned char)((hi << 4) | lo);
+    }
+    return 0;
+}
+
+SnapshotStore* snapshot_store_open(const char* versions_dir) {
+    if (!versions_dir) return NULL;
+
+    SnapshotStore* store = (SnapshotStore*)safe_malloc(sizeof(SnapshotStore));
+    strncpy(store->dir, versions_dir, sizeof(store->dir) - 1);
+    store->dir[sizeof(store->dir) - 1] = '\0';
+    snprintf(store->objects_dir, sizeof(store->objects_dir), "%s/%s", store->dir, SNAPSHOT_OBJECTS_DIR);
+    snprintf(store->refs_path, sizeof(store->refs_path), "%s/%s", store->dir, SNAPSHOT_REFS_FILE);
+    store->max_depth = SNAPSHOT_DEFAULT_MAX_DEPTH;
+    pthread_mutex_init(&store->refs_mutex, NULL);
+    store->ref_lists = NULL;
+    store->ref_list_count = 0;
+    store->ref_list_capacity = 0;
+    store->ref_bucket_count = REF_BUCKETS_INITIAL;
+    store->ref_buckets = (int*)safe_malloc(REF_BUCKETS_INITIAL * sizeof(int));
+    memset(store->ref_buckets, 0, REF_BUCKETS_INITIAL * sizeof(int));
+    store->refs_loaded = 0;
+
+    if (!dir_exists(store->objects_dir) && dir_create(store->objects_dir) != 0 && errno != EEXIST) {
+        log_message(LOG_ERROR, "Failed to create directory %s: %s", store->objects_dir, strerror(errno));
+        snapshot_store_close(store);
+        return NULL;
+    }
+
+    return store;
+}
+
+static void clear_ref_lists(SnapshotStore* store) {
+    for (int i = 0; i < store->ref_list_count; i++) {
+        safe_free(store->ref_lists[i].versions);
+    }
+    store->ref_list_count = 0;
+    memset(store->ref_buckets, 0, (size_t)store->ref_bucket_count * sizeof(int));
+    store->refs_loaded = 0;
+}
+
+void snapshot_store_close(SnapshotStore* store) {
+    if (!store) return;
+    clear_ref_lists(store);
+    safe_free(store->ref_lists);
+    safe_free(store->ref_buckets);
+    pthread_mutex_destroy(&store->refs_mutex);
+    safe_free(store);
+}
+
+void snapshot_store_set_max_depth(SnapshotStore* store, int max_depth) {
+    if (!store) return;
+    if (max_depth < 0) max_depth = 0;
+    if (max_depth > SNAPSHOT_MAX_CHAIN_LIMIT) max_depth = SNAPSHOT_MAX_CHAIN_LIMIT;
+    store->max_depth = max_depth;
+}
+
+int snapshot_store_has_object(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE]) {
+    if (!store || !digest) return 0;
+
+    char path[SNAPSHOT_OBJECT_PATH_LEN];
+    object_path(store, digest, path, sizeof(path));
+    return file_exists(path);
+}
+
+// Codificação de deltas: sequência de instruções contra o conteúdo base
+//   'C' varint(offset) varint(len)  copia bytes da base
+//   'I' varint(len) bytes           insere bytes literais
+#define DELTA_COPY 'C'
+#define DELTA_INSERT 'I'
+
+typedef struct {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static void buffer_reserve(Buffer* buf, size_t extra) {
+    if (buf->size + extra <= buf->capacity) return;
+    size_t capacity = buf->capacity ? buf->capacity : 256;
+    while (capacity < buf->size + extra) capacity *= 2;
+    buf->data = (unsigned char*)safe_realloc(buf->data, capacity);
+    buf->capacity = capacity;
+}
+
+static void buffer_append(Buffer* buf, const void* data, size_t len) {
+    buffer_reserve(buf, len);
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+}
+
+static void buffer_put_varint(Buffer* buf, uint64_t value) {
+    unsigned char bytes[10];
+    int n = 0;
+    do {
+        bytes[n] = (unsigned char)(value & 0x7F);
+        value >>= 7;
+        if (value) bytes[n] |= 0x80;
+        n++;
+    } while (value);
+    buffer_append(buf, bytes, n);
+}
+
+static int read_varint(const unsigned char** p, const unsigned char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p >= end) return -1;
+        unsigned char byte = *(*p)++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void emit_insert(Buffer* out, const char* data, size_t len) {
+    if (len == 0) return;
+    unsigned char cmd = DELTA_INSERT;
+    buffer_append(out, &cmd, 1);
+    buffer_put_varint(out, len);
+    buffer_append(out, data, len);
+}
+
+// Âncoras da base: início de cada linha e a cada DELTA_BLOCK bytes (conteúdo binário);
+// o alvo é sondado em todas as posições e as correspondências são estendidas nos dois sentidos.
+static unsigned char* delta_encode(const char* base, size_t base_len, const char* target, size_t target_len,
+                                   size_t* out_len) {
+    size_t anchors = base_len / SNAPSHOT_DELTA_BLOCK + 1;
+    for (size_t i = 0; i < base_len; i++) {
+        if (base[i] == '\n') anchors++;
+    }
+
+    size_t table_size = 64;
+    while (table_size < anchors * 2) table_size <<= 1;
+    uint64_t* table = (uint64_t*)safe_malloc(table_size * sizeof(uint64_t));
+    memset(table, 0xFF, table_size * sizeof(uint64_t));
+
+    for (size_t i = 0; i + SNAPSHOT_DELTA_MIN_MATCH <= base_len; i++) {
+        if (i != 0 && base[i - 1] != '\n' && i % SNAPSHOT_DELTA_BLOCK != 0) continue;
+
+        size_t slot = hash_bytes64(base + i, SNAPSHOT_DELTA_MIN_MATCH, 0) & (table_size - 1);
+        while (table[slot] != UINT64_MAX) slot = (slot + 1) & (table_size - 1);
+        table[slot] = i;
+    }
+
+    Buffer out = {0};
+    buffer_put_varint(&out, base_len);
+    buffer_put_varint(&out, target_len);
+
+    size_t literal_start = 0;
+    size_t pos = 0;
+    while (pos + SNAPSHOT_DELTA_MIN_MATCH <= target_len) {
+        size_t slot = hash_bytes64(target + pos, SNAPSHOT_DELTA_MIN_MATCH, 0) & (table_size - 1);
+
+        size_t best_offset = 0, best_len = 0;
+        for (; table[slot] != UINT64_MAX; slot = (slot + 1) & (table_size - 1)) {
+            size_t offset = table[slot];
+            if (memcmp(base + offset, target + pos, SNAPSHOT_DELTA_MIN_MATCH) != 0) continue;
+
+            size_t len = SNAPSHOT_DELTA_MIN_MATCH;
+            while (offset + len < base_len && pos + len < target_len && base[offset + len] == target[pos + len]) {
+                len++;
+            }
+            if (len > best_len) {
+                best_len = len;
+                best_offset = offset;
+            }
+        }
+
+        if (best_len == 0) {
+            pos++;
+            continue;
+        }
+
+        // Estender para trás sobre os literais pendentes
+        while (pos > literal_start && best_offset > 0 && base[best_offset - 1] == target[pos - 1]) {
+            pos--;
+            best_offset--;
+            best_len++;
+        }
+
+        emit_insert(&out, target + literal_start, pos - literal_start);
+
+        unsigned char cmd = DELTA_COPY;
+        buffer_append(&out, &cmd, 1);
+        buffer_put_varint(&out, best_offset);
+        buffer_put_varint(&out, best_len);
+
+        pos += best_len;
+        literal_start = pos;
+    }
+    emit_insert(&out, target + literal_start, target_len - literal_start);
+
+    safe_free(table);
+    *out_len = out.size;
+    return out.data;
+}
+
+static char* delta_apply(const char* base, size_t base_len, const unsigned char* delta, size_t delta_len,
+                         size_t* out_len) {
+    const unsigned char* p = delta;
+    const unsigned char* end = delta + delta_len;
+
+    uint64_t expected_base, target_len;
+    if (read_varint(&p, end, &expected_base) != 0 || read_varint(&p, end, &target_len) != 0 ||
+        expected_base != base_len) {
+        return NULL;
+    }
+
+    char* out = (char*)safe_malloc(target_len + 1);
+    size_t size = 0;
+
+    while (p < end) {
+        unsigned char cmd = *p++;
+        uint64_t offset = 0, len;
+
+        if (cmd == DELTA_COPY) {
+            if (read_varint(&p, end, &offset) != 0 || read_varint(&p, end, &len) != 0 ||
+                offset > base_len || len > base_len - offset || len > target_len - size) {
+                break;
+            }
+            memcpy(out + size, base + offset, len);
+        } else if (cmd == DELTA_INSERT) {
+            if (read_varint(&p, end, &len) != 0 || len > (uint64_t)(end - p) || len > target_len - size) {
+                break;
+            }
+            memcpy(out + size, p, len);
+            p += len;
+        } else {
+            break;
+        }
+        size += len;
+    }
+
+    if (p != end || size != target_len) {
+        safe_free(out);
+        return NULL;
+    }
+
+    out[size] = '\0';
+    *out_len = size;
+    return out;
+}
+
+// Objetos em disco
+
+// Sufixo dos temporários: único por gravação, pois threads do mesmo processo podem
+// gravar o mesmo objeto ao mesmo tempo (despejo de baselines iguais)
+static unsigned long next_tmp_id(void) {
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    static unsigned long counter = 0;
+    pthread_mutex_lock(&mutex);
+    unsigned long id = counter++;
+    pthread_mutex_unlock(&mutex);
+    return id;
+}
+
+static int read_object_header(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE],
+                              SnapshotObjectHeader* header) {
+    char path[SNAPSHOT_OBJECT_PATH_LEN];
+    object_path(store, digest, path, sizeof(path));
+
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+
+    size_t n = fread(header, 1, sizeof(*header), file);
+    fclose(file);
+
+    // Objetos gravados antes do formato com cabeçalho: conteúdo bruto, sem compressão
+    if (n < sizeof(*header) || memcmp(header->magic, SNAPSHOT_OBJECT_MAGIC, 8) != 0) {
+        memset(header, 0, sizeof(*header));
+        header->kind = SNAPSHOT_OBJECT_FULL;
+        header->compression = SNAPSHOT_COMPRESS_NONE;
+    }
+    return 0;
+}
+
+// Grava (ou regrava, no repack) o objeto; usa delta contra `base` se o encadeamento permitir
+static int write_object(SnapshotStore* store, const void* data, size_t len,
+                        const unsigned char digest[HASH_SHA256_SIZE],
+                        const unsigned char* base, SnapshotStoreStats* stats) {
+    SnapshotObjectHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_OBJECT_MAGIC, 8);
+    header.kind = SNAPSHOT_OBJECT_FULL;
+    header.size = len;
+
+    const unsigned char* body = (const unsigned char*)data;
+    size_t body_len = len;
+    unsigned char* delta = NULL;
+
+    SnapshotObjectHeader base_header;
+    if (base && store->max_depth > 0 && memcmp(base, digest, HASH_SHA256_SIZE) != 0 &&
+        read_object_header(store, base, &base_header) == 0 && base_header.depth < store->max_depth) {
+        size_t base_len;
+        char* base_data = snapshot_store_get_object(store, base, &base_len);
+        if (base_data) {
+            size_t delta_len;
+            delta = delta_encode(base_data, base_len, (const char*)data, len, &delta_len);
+
+            // Delta só compensa se for bem menor que o conteúdo
+            if (delta_len < len / 2) {
+                header.kind = SNAPSHOT_OBJECT_DELTA;
+                header.depth = (uint16_t)(base_header.depth + 1);
+                memcpy(header.base, base, HASH_SHA256_SIZE);
+                body = delta;
+                body_len = delta_len;
+            }
+            safe_free(base_data);
+        }
+    }
+
+    // Compressão do corpo (mantida apenas quando reduz o tamanho)
+    header.body_size = body_len;
+    uLongf compressed_len = compressBound(body_len);
+    unsigned char* compressed = (unsigned char*)safe_malloc(compressed_len);
+    if (compress2(compressed, &compressed_len, body, body_len, SNAPSHOT_COMPRESSION_LEVEL) == Z_OK &&
+        compressed_len < body_len) {
+        header.compression = SNAPSHOT_COMPRESS_ZLIB;
+        body = compressed;
+        body_len = compressed_len;
+    }
+
+    char path[SNAPSHOT_OBJECT_PATH_LEN];
+    object_path(store, digest, path, sizeof(path));
+
+    char fanout[SNAPSHOT_OBJECT_PATH_LEN];
+    strncpy(fanout, path, sizeof(fanout) - 1);
+    fanout[sizeof(fanout) - 1] = '\0';
+    *strrchr(fanout, '/') = '\0';
+
+    // Conteúdo pequeno e incompressível fica bruto, sem o custo do cabeçalho
+    int raw = header.kind == SNAPSHOT_OBJECT_FULL && header.compression == SNAPSHOT_COMPRESS_NONE &&
+              (len < 8 || memcmp(data, SNAPSHOT_OBJECT_MAGIC, 8) != 0);
+    size_t header_len = raw ? 0 : sizeof(header);
+
+    int result = -1;
+    if (dir_exists(fanout) || dir_create(fanout) == 0 || errno == EEXIST) {
+        // Escrita atômica: leitores nunca veem um objeto parcial
+        char tmp_path[SNAPSHOT_TMP_PATH_LEN];
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%d.%lu", path, (int)getpid(), next_tmp_id());
+
+        FILE* file = fopen(tmp_path, "wb");
+        if (file) {
+            int ok = fwrite(&header, 1, header_len, file) == header_len &&
+                     fwrite(body, 1, body_len, file) == body_len;
+            ok = (fclose(file) == 0) && ok;
+            if (ok && rename(tmp_path, path) == 0) {
+                result = 0;
+            } else {
+                unlink(tmp_path);
+            }
+        }
+    }
+
+    if (result == 0 && stats) {
+        stats->objects++;
+        stats->bytes += header_len + body_len;
+        if (header.kind == SNAPSHOT_OBJECT_DELTA) stats->deltas++;
+    } else if (result != 0) {
+        log_message(LOG_ERROR, "Failed to write snapshot object %s: %s", path, strerror(errno));
+    }
+
+    safe_free(compressed);
+    safe_free(delta);
+    return result;
+}
+
+int snapshot_store_put_object(SnapshotStore* store, const void* data, size_t len,
+                              unsigned char digest[HASH_SHA256_SIZE]) {
+    if (!store || (!data && len > 0) || !digest) return -1;
+
+    hash_sha256(data, len, digest);
+
+    // Conteúdo já armazenado: nenhum byte novo
+    if (snapshot_store_has_object(store, digest)) return 0;
+
+    return write_object(store, data, len, digest, NULL, NULL);
+}
+
+static char* load_object(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE],
+                         size_t* len, int depth) {
+    if (depth > SNAPSHOT_MAX_CHAIN_LIMIT) {
+        log_message(LOG_ERROR, "Snapshot delta chain too long (corrupted store?)");
+        return NULL;
+    }
+
+    char path[SNAPSHOT_OBJECT_PATH_LEN];
+    object_path(store, digest, path, sizeof(path));
+
+    size_t size;
+    char* data = file_read_all(path, &size);
+    if (!data) return NULL;
+
+    SnapshotObjectHeader header;
+    if (size < sizeof(header) || memcmp(data, SNAPSHOT_OBJECT_MAGIC, 8) != 0) {
+        // Objeto bruto (formato anterior)
+        if (len) *len = size;
+        return data;
+    }
+    memcpy(&header, data, sizeof(header));
+
+    unsigned char* body = (unsigned char*)data + sizeof(header);
+    size_t body_len = size - sizeof(header);
+    unsigned char* inflated = NULL;
+
+    if (header.compression == SNAPSHOT_COMPRESS_ZLIB) {
+        uLongf inflated_len = header.body_size;
+        inflated = (unsigned char*)safe_malloc(header.body_size + 1);
+        if (uncompress(inflated, &inflated_len, body, body_len) != Z_OK || inflated_len != header.body_size) {
+            log_message(LOG_ERROR, "Corrupted snapshot object %s", path);
+            safe_free(inflated);
+            safe_free(data);
+            return NULL;
+        }
+        body = inflated;
+        body_len = inflated_len;
+    }
+
+    char* content = NULL;
+    size_t content_len = 0;
+
+    if (header.kind == SNAPSHOT_OBJECT_DELTA) {
+        size_t base_len;
+        char* base = load_object(store, header.base, &base_len, depth + 1);
+        if (base) {
+            content = delta_apply(base, base_len, body, body_len, &content_len);
+            safe_free(base);
+        }
+    } else {
+        content = (char*)safe_malloc(body_len + 1);
+        memcpy(content, body, body_len);
+        content[body_len] = '\0';
+        content_len = body_len;
+    }
+
+    if (!content || content_len != header.size) {
+        log_message(LOG_ERROR, "Failed to reconstruct snapshot object %s", path);
+        safe_free(content);
+        content = NULL;
+    } else if (len) {
+        *len = content_len;
+    }
+
+    safe_free(inflated);
+    safe_free(data);
+    return content;
+}
+
+char* snapshot_store_get_object(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE],
+                                size_t* len) {
+    if (!store || !digest) return NULL;
+    return load_object(store, digest, len, 0);
+}
+
+static SnapshotRef* load_refs(SnapshotStore* store, int* count) {
+    *count = 0;
+    if (!file_exists(store->refs_path)) return NULL;
+
+    size_t size;
+    char* data = file_read_all(store->refs_path, &size);
+    if (!data) return NULL;
+
+    // Um registro parcial no fim (escrita interrompida) é ignorado
+    *count = (int)(size / sizeof(SnapshotRef));
+    return (SnapshotRef*)data;
+}
+
+// Lista de versões do caminho (sondagem linear); criada se `create`
+static RefList* find_ref_list(SnapshotStore* store, const char* path, int create) {
+    uint64_t hash = hash_bytes64(path, strlen(path), 0);
+    int mask = store->ref_bucket_count - 1;
+    int b = (int)(hash & (uint64_t)mask);
+    for (; store->ref_buckets[b]; b = (b + 1) & mask) {
+        RefList* list = &store->ref_lists[store->ref_buckets[b] - 1];
+        if (list->hash == hash && strncmp(list->path, path, MAX_OP_PATH_LEN) == 0) return list;
+    }
+    if (!create) return NULL;
+
+    if (store->ref_list_count >= store->ref_list_capacity) {
+        store->ref_list_capacity = store->ref_list_capacity ? store->ref_list_capacity * 2 : 64;
+        store->ref_lists = (RefList*)safe_realloc(store->ref_lists,
+                                                  (size_t)store->ref_list_capacity * sizeof(RefList));
+    }
+    RefList* list = &store->ref_lists[store->ref_list_count++];
+    memset(list, 0, sizeof(*list));
+    strncpy(list->path, path, MAX_OP_PATH_LEN - 1);
+    list->hash = hash;
+    store->ref_buckets[b] = store->ref_list_count;
+
+    // Ocupação abaixo de 1/2
+    if (store->ref_list_count * 2 > store->ref_bucket_count) {
+        store->ref_bucket_count *= 2;
+        store->ref_buckets = (int*)safe_realloc(store->ref_buckets, (size_t)store->ref_bucket_count * sizeof(int));
+        memset(store->ref_buckets, 0, (size_t)store->ref_bucket_count * sizeof(int));
+        mask = store->ref_bucket_count - 1;
+        for (int i = 0; i < store->ref_list_count; i++) {
+            int slot = (int)(store->ref_lists[i].hash & (uint64_t)mask);
+            while (store->ref_buckets[slot]) slot = (slot + 1) & mask;
+            store->ref_buckets[slot] = i + 1;
+        }
+    }
+    return list;
+}
+
+// Carrega os registros anexados desde a última chamada (com refs_mutex). Um
+// registro parcial no fim (escrita interrompida ou em andamento) fica para depois.
+static void sync_refs(SnapshotStore* store) {
+    struct stat st;
+    if (stat(store->refs_path, &st) != 0) {
+        if (store->refs_loaded > 0) clear_ref_lists(store);
+        return;
+    }
+    if (st.st_size < store->refs_loaded) clear_ref_lists(store);   // Arquivo regravado
+
+    size_t pending = (size_t)(st.st_size - store->refs_loaded) / sizeof(SnapshotRef);
+    if (pending == 0) return;
+
+    int fd = open(store->refs_path, O_RDONLY);
+    if (fd < 0) return;
+
+    SnapshotRef* refs = (SnapshotRef*)safe_malloc(pending * sizeof(SnapshotRef));
+    ssize_t n = pread(fd, refs, pending * sizeof(SnapshotRef), store->refs_loaded);
+    close(fd);
+
+    size_t loaded = n > 0 ? (size_t)n / sizeof(SnapshotRef) : 0;
+    for (size_t i = 0; i < loaded; i++) {
+        refs[i].path[MAX_OP_PATH_LEN - 1] = '\0';
+        RefList* list = find_ref_list(store, refs[i].path, 1);
+        if (list->count >= list->capacity) {
+            list->capacity = list->capacity ? list->capacity * 2 : 4;
+            list->versions = (RefVersion*)safe_realloc(list->versions, (size_t)list->capacity * sizeof(RefVersion));
+        }
+        RefVersion* version = &list->versions[list->count++];
+        version->hlc = snapshot_ref_hlc(&refs[i]);
+        memcpy(version->digest, refs[i].digest, HASH_SHA256_SIZE);
+    }
+    store->refs_loaded += (off_t)(loaded * sizeof(SnapshotRef));
+    safe_free(refs);
+}
+
+static int append_ref(SnapshotStore* store, const SnapshotRef* ref) {
+    int fd = open(store->refs_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        log_message(LOG_ERROR, "Failed to open snapshot refs %s: %s", store->refs_path, strerror(errno));
+        return -1;
+    }
+
+    int result = write(fd, ref, sizeof(SnapshotRef)) == (ssize_t)sizeof(SnapshotRef) ? 0 : -1;
+    close(fd);
+
+    if (result != 0) {
+        log_message(LOG_ERROR, "Failed to append snapshot ref: %s", strerror(errno));
+    }
+    return result;
+}
+
+int snapshot_store_resolve(SnapshotStore* store, const char* path, long at, SnapshotRef* ref) {
+    int64_t until = at ? ((int64_t)at + 1) * OPERATION_NS_PER_SEC - 1 : INT64_MAX;
+    return snapshot_store_resolve_hlc(store, path, until, ref);
+}
+
+int snapshot_store_resolve_hlc(SnapshotStore* store, const char* path, int64_t hlc, SnapshotRef* ref) {
+    if (!store || !path || !ref) return -1;
+
+    path = normalize_path(path);
+
+    pthread_mutex_lock(&store->refs_mutex);
+    sync_refs(store);
+
+    // Referências são anexadas em ordem de tempo: procurar do fim para o início
+    int found = -1;
+    const RefList* list = find_ref_list(store, path, 0);
+    for (int i = list ? list->count - 1 : -1; i >= 0; i--) {
+        if (list->versions[i].hlc > hlc) continue;
+
+        memset(ref, 0, sizeof(*ref));
+        ref->timestamp = list->versions[i].hlc;
+        memcpy(ref->digest, list->versions[i].digest, HASH_SHA256_SIZE);
+        snprintf(ref->path, sizeof(ref->path), "%s", list->path);
+        found = 0;
+        break;
+    }
+    pthread_mutex_unlock(&store->refs_mutex);
+
+    return found;
+}
+
+int snapshot_store_save(SnapshotStore* store, const char* path, const void* data, size_t len,
+                        int64_t hlc, unsigned char digest[HASH_SHA256_SIZE]) {
+    if (!store || !path) return -1;
+
+    unsigned char local_digest[HASH_SHA256_SIZE];
+    if (!digest) digest = local_digest;
+
+    hash_sha256(data, len, digest);
+
+    // Arquivo inalterado desde o último snapshot: nada a registrar
+    SnapshotRef latest;
+    int has_latest = snapshot_store_resolve(store, path, 0, &latest) == 0;
+    if (has_latest && memcmp(latest.digest, digest, HASH_SHA256_SIZE) == 0) {
+        return 0;
+    }
+
+    // Conteúdo novo: delta contra a versão anterior do mesmo arquivo
+    if (!snapshot_store_has_object(store, digest) &&
+        write_object(store, data, len, digest, has_latest ? latest.digest : NULL, NULL) != 0) {
+        return -1;
+    }
+
+    SnapshotRef ref;
+    memset(&ref, 0, sizeof(ref));
+    ref.timestamp = hlc;
+    memcpy(ref.digest, digest, HASH_SHA256_SIZE);
+    strncpy(ref.path, normalize_path(path), MAX_OP_PATH_LEN - 1);
+
+    return append_ref(store, &ref);
+}
+
+int snapshot_store_resolve_digest(SnapshotStore* store, const char* hex_prefix,
+                                  unsigned char digest[HASH_SHA256_SIZE]) {
+    if (!store || !hex_prefix || !digest) return -1;
+
+    size_t len = strlen(hex_prefix);
+    if (len < 4 || len > HASH_SHA256_SIZE * 2) return -1;
+    char prefix[HASH_SHA256_HEX_SIZE];
+    for (size_t i = 0; i < len; i++) {
+        if (hex_value(hex_prefix[i]) < 0) return -1;
+        prefix[i] = (char)tolower((unsigned char)hex_prefix[i]);
+    }
+    prefix[len] = '\0';
+
+    // O prefixo determina o diretório de fan-out; basta listar esse diretório
+    char fanout[SNAPSHOT_OBJECT_PATH_LEN];
+    snprintf(fanout, sizeof(fanout), "%s/%.2s", store->objects_dir, prefix);
+    DIR* dir = opendir(fanout);
+    if (!dir) return -1;
+
+    char match[HASH_SHA256_HEX_SIZE] = "";
+    int matches = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strlen(entry->d_name) != HASH_SHA256_SIZE * 2 - 2) continue;
+        if (strncmp(entry->d_name, prefix + 2, len - 2) != 0) continue;
+
+        // Nome com o comprimento verificado acima: prefixo do diretório + resto do digest
+        memcpy(match, prefix, 2);
+        memcpy(match + 2, entry->d_name, HASH_SHA256_SIZE * 2 - 2);
+        match[HASH_SHA256_SIZE * 2] = '\0';
+        matches++;
+    }
+    closedir(dir);
+
+    if (matches != 1) {
+        if (matches > 1) log_message(LOG_ERROR, "Ambiguous snapshot id %s", hex_prefix);
+        return -1;
+    }
+
+    return hex_decode(match, digest);
+}
+
+SnapshotRef* snapshot_store_list(SnapshotStore* store, const char* path, int* count) {
+    if (!store || !count) return NULL;
+
+    int total;
+    SnapshotRef* refs = load_refs(store, &total);
+    if (!path) {
+        *count = total;
+        return refs;
+    }
+
+    path = normalize_path(path);
+    int n = 0;
+    for (int i = 0; i < total; i++) {
+        if (strncmp(refs[i].path, path, MAX_OP_PATH_LEN) == 0) {
+            refs[n++] = refs[i];
+        }
+    }
+
+    *count = n;
+    return refs;
+}
+
+// Repack
+
+// Conjunto de digests já regravados (endereçamento aberto)
+typedef struct {
+    unsigned char (*digests)[HASH_SHA256_SIZE];
+    char* used;
+    size_t capacity;
+} DigestSet;
+
+static int digest_set_insert(DigestSet* set, const unsigned char digest[HASH_SHA256_SIZE]) {
+    uint64_t key;
+    memcpy(&key, digest, sizeof(key));
+
+    size_t slot = key & (set->capacity - 1);
+    while (set->used[slot]) {
+        if (memcmp(set->digests[slot], digest, HASH_SHA256_SIZE) == 0) return 0;
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+
+    set->used[slot] = 1;
+    memcpy(set->digests[slot], digest, HASH_SHA256_SIZE);
+    return 1;
+}
+
+static int compare_refs_by_path(const void* a, const void* b) {
+    const SnapshotRef* x = *(const SnapshotRef* const*)a;
+    const SnapshotRef* y = *(const SnapshotRef* const*)b;
+    int cmp = strncmp(x->path, y->path, MAX_OP_PATH_LEN);
+    if (cmp != 0) return cmp;
+    if (x->timestamp != y->timestamp) return x->timestamp < y->timestamp ? -1 : 1;
+    return (x > y) - (x < y);   // Mantém a ordem de anexação
+}
+
+static long object_file_size(SnapshotStore* store, const unsigned char digest[HASH_SHA256_SIZE]) {
+    char path[SNAPSHOT_OBJECT_PATH_LEN];
+    object_path(store, digest, path, sizeof(path));
+    return file_exists(path) ? file_get_size(path) : 0;
+}
+
+int snapshot_store_repack(SnapshotStore* store, SnapshotStoreStats* stats) {
+    if (!store) return -1;
+
+    SnapshotStoreStats local;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    int count;
+    SnapshotRef* refs = load_refs(store, &count);
+    if (count == 0) {
+        safe_free(refs);
+        return 0;
+    }
+
+    // Versões de cada arquivo em ordem de tempo: cada uma vira delta da anterior,
+    // com um objeto completo a cada max_depth versões
+    SnapshotRef** order = (SnapshotRef**)safe_malloc(count * sizeof(SnapshotRef*));
+    for (int i = 0; i < count; i++) order[i] = &refs[i];
+    qsort(order, count, sizeof(SnapshotRef*), compare_refs_by_path);
+
+    // Cada objeto é regravado uma única vez e apenas contra bases já regravadas,
+    // o que impede ciclos quando o mesmo conteúdo aparece em várias versões
+    DigestSet done;
+    done.capacity = 64;
+    while (done.capacity < (size_t)count * 2) done.capacity <<= 1;
+    done.digests = safe_malloc(done.capacity * HASH_SHA256_SIZE);
+    done.used = (char*)safe_malloc(done.capacity);
+    memset(done.used, 0, done.capacity);
+
+    int result = 0;
+    const unsigned char* previous = NULL;
+    for (int i = 0; i < count; i++) {
+        const SnapshotRef* ref = order[i];
+        if (i > 0 && strncmp(ref->path, order[i - 1]->path, MAX_OP_PATH_LEN) != 0) {
+            previous = NULL;
+        }
+
+        if (!digest_set_insert(&done, ref->digest)) {
+            previous = ref->digest;
+            continue;
+        }
+
+        size_t len;
+        char* content = snapshot_store_get_object(store, ref->digest, &len);
+        if (!content) {
+            log_message(LOG_WARNING, "Skipping missing snapshot of %s", ref->path);
+            continue;
+        }
+
+        stats->bytes_before += object_file_size(store, ref->digest);
+        if (write_object(store, content, len, ref->digest, previous, stats) != 0) {
+            result = -1;
+        }
+        safe_free(content);
+
+        previous = ref->digest;
+    }
+
+    safe_free(done.digests);
+    safe_free(done.used);
+    safe_free(order);
+    safe_free(refs);
+
+    log_message(LOG_INFO, "Repacked %llu snapshot objects (%llu deltas): %llu -> %llu bytes",
+                stats->objects, stats->deltas, stats->bytes_before, stats->bytes);
+    return result;
+}
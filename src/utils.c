@@ -2,6 +2,7 @@
 // Created by HP on 08/07/2025.
 //
 #include "../include/utils.h"
+#include <stdint.h>
 #include <stdarg.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -110,8 +111,8 @@ char** str_split_lines(const char* text, int* line_count) {
         p++;
     }
 
-    // Última linha
-    if (start < p) {
+    // Última linha (vazia quando o texto termina em '\n')
+    if (i < count) {
         size_t len = p - start;
         lines[i] = (char*)safe_malloc(len + 1);
         strncpy(lines[i], start, len);
@@ -147,11 +148,143 @@ char* str_trim(char* str) {
     return str;
 }
 
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+char* str_base64_encode(const void* data, size_t len, size_t* out_len) {
+    const unsigned char* in = (const unsigned char*)data;
+    size_t size = (len + 2) / 3 * 4;
+    char* out = (char*)safe_malloc(size + 1);
+
+    char* p = out;
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        uint32_t v = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        *p++ = BASE64_ALPHABET[(v >> 18) & 63];
+        *p++ = BASE64_ALPHABET[(v >> 12) & 63];
+        *p++ = BASE64_ALPHABET[(v >> 6) & 63];
+        *p++ = BASE64_ALPHABET[v & 63];
+    }
+    if (i < len) {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)in[i + 1] << 8;
+        *p++ = BASE64_ALPHABET[(v >> 18) & 63];
+        *p++ = BASE64_ALPHABET[(v >> 12) & 63];
+        *p++ = i + 1 < len ? BASE64_ALPHABET[(v >> 6) & 63] : '=';
+        *p++ = '=';
+    }
+    *p = '\0';
+
+    if (out_len) *out_len = size;
+    return out;
+}
+
+static int base64_value(char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+// NULL se o texto não for base64 válido
+void* str_base64_decode(const char* text, size_t len, size_t* out_len) {
+    if (!text || len % 4 != 0) return NULL;
+
+    size_t padding = 0;
+    if (len > 0 && text[len - 1] == '=') padding++;
+    if (len > 1 && text[len - 2] == '=') padding++;
+
+    size_t size = len / 4 * 3 - padding;
+    unsigned char* out = (unsigned char*)safe_malloc(size + 1);
+    size_t o = 0;
+
+    for (size_t i = 0; i < len; i += 4) {
+        uint32_t v = 0;
+        for (size_t j = 0; j < 4; j++) {
+            int d = (text[i + j] == '=' && i + 4 == len && j >= 4 - padding) ? 0 : base64_value(text[i + j]);
+            if (d < 0) {
+                safe_free(out);
+                return NULL;
+            }
+            v = (v << 6) | (uint32_t)d;
+        }
+        if (o < size) out[o++] = (unsigned char)(v >> 16);
+        if (o < size) out[o++] = (unsigned char)(v >> 8);
+        if (o < size) out[o++] = (unsigned char)v;
+    }
+    out[size] = '\0';
+
+    if (out_len) *out_len = size;
+    return out;
+}
+
 // Funções de tempo
 long time_get_unix(void) {
     return (long)time(NULL);
 }
 
+// Aceita: segundos desde a época, "now", "today", "yesterday", "N[smhdw]"
+// (N unidades atrás) e "YYYY-MM-DD[ HH:MM[:SS]]" no horário local
+int time_parse(const char* text, long* timestamp) {
+    if (!text || !timestamp) return -1;
+
+    long now = time_get_unix();
+    if (strcmp(text, "now") == 0) {
+        *timestamp = now;
+        return 0;
+    }
+
+    if (strcmp(text, "today") == 0 || strcmp(text, "yesterday") == 0) {
+        time_t t = (time_t)now;
+        struct tm tm_info;
+        localtime_r(&t, &tm_info);
+        tm_info.tm_hour = tm_info.tm_min = tm_info.tm_sec = 0;
+        if (text[0] == 'y') tm_info.tm_mday--;
+        tm_info.tm_isdst = -1;
+        *timestamp = (long)mktime(&tm_info);
+        return 0;
+    }
+
+    struct tm tm_info;
+    memset(&tm_info, 0, sizeof(tm_info));
+    int consumed = 0;
+    if (sscanf(text, "%4d-%2d-%2d%n", &tm_info.tm_year, &tm_info.tm_mon, &tm_info.tm_mday, &consumed) == 3 &&
+        consumed == 10) {
+        const char* rest = text + consumed;
+        if (*rest == ' ' || *rest == 'T') {
+            int n = sscanf(rest + 1, "%2d:%2d:%2d", &tm_info.tm_hour, &tm_info.tm_min, &tm_info.tm_sec);
+            if (n < 2) return -1;
+        } else if (*rest != '\0') {
+            return -1;
+        }
+        tm_info.tm_year -= 1900;
+        tm_info.tm_mon -= 1;
+        tm_info.tm_isdst = -1;
+        *timestamp = (long)mktime(&tm_info);
+        return 0;
+    }
+
+    char* end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0) return -1;
+
+    long unit;
+    switch (*end) {
+        case '\0': *timestamp = value; return 0;
+        case 's': unit = 1; break;
+        case 'm': unit = 60; break;
+        case 'h': unit = 3600; break;
+        case 'd': unit = 86400; break;
+        case 'w': unit = 7 * 86400; break;
+        default: return -1;
+    }
+    if (end[1] != '\0') return -1;
+
+    *timestamp = now - value * unit;
+    return 0;
+}
+
 char* time_format(long timestamp) {
     static char buffer[64];
     struct tm* tm_info = localtime(&timestamp);
@@ -2,21 +2,19 @@
 // Created by HP on 08/07/2025.
 //
 #include "versioning.h"
+#include "diff.h"
 #include "utils.h"
+#include "hash.h"
+#include "block_delta.h"
 #include <dirent.h>
 #include <errno.h>
+#include <unistd.h>
 #include <assert.h>
 #include <string.h>
 
 #define INITIAL_CAPACITY 10
-#define LCS_THRESHOLD 1000  // Threshold para usar LCS vs algoritmo simples
-
-// Estrutura para armazenar uma linha com hash
-typedef struct {
-    char* content;
-    size_t length;
-    unsigned long hash;
-} LineInfo;
+#define INITIAL_BUCKETS 16
+#define PATH_HASH_SEED 0x66696c6573746174ULL   // "filestat"
 
 // Estrutura para resultado do diff
 typedef struct {
@@ -30,6 +28,23 @@ VersioningManager* versioning_create(void) {
     vm->files = (FileState**)safe_malloc(INITIAL_CAPACITY * sizeof(FileState*));
     vm->file_count = 0;
     vm->capacity = INITIAL_CAPACITY;
+    vm->bucket_count = INITIAL_BUCKETS;
+    vm->bucket_used = 0;
+    vm->buckets = (int*)safe_malloc(INITIAL_BUCKETS * sizeof(int));
+    for (int i = 0; i < INITIAL_BUCKETS; i++) vm->buckets[i] = VERSIONING_BUCKET_EMPTY;
+    pthread_rwlock_init(&vm->lock, NULL);
+    pthread_mutex_init(&vm->stats_mutex, NULL);
+    memset(&vm->stats, 0, sizeof(vm->stats));
+    vm->baseline_store = NULL;
+    vm->memory_budget = 0;
+    pthread_mutex_init(&vm->cache_mutex, NULL);
+    pthread_cond_init(&vm->cache_cond, NULL);
+    vm->lru_head = NULL;
+    vm->lru_tail = NULL;
+    memset(&vm->cache, 0, sizeof(vm->cache));
+    vm->worktree = NULL;
+    versioning_set_intraline(vm, VERSIONING_INTRALINE_DEFAULT);
+    versioning_set_diff_budget(vm, VERSIONING_DIFF_BUDGET_MS);
 
     log_message(LOG_DEBUG, "Created versioning manager");
     return vm;
@@ -38,25 +53,100 @@ VersioningManager* versioning_create(void) {
 void versioning_destroy(VersioningManager* vm) {
     if (!vm) return;
 
+    const VersioningDiffStats* stats = &vm->stats;
+    if (stats->diffs > 0) {
+        log_message(LOG_INFO, "Diffs: %llu (myers %llu, patience %llu; %llu over budget), "
+                    "p99 < %.1f ms, max %.1f ms",
+                    stats->diffs, stats->engines[DIFF_ENGINE_MYERS], stats->engines[DIFF_ENGINE_PATIENCE],
+                    stats->budget_exhausted, versioning_stats_percentile(stats, 99.0) / 1e6,
+                    stats->max_ns / 1e6);
+        for (int r = 0; r < DIFF_REASON_COUNT; r++) {
+            if (stats->reasons[r] > 0) {
+                log_message(LOG_INFO, "  %s: %llu", diff_reason_name((DiffReason)r), stats->reasons[r]);
+            }
+        }
+    }
+    if (vm->cache.evictions > 0 || vm->cache.lazy_files > 0) {
+        log_message(LOG_INFO, "Baseline cache: %d deferred at startup, %llu evictions, "
+                    "%llu reloads (%llu failed), peak %.1f MB resident",
+                    vm->cache.lazy_files, vm->cache.evictions, vm->cache.reloads,
+                    vm->cache.reload_failures, vm->cache.peak_bytes / (1024.0 * 1024.0));
+    }
+
     for (int i = 0; i < vm->file_count; i++) {
         if (vm->files[i]) {
-            safe_free(vm->files[i]->last_content);
+            line_index_free(&vm->files[i]->lines);
+            document_free(&vm->files[i]->content);
+            block_signature_free(&vm->files[i]->signature);
             safe_free(vm->files[i]);
         }
     }
     safe_free(vm->files);
+    safe_free(vm->buckets);
+    pthread_rwlock_destroy(&vm->lock);
+    pthread_mutex_destroy(&vm->stats_mutex);
+    pthread_mutex_destroy(&vm->cache_mutex);
+    pthread_cond_destroy(&vm->cache_cond);
     safe_free(vm);
 
     log_message(LOG_DEBUG, "Destroyed versioning manager");
 }
 
-static FileState* find_file_state(VersioningManager* vm, const char* filepath) {
-    for (int i = 0; i < vm->file_count; i++) {
-        if (strcmp(vm->files[i]->filepath, filepath) == 0) {
-            return vm->files[i];
+// Caminhos do watcher ("./a.c") e das operações ("a.c") designam o mesmo arquivo
+static const char* skip_current_dir(const char* filepath) {
+    return strncmp(filepath, "./", 2) == 0 ? filepath + 2 : filepath;
+}
+
+static uint64_t path_hash(const char* filepath) {
+    filepath = skip_current_dir(filepath);
+    return hash_bytes64(filepath, strlen(filepath), PATH_HASH_SEED);
+}
+
+// Sondagem linear: bucket que guarda o arquivo ou -1
+static int find_bucket(const VersioningManager* vm, const char* filepath, uint64_t hash) {
+    filepath = skip_current_dir(filepath);
+    int mask = vm->bucket_count - 1;
+    for (int b = (int)(hash & (uint64_t)mask); ; b = (b + 1) & mask) {
+        int slot = vm->buckets[b];
+        if (slot == VERSIONING_BUCKET_EMPTY) return -1;
+        if (slot == VERSIONING_BUCKET_REMOVED) continue;
+
+        const FileState* fs = vm->files[slot];
+        if (fs->path_hash == hash && strcmp(skip_current_dir(fs->filepath), filepath) == 0) {
+            return b;
         }
     }
-    return NULL;
+}
+
+static void place_in_bucket(VersioningManager* vm, const FileState* fs) {
+    int mask = vm->bucket_count - 1;
+    int b = (int)(fs->path_hash & (uint64_t)mask);
+    while (vm->buckets[b] >= 0) b = (b + 1) & mask;
+    if (vm->buckets[b] == VERSIONING_BUCKET_EMPTY) vm->bucket_used++;
+    vm->buckets[b] = fs->slot;
+}
+
+// Mantém a ocupação (contando removidos) abaixo de 3/4
+static void rehash_if_needed(VersioningManager* vm) {
+    if ((vm->bucket_used + 1) * 4 <= vm->bucket_count * 3) return;
+
+    int count = vm->bucket_count;
+    while ((vm->file_count + 1) * 2 > count) count *= 2;
+
+    safe_free(vm->buckets);
+    vm->buckets = (int*)safe_malloc((size_t)count * sizeof(int));
+    vm->bucket_count = count;
+    vm->bucket_used = 0;
+    for (int i = 0; i < count; i++) vm->buckets[i] = VERSIONING_BUCKET_EMPTY;
+    for (int i = 0; i < vm->file_count; i++) place_in_bucket(vm, vm->files[i]);
+}
+
+static FileState* find_file_state(VersioningManager* vm, const char* filepath) {
+    pthread_rwlock_rdlock(&vm->lock);
+    int b = find_bucket(vm, filepath, path_hash(filepath));
+    FileState* fs = b >= 0 ? vm->files[vm->buckets[b]] : NULL;
+    pthread_rwlock_unlock(&vm->lock);
+    return fs;
 }
 
 static void expand_capacity_if_needed(VersioningManager* vm) {
@@ -67,11 +157,289 @@ static void expand_capacity_if_needed(VersioningManager* vm) {
     }
 }
 
-int versioning_add_file(VersioningManager* vm, const char* filepath) {
+// Cache de baselines: lista LRU dos residentes e despejo para o snapshot store
+
+static size_t baseline_bytes(const FileState* fs) {
+    if (fs->blocks) return block_signature_memory(&fs->signature);
+    return document_size(&fs->content) +
+           (size_t)fs->lines.capacity * (sizeof(LineView) + sizeof(size_t));
+}
+
+static void lru_unlink(VersioningManager* vm, FileState* fs) {
+    if (fs->lru_prev) fs->lru_prev->lru_next = fs->lru_next;
+    else if (vm->lru_head == fs) vm->lru_head = fs->lru_next;
+    if (fs->lru_next) fs->lru_next->lru_prev = fs->lru_prev;
+    else if (vm->lru_tail == fs) vm->lru_tail = fs->lru_prev;
+    fs->lru_prev = fs->lru_next = NULL;
+}
+
+static void lru_push_front(VersioningManager* vm, FileState* fs) {
+    fs->lru_prev = NULL;
+    fs->lru_next = vm->lru_head;
+    if (vm->lru_head) vm->lru_head->lru_prev = fs;
+    vm->lru_head = fs;
+    if (!vm->lru_tail) vm->lru_tail = fs;
+}
+
+// Contabiliza o tamanho atual de um baseline residente (com cache_mutex)
+static void account_resident(VersioningManager* vm, FileState* fs) {
+    vm->cache.resident_bytes -= fs->resident_bytes;
+    fs->resident_bytes = baseline_bytes(fs);
+    vm->cache.resident_bytes += fs->resident_bytes;
+    if (vm->cache.resident_bytes > vm->cache.peak_bytes) {
+        vm->cache.peak_bytes = vm->cache.resident_bytes;
+    }
+}
+
+// Novo baseline (assume `content`): documento e índice de linhas para texto, só a
+// assinatura de blocos para binários e arquivos grandes
+static void set_baseline(FileState* fs, char* content, size_t size) {
+    line_index_free(&fs->lines);
+    document_free(&fs->content);
+    block_signature_free(&fs->signature);
+
+    fs->blocks = versioning_is_block_content(content, size);
+    if (fs->blocks) {
+        block_signature_build(&fs->signature, content, size);
+        safe_free(content);
+        return;
+    }
+    document_init(&fs->content, content, size);
+    line_index_build(&fs->lines, content, size, 1);
+}
+
+// Grava o baseline como objeto (conteúdo repetido não ocupa espaço): o texto ou a
+// assinatura de blocos serializada
+static int put_baseline(VersioningManager* vm, FileState* fs, unsigned char* digest, size_t* size) {
+    if (!fs->blocks) {
+        const char* content = document_text(&fs->content, size);
+        return snapshot_store_put_object(vm->baseline_store, content, *size, digest);
+    }
+
+    size_t len;
+    void* encoded = block_signature_encode(&fs->signature, &len);
+    int status = snapshot_store_put_object(vm->baseline_store, encoded, len, digest);
+    safe_free(encoded);
+    *size = (size_t)fs->signature.size;
+    return status;
+}
+
+// Registra no índice o baseline já gravado como objeto
+static void index_baseline(VersioningManager* vm, const FileState* fs, const unsigned char* digest, int empty) {
+    if (!vm->worktree) return;
+    uint32_t flags = fs->blocks ? WORKTREE_ENTRY_BLOCKS : (empty ? WORKTREE_ENTRY_EMPTY : 0);
+    worktree_index_update(vm->worktree, fs->filepath, &fs->stat, digest, flags);
+}
+
+// Grava o baseline e libera a memória
+static int evict_baseline(VersioningManager* vm, FileState* fs) {
+    size_t size;
+    if (put_baseline(vm, fs, fs->baseline_digest, &size) != 0) {
+        log_message(LOG_ERROR, "Failed to evict baseline of %s", fs->filepath);
+        return -1;
+    }
+
+    fs->baseline_empty = fs->content.empty;
+    fs->baseline_size = size;
+    index_baseline(vm, fs, fs->baseline_digest, fs->baseline_empty);
+    line_index_free(&fs->lines);
+    document_free(&fs->content);
+    block_signature_free(&fs->signature);
+    log_message(LOG_DEBUG, "Evicted baseline of %s (%zu bytes)", fs->filepath, size);
+    return 0;
+}
+
+// Despeja os baselines não fixados mais antigos até caber no orçamento
+static void enforce_memory_budget(VersioningManager* vm) {
+    if (!vm->baseline_store || vm->memory_budget == 0) return;
+
+    pthread_mutex_lock(&vm->cache_mutex);
+    while (vm->cache.resident_bytes > vm->memory_budget) {
+        FileState* victim = vm->lru_tail;
+        while (victim && (victim->pins > 0 || victim->busy)) victim = victim->lru_prev;
+        if (!victim) break;   // Todos em uso
+
+        // A gravação acontece fora do lock; `busy` impede o uso do baseline enquanto isso
+        lru_unlink(vm, victim);
+        victim->busy = 1;
+        vm->cache.resident_bytes -= victim->resident_bytes;
+        pthread_mutex_unlock(&vm->cache_mutex);
+
+        int status = evict_baseline(vm, victim);
+
+        pthread_mutex_lock(&vm->cache_mutex);
+        victim->busy = 0;
+        if (status == 0) {
+            victim->resident = 0;
+            victim->resident_bytes = 0;
+            vm->cache.resident_files--;
+            vm->cache.evictions++;
+        } else {
+            vm->cache.resident_bytes += victim->resident_bytes;
+            lru_push_front(vm, victim);
+        }
+        pthread_cond_broadcast(&vm->cache_cond);
+        if (status != 0) break;
+    }
+    pthread_mutex_unlock(&vm->cache_mutex);
+}
+
+// Recarrega o baseline do snapshot store. Sem o objeto, o conteúdo do disco vira o
+// baseline (as mudanças desde o despejo não geram operações).
+static int reload_baseline(VersioningManager* vm, FileState* fs) {
+    size_t size;
+    char* content = snapshot_store_get_object(vm->baseline_store, fs->baseline_digest, &size);
+    int empty = fs->baseline_empty;
+
+    if (content && fs->blocks) {
+        int status = block_signature_decode(&fs->signature, content, size);
+        safe_free(content);
+        if (status == 0) return 0;
+        content = NULL;
+    }
+
+    if (!content) {
+        char hex[HASH_SHA256_HEX_SIZE];
+        hash_to_hex(fs->baseline_digest, HASH_SHA256_SIZE, hex);
+        log_message(LOG_WARNING, "Baseline %.12s of %s is missing, rebuilding from disk", hex, fs->filepath);
+
+        content = file_read_all(fs->filepath, &size);
+        if (!content) {
+            log_message(LOG_ERROR, "Failed to read file %s", fs->filepath);
+            return -1;
+        }
+        worktree_stat(fs->filepath, &fs->stat);
+
+        pthread_mutex_lock(&vm->cache_mutex);
+        vm->cache.reload_failures++;
+        pthread_mutex_unlock(&vm->cache_mutex);
+
+        set_baseline(fs, content, size);
+        return 0;
+    }
+
+    document_init(&fs->content, content, size);
+    fs->content.empty = empty;
+    line_index_build(&fs->lines, content, size, 1);
+    return 0;
+}
+
+// Fixa o baseline em memória (recarregando se foi despejado) durante um diff ou aplicação
+static int pin_baseline(VersioningManager* vm, FileState* fs) {
+    pthread_mutex_lock(&vm->cache_mutex);
+    while (fs->busy) pthread_cond_wait(&vm->cache_cond, &vm->cache_mutex);
+    fs->pins++;
+    if (fs->resident) {
+        lru_unlink(vm, fs);
+        lru_push_front(vm, fs);
+        pthread_mutex_unlock(&vm->cache_mutex);
+        return 0;
+    }
+    fs->busy = 1;
+    pthread_mutex_unlock(&vm->cache_mutex);
+
+    int status = reload_baseline(vm, fs);
+
+    pthread_mutex_lock(&vm->cache_mutex);
+    fs->busy = 0;
+    if (status == 0) {
+        fs->resident = 1;
+        fs->resident_bytes = 0;
+        account_resident(vm, fs);
+        lru_push_front(vm, fs);
+        vm->cache.resident_files++;
+        vm->cache.reloads++;
+    } else {
+        fs->pins--;
+    }
+    pthread_cond_broadcast(&vm->cache_cond);
+    pthread_mutex_unlock(&vm->cache_mutex);
+    return status;
+}
+
+static void unpin_baseline(VersioningManager* vm, FileState* fs) {
+    pthread_mutex_lock(&vm->cache_mutex);
+    account_resident(vm, fs);
+    fs->pins--;
+    pthread_mutex_unlock(&vm->cache_mutex);
+
+    enforce_memory_budget(vm);
+}
+
+void versioning_set_memory_budget(VersioningManager* vm, SnapshotStore* store, size_t budget_bytes) {
+    if (!vm) return;
+    vm->baseline_store = store;
+    vm->memory_budget = budget_bytes;
+    enforce_memory_budget(vm);
+}
+
+void versioning_get_cache_stats(VersioningManager* vm, VersioningCacheStats* stats) {
+    if (!vm || !stats) return;
+    pthread_mutex_lock(&vm->cache_mutex);
+    *stats = vm->cache;
+    pthread_mutex_unlock(&vm->cache_mutex);
+}
+
+// Índice da árvore de trabalho
+
+void versioning_set_worktree_index(VersioningManager* vm, WorktreeIndex* index) {
+    if (!vm) return;
+    vm->worktree = index;
+}
+
+// Despejados já estão no índice; os residentes são gravados como objeto (conteúdo
+// repetido não ocupa espaço) e registrados
+int versioning_flush_worktree_index(VersioningManager* vm) {
+    if (!vm || !vm->worktree || !vm->baseline_store) return -1;
+
+    int written = 0;
+    int failed = 0;
+    pthread_rwlock_rdlock(&vm->lock);
+    for (int i = 0; i < vm->file_count; i++) {
+        FileState* fs = vm->files[i];
+        if (!fs->resident) continue;
+
+        size_t size;
+        unsigned char digest[HASH_SHA256_SIZE];
+        if (put_baseline(vm, fs, digest, &size) != 0) {
+            failed++;
+            continue;
+        }
+        index_baseline(vm, fs, digest, fs->content.empty);
+        written++;
+    }
+    pthread_rwlock_unlock(&vm->lock);
+
+    log_message(LOG_INFO, "Saved baselines of %d files to the worktree index", written);
+    return failed > 0 ? -1 : 0;
+}
+
+// Insere o estado na tabela; 0 se já havia (adicionado por outra thread)
+static int insert_file_state(VersioningManager* vm, FileState* fs) {
+    fs->path_hash = path_hash(fs->filepath);
+
+    pthread_rwlock_wrlock(&vm->lock);
+    if (find_bucket(vm, fs->filepath, fs->path_hash) >= 0) {
+        pthread_rwlock_unlock(&vm->lock);
+        return 0;
+    }
+    expand_capacity_if_needed(vm);
+    rehash_if_needed(vm);
+    fs->slot = vm->file_count;
+    vm->files[vm->file_count++] = fs;
+    place_in_bucket(vm, fs);
+    pthread_rwlock_unlock(&vm->lock);
+    return 1;
+}
+
+// Com `content_out`, o arquivo é sempre lido e o chamador recebe uma cópia do conteúdo
+// que virou o baseline
+static int add_file(VersioningManager* vm, const char* filepath, char** content_out, size_t* size_out) {
     if (!vm || !filepath) return -1;
 
     // Verificar se o arquivo existe
-    if (!file_exists(filepath)) {
+    WorktreeStat st;
+    if (worktree_stat(filepath, &st) != 0) {
         log_message(LOG_WARNING, "File %s does not exist", filepath);
         return -1;
     }
@@ -79,76 +447,213 @@ int versioning_add_file(VersioningManager* vm, const char* filepath) {
     // Verificar se o arquivo já está sendo monitorado
     if (find_file_state(vm, filepath)) {
         log_message(LOG_DEBUG, "File %s is already being tracked", filepath);
-        return 0;
+        return 1;
     }
 
-    // Expandir array se necessário
-    expand_capacity_if_needed(vm);
-
-    // Criar novo estado de arquivo
+    // Criar novo estado de arquivo (leitura e indexação fora do lock)
     FileState* fs = (FileState*)safe_malloc(sizeof(FileState));
+    memset(fs, 0, sizeof(FileState));
     strncpy(fs->filepath, filepath, MAX_FILEPATH_LEN - 1);
     fs->filepath[MAX_FILEPATH_LEN - 1] = '\0';
 
+    fs->stat = st;
+
+    // Stat igual ao do índice: baseline fica no snapshot store até ser usado
+    WorktreeEntry entry;
+    if (!content_out && vm->worktree && vm->baseline_store && worktree_index_lookup(vm->worktree, filepath, &entry) == 1 &&
+        worktree_stat_equal(&entry.stat, &st)) {
+        memcpy(fs->baseline_digest, entry.digest, HASH_SHA256_SIZE);
+        fs->baseline_size = (size_t)entry.stat.size;
+        fs->baseline_empty = (entry.flags & WORKTREE_ENTRY_EMPTY) != 0;
+        fs->blocks = (entry.flags & WORKTREE_ENTRY_BLOCKS) != 0;
+
+        if (!insert_file_state(vm, fs)) {
+            safe_free(fs);
+            return 1;
+        }
+        pthread_mutex_lock(&vm->cache_mutex);
+        vm->cache.lazy_files++;
+        pthread_mutex_unlock(&vm->cache_mutex);
+
+        log_message(LOG_DEBUG, "Added file %s to version tracking (baseline not loaded)", filepath);
+        return 0;
+    }
+
     // Ler conteúdo inicial
-    fs->last_content = file_read_all(filepath, &fs->last_content_size);
-    if (!fs->last_content) {
+    size_t size;
+    char* content = file_read_all(filepath, &size);
+    if (!content) {
         log_message(LOG_ERROR, "Failed to read file %s", filepath);
         safe_free(fs);
         return -1;
     }
 
-    fs->last_modified = file_get_mtime(filepath);
-    vm->files[vm->file_count++] = fs;
+    // Cópia antes de set_baseline, que libera o conteúdo de baselines por blocos
+    char* copy = NULL;
+    if (content_out) {
+        copy = (char*)safe_malloc(size + 1);
+        memcpy(copy, content, size + 1);
+    }
+
+    set_baseline(fs, content, size);
 
-    log_message(LOG_INFO, "Added file %s to version tracking (%zu bytes)",
-                filepath, fs->last_content_size);
+    if (!insert_file_state(vm, fs)) {
+        // Adicionado por outra thread enquanto o conteúdo era lido
+        line_index_free(&fs->lines);
+        document_free(&fs->content);
+        block_signature_free(&fs->signature);
+        safe_free(fs);
+        safe_free(copy);
+        return 1;
+    }
+
+    if (content_out) {
+        *content_out = copy;
+        *size_out = size;
+    }
+
+    pthread_mutex_lock(&vm->cache_mutex);
+    fs->resident = 1;
+    account_resident(vm, fs);
+    lru_push_front(vm, fs);
+    vm->cache.resident_files++;
+    pthread_mutex_unlock(&vm->cache_mutex);
+
+    log_message(LOG_INFO, "Added file %s to version tracking (%zu bytes%s)", filepath, size,
+                fs->blocks ? ", block deltas" : "");
+    enforce_memory_budget(vm);
     return 0;
 }
 
+int versioning_add_file(VersioningManager* vm, const char* filepath) {
+    return add_file(vm, filepath, NULL, NULL);
+}
+
+int versioning_add_file_content(VersioningManager* vm, const char* filepath, char** content, size_t* size) {
+    if (!content || !size) return -1;
+    *content = NULL;
+    *size = 0;
+    return add_file(vm, filepath, content, size);
+}
+
 int versioning_remove_file(VersioningManager* vm, const char* filepath) {
     if (!vm || !filepath) return -1;
 
-    for (int i = 0; i < vm->file_count; i++) {
-        if (strcmp(vm->files[i]->filepath, filepath) == 0) {
-            safe_free(vm->files[i]->last_content);
-            safe_free(vm->files[i]);
+    pthread_rwlock_wrlock(&vm->lock);
+    int b = find_bucket(vm, filepath, path_hash(filepath));
+    if (b < 0) {
+        pthread_rwlock_unlock(&vm->lock);
+        log_message(LOG_WARNING, "File %s not found in tracking list", filepath);
+        return -1;
+    }
 
-            // Mover elementos restantes
-            for (int j = i; j < vm->file_count - 1; j++) {
-                vm->files[j] = vm->files[j + 1];
-            }
-            vm->file_count--;
+    FileState* fs = vm->files[vm->buckets[b]];
+    vm->buckets[b] = VERSIONING_BUCKET_REMOVED;
 
-            log_message(LOG_INFO, "Removed file %s from version tracking", filepath);
-            return 0;
-        }
+    // O último arquivo ocupa a posição liberada
+    FileState* last = vm->files[--vm->file_count];
+    if (last != fs) {
+        int last_bucket = find_bucket(vm, last->filepath, last->path_hash);
+        last->slot = fs->slot;
+        vm->files[fs->slot] = last;
+        vm->buckets[last_bucket] = last->slot;
+    }
+    pthread_rwlock_unlock(&vm->lock);
+
+    // Um despejo em andamento ainda usa o estado
+    pthread_mutex_lock(&vm->cache_mutex);
+    while (fs->busy) pthread_cond_wait(&vm->cache_cond, &vm->cache_mutex);
+    if (fs->resident) {
+        lru_unlink(vm, fs);
+        vm->cache.resident_bytes -= fs->resident_bytes;
+        vm->cache.resident_files--;
     }
+    pthread_mutex_unlock(&vm->cache_mutex);
 
-    log_message(LOG_WARNING, "File %s not found in tracking list", filepath);
-    return -1;
+    if (vm->worktree) {
+        worktree_index_remove(vm->worktree, fs->filepath);
+    }
+    line_index_free(&fs->lines);
+    document_free(&fs->content);
+    block_signature_free(&fs->signature);
+    safe_free(fs);
+
+    log_message(LOG_INFO, "Removed file %s from version tracking", filepath);
+    return 0;
 }
 
-// Função para calcular hash de uma linha
-static unsigned long hash_line(const char* line, size_t length) {
-    unsigned long hash = 5381;
-    for (size_t i = 0; i < length; i++) {
-        hash = ((hash << 5) + hash) + line[i];
-    }
-    return hash;
+void versioning_set_intraline(VersioningManager* vm, const char* extensions) {
+    if (!vm) return;
+    strncpy(vm->intraline, extensions ? extensions : "none", sizeof(vm->intraline) - 1);
+    vm->intraline[sizeof(vm->intraline) - 1] = '\0';
 }
 
-// Função para criar array de LineInfo
-static LineInfo* create_line_info_array(char** lines, int line_count) {
-    LineInfo* info = (LineInfo*)safe_malloc(line_count * sizeof(LineInfo));
+void versioning_set_diff_budget(VersioningManager* vm, int budget_ms) {
+    if (!vm) return;
+    vm->diff_budget_ns = budget_ms > 0 ? (long long)budget_ms * 1000000LL : 0;
+}
 
-    for (int i = 0; i < line_count; i++) {
-        info[i].content = lines[i];
-        info[i].length = strlen(lines[i]);
-        info[i].hash = hash_line(lines[i], info[i].length);
+void versioning_get_stats(VersioningManager* vm, VersioningDiffStats* stats) {
+    if (!vm || !stats) return;
+    pthread_mutex_lock(&vm->stats_mutex);
+    *stats = vm->stats;
+    pthread_mutex_unlock(&vm->stats_mutex);
+}
+
+// Limite superior (ns) da faixa de latência que contém o percentil
+long long versioning_stats_percentile(const VersioningDiffStats* stats, double percentile) {
+    if (!stats || stats->diffs == 0) return 0;
+
+    unsigned long long target = (unsigned long long)(stats->diffs * percentile / 100.0 + 0.5);
+    if (target == 0) target = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < VERSIONING_LATENCY_BUCKETS; i++) {
+        seen += stats->latency[i];
+        if (seen >= target) return (1LL << i) * 1000LL;
     }
+    return stats->max_ns;
+}
 
-    return info;
+static void record_diff(VersioningManager* vm, const char* filepath, const DiffPlan* plan) {
+    int bucket = 0;
+    while (bucket < VERSIONING_LATENCY_BUCKETS - 1 && (1LL << bucket) * 1000LL <= plan->elapsed_ns) bucket++;
+
+    pthread_mutex_lock(&vm->stats_mutex);
+    vm->stats.diffs++;
+    vm->stats.engines[plan->engine]++;
+    vm->stats.reasons[plan->reason]++;
+    if (plan->budget_exhausted) vm->stats.budget_exhausted++;
+    vm->stats.latency[bucket]++;
+    if (plan->elapsed_ns > vm->stats.max_ns) vm->stats.max_ns = plan->elapsed_ns;
+    pthread_mutex_unlock(&vm->stats_mutex);
+
+    log_message(plan->budget_exhausted ? LOG_INFO : LOG_DEBUG,
+                "Diff of %s: %s (%s), %d lines, ~%ld edits, %.0f%% unique, %.2f ms%s",
+                filepath, diff_engine_name(plan->engine), diff_reason_name(plan->reason),
+                plan->window_lines, plan->estimated_edits, plan->unique_ratio * 100.0,
+                plan->elapsed_ns / 1e6, plan->budget_exhausted ? " (budget exhausted)" : "");
+}
+
+// Diff dentro da linha habilitado para a extensão do arquivo?
+static int intraline_enabled(const VersioningManager* vm, const char* filepath) {
+    if (strcmp(vm->intraline, "*") == 0) return 1;
+    if (strcmp(vm->intraline, "none") == 0) return 0;
+
+    const char* name = strrchr(filepath, '/');
+    const char* ext = strrchr(name ? name : filepath, '.');
+    if (!ext) return 0;
+    size_t ext_len = strlen(ext + 1);
+
+    const char* p = vm->intraline;
+    while (*p) {
+        if (*p == '.') p++;
+        size_t len = strcspn(p, ",");
+        if (len == ext_len && strncmp(p, ext + 1, len) == 0) return 1;
+        p += len;
+        if (*p == ',') p++;
+    }
+    return 0;
 }
 
 // Função para adicionar operação ao resultado
@@ -162,146 +667,312 @@ static void add_operation_to_result(DiffResult* result, Operation* op) {
     result->operations[result->count++] = op;
 }
 
-// Algoritmo LCS (Longest Common Subsequence) para diff mais preciso
-static int** compute_lcs_table(LineInfo* old_info, int old_count,
-                              LineInfo* new_info, int new_count) {
-    int** lcs = (int**)safe_malloc((old_count + 1) * sizeof(int*));
-    for (int i = 0; i <= old_count; i++) {
-        lcs[i] = (int*)safe_malloc((new_count + 1) * sizeof(int));
-        memset(lcs[i], 0, (new_count + 1) * sizeof(int));
+// Diff dentro da linha: o prefixo e o sufixo comuns (em bytes, sem partir sequências
+// UTF-8) delimitam o trecho alterado. Retorna 0 se as linhas têm pouco em comum
+// (melhor substituir a linha inteira).
+static int intraline_common(const LineView* old_line, const LineView* new_line,
+                            size_t* prefix_out, size_t* suffix_out) {
+    const char* a = old_line->content;
+    const char* b = new_line->content;
+    size_t a_len = old_line->length, b_len = new_line->length;
+    size_t shortest = a_len < b_len ? a_len : b_len;
+    size_t longest = a_len > b_len ? a_len : b_len;
+
+    size_t prefix = diff_common_prefix(a, b, shortest);
+    while (prefix > 0 && ((prefix < a_len && ((unsigned char)a[prefix] & 0xC0) == 0x80) ||
+                          (prefix < b_len && ((unsigned char)b[prefix] & 0xC0) == 0x80))) {
+        prefix--;
+    }
+    size_t suffix = diff_common_suffix(a + a_len, b + b_len, shortest - prefix);
+    while (suffix > 0 && ((unsigned char)a[a_len - suffix] & 0xC0) == 0x80) {
+        suffix--;
     }
 
-    for (int i = 1; i <= old_count; i++) {
-        for (int j = 1; j <= new_count; j++) {
-            if (old_info[i-1].hash == new_info[j-1].hash &&
-                old_info[i-1].length == new_info[j-1].length &&
-                strcmp(old_info[i-1].content, new_info[j-1].content) == 0) {
-                lcs[i][j] = lcs[i-1][j-1] + 1;
-            } else {
-                lcs[i][j] = (lcs[i-1][j] > lcs[i][j-1]) ? lcs[i-1][j] : lcs[i][j-1];
-            }
-        }
+    *prefix_out = prefix;
+    *suffix_out = suffix;
+    return (prefix + suffix) * 100 >= (size_t)VERSIONING_INTRALINE_MIN_COMMON * longest;
+}
+
+// Trecho alterado emitido como del_text/ins_text na coluna certa
+static void add_intraline_operations(DiffResult* result, int line,
+                                     const LineView* old_line, const LineView* new_line,
+                                     size_t prefix, size_t suffix, const char* author) {
+    size_t removed = old_line->length - prefix - suffix;
+    size_t inserted = new_line->length - prefix - suffix;
+    if (removed > 0) {
+        add_operation_to_result(result, operation_create_n("del_text", line, (int)prefix,
+                                                           old_line->content + prefix, removed, author));
     }
+    if (inserted > 0) {
+        add_operation_to_result(result, operation_create_n("ins_text", line, (int)prefix,
+                                                           new_line->content + prefix, inserted, author));
+    }
+}
 
-    return lcs;
-}
-
-// Gerar operações usando tabela LCS
-static void generate_operations_from_lcs(int** lcs, LineInfo* old_info, int old_count,
-                                       LineInfo* new_info, int new_count,
-                                       DiffResult* result, const char* author) {
-    int i = old_count, j = new_count;
-
-    // Reconstruir o diff a partir da tabela LCS
-    while (i > 0 || j > 0) {
-        if (i > 0 && j > 0 &&
-            old_info[i-1].hash == new_info[j-1].hash &&
-            old_info[i-1].length == new_info[j-1].length &&
-            strcmp(old_info[i-1].content, new_info[j-1].content) == 0) {
-            // Linhas iguais - mover para trás
-            i--;
-            j--;
-        } else if (j > 0 && (i == 0 || lcs[i][j-1] >= lcs[i-1][j])) {
-            // Inserção
-            Operation* op = operation_create("insert", j-1, 0, new_info[j-1].content, author);
-            add_operation_to_result(result, op);
-            j--;
-        } else if (i > 0 && (j == 0 || lcs[i][j-1] < lcs[i-1][j])) {
-            // Deleção
-            Operation* op = operation_create("delete", i-1, 0, old_info[i-1].content, author);
-            add_operation_to_result(result, op);
-            i--;
+// Uma operação para `count` linhas consecutivas: as visões apontam para o mesmo
+// buffer, então o texto é o trecho contínuo da primeira à última linha
+static void add_range_operation(DiffResult* result, const char* type, int line,
+                                const LineView* lines, int count, const char* author) {
+    if (count <= 0) return;
+
+    const char* start = lines[0].content;
+    size_t len = (size_t)(lines[count - 1].content + lines[count - 1].length - start);
+
+    Operation* op = operation_create_n(type, line, 0, start, len, author);
+    op->line_count = count;
+    add_operation_to_result(result, op);
+}
+
+// Substitui old[first, first + old_count) do trecho por new[first, first + new_count):
+// delete e insert na mesma linha do conteúdo antigo
+static void add_replace_range(DiffResult* result, const DiffHunk* hunk, int first,
+                              int old_count, int new_count,
+                              const LineView* old_lines, const LineView* new_lines,
+                              int line_offset, const char* author) {
+    int line = line_offset + hunk->old_start + first;
+    add_range_operation(result, "delete", line, &old_lines[hunk->old_start + first], old_count, author);
+    add_range_operation(result, "insert", line, &new_lines[hunk->new_start + first], new_count, author);
+}
+
+// Gerar operações a partir do script de edição, do fim para o início e em linhas do
+// conteúdo antigo (deslocadas pelas `line_offset` linhas do prefixo comum): aplicadas
+// em ordem sobre o conteúdo antigo, produzem o novo. Cada trecho vira no máximo um
+// delete e um insert de várias linhas. Com `intraline`, linhas alteradas no lugar
+// (pares antigo/novo do mesmo trecho) viram edições dentro da linha.
+static void generate_operations_from_script(const DiffScript* script,
+                                            const LineView* old_lines, const LineView* new_lines,
+                                            int line_offset, int intraline,
+                                            DiffResult* result, const char* author) {
+    for (int h = script->count - 1; h >= 0; h--) {
+        const DiffHunk* hunk = &script->hunks[h];
+        int paired = intraline ? (hunk->old_count < hunk->new_count ? hunk->old_count : hunk->new_count) : 0;
+
+        add_replace_range(result, hunk, paired, hunk->old_count - paired, hunk->new_count - paired,
+                          old_lines, new_lines, line_offset, author);
+
+        // Pares sem prefixo/sufixo suficiente são agrupados em substituições de bloco
+        int run_end = paired;
+        for (int k = paired - 1; k >= 0; k--) {
+            const LineView* old_line = &old_lines[hunk->old_start + k];
+            const LineView* new_line = &new_lines[hunk->new_start + k];
+            size_t prefix, suffix;
+            if (!intraline_common(old_line, new_line, &prefix, &suffix)) continue;
+
+            add_replace_range(result, hunk, k + 1, run_end - k - 1, run_end - k - 1,
+                              old_lines, new_lines, line_offset, author);
+            run_end = k;
+            add_intraline_operations(result, line_offset + hunk->old_start + k, old_line, new_line,
+                                     prefix, suffix, author);
         }
+        add_replace_range(result, hunk, 0, run_end, run_end, old_lines, new_lines, line_offset, author);
     }
 }
 
-// Liberar tabela LCS
-static void free_lcs_table(int** lcs, int old_count) {
-    for (int i = 0; i <= old_count; i++) {
-        safe_free(lcs[i]);
-    }
-    safe_free(lcs);
-}
-
-// Algoritmo de diff simples para arquivos pequenos
-static void simple_diff_algorithm(char** old_lines, int old_count,
-                                char** new_lines, int new_count,
-                                DiffResult* result, const char* author) {
-    int i = 0, j = 0;
-
-    while (i < old_count || j < new_count) {
-        if (i >= old_count) {
-            // Linhas adicionadas no final
-            Operation* op = operation_create("insert", j, 0, new_lines[j], author);
-            add_operation_to_result(result, op);
-            j++;
-        } else if (j >= new_count) {
-            // Linhas removidas no final
-            Operation* op = operation_create("delete", i, 0, old_lines[i], author);
-            add_operation_to_result(result, op);
-            i++;
-        } else if (strcmp(old_lines[i], new_lines[j]) != 0) {
-            // Linha modificada
-            Operation* op = operation_create("replace", i, 0, new_lines[j], author);
-            add_operation_to_result(result, op);
-            i++;
-            j++;
-        } else {
-            // Linhas iguais
-            i++;
-            j++;
-        }
+// Indexa a janela alterada. Se um sufixo comum vem em seguida, a janela termina
+// em '\n' e a linha vazia final pertence ao sufixo, não à janela.
+static void index_window(LineIndex* index, const char* start, size_t len, int before_suffix) {
+    line_index_build(index, start, len, 1);
+    if (before_suffix && index->count > 0) {
+        index->count--;
     }
 }
 
-int versioning_diff_lines(const char* old_content, const char* new_content, Operation*** ops) {
-    if (!old_content || !new_content || !ops) return -1;
+// Primeira linha do índice que começa em `at` ou depois (visões em ordem de endereço)
+static int find_line_at(const LineIndex* index, const char* at) {
+    int lo = 0, hi = index->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (index->lines[mid].content < at) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Índice completo do conteúdo novo: linhas do prefixo e do sufixo vêm do índice
+// antigo (mesmo conteúdo, só reposicionadas) e apenas a janela foi hasheada
+static void assemble_index(LineIndex* out, const LineIndex* old_index, const char* old_content,
+                           size_t old_len, const LineIndex* window, int suffix_first,
+                           const DiffTrim* trim, const char* new_content, size_t new_len) {
+    int prefix_lines = trim->prefix_lines;
+    int suffix_lines = trim->suffix > 0 ? old_index->count - suffix_first : 0;
+    int total = prefix_lines + window->count + suffix_lines;
+
+    out->text = new_content;
+    out->size = new_len;
+    out->capacity = total ? total : 1;
+    out->count = total;
+    out->lines = (LineView*)safe_malloc((size_t)out->capacity * sizeof(LineView));
+
+    LineView* dst = out->lines;
+    for (int i = 0; i < prefix_lines; i++, dst++) {
+        *dst = old_index->lines[i];
+        dst->content = new_content + (dst->content - old_content);
+    }
+
+    memcpy(dst, window->lines, (size_t)window->count * sizeof(LineView));
+    dst += window->count;
+
+    const char* old_suffix = old_content + old_len - trim->suffix;
+    const char* new_suffix = new_content + new_len - trim->suffix;
+    for (int i = 0; i < suffix_lines; i++, dst++) {
+        *dst = old_index->lines[suffix_first + i];
+        dst->content = new_suffix + (dst->content - old_suffix);
+    }
+}
 
+// Diff entre dois conteúdos. Com `old_index` (índice completo de old_content, com
+// hashes) as linhas antigas não são re-hasheadas e `new_index` recebe o índice
+// completo do conteúdo novo, pronto para servir de baseline na próxima mudança.
+static int diff_contents(const char* old_content, size_t old_len, const LineIndex* old_index,
+                         const char* new_content, size_t new_len, LineIndex* new_index,
+                         int intraline, long long budget_ns, DiffPlan* plan, Operation*** ops) {
     const char* author = getenv("USER");
     if (!author) author = "system";
 
-    int old_lines_count, new_lines_count;
-    char** old_lines = str_split_lines(old_content, &old_lines_count);
-    char** new_lines = str_split_lines(new_content, &new_lines_count);
+    if (new_index) memset(new_index, 0, sizeof(*new_index));
+    memset(plan, 0, sizeof(*plan));
 
-    if (!old_lines || !new_lines) {
-        str_free_lines(old_lines, old_lines_count);
-        str_free_lines(new_lines, new_lines_count);
-        return -1;
-    }
+    // Pré-passo nos buffers: só a janela entre o prefixo e o sufixo comuns
+    // (em linhas inteiras) chega ao índice de linhas e ao diff
+    DiffTrim trim;
+    diff_trim_common(old_content, old_len, new_content, new_len, &trim);
 
-    DiffResult result = {0};
+    if (trim.prefix == old_len && trim.prefix == new_len) {
+        *ops = NULL;
+        return 0;
+    }
 
-    // Escolher algoritmo baseado no tamanho
-    if (old_lines_count > LCS_THRESHOLD || new_lines_count > LCS_THRESHOLD) {
-        // Usar algoritmo simples para arquivos grandes
-        simple_diff_algorithm(old_lines, old_lines_count,
-                             new_lines, new_lines_count, &result, author);
+    // Linhas como visões sobre os buffers originais, sem cópias
+    LineIndex old_window, new_window;
+    const LineView* old_lines;
+    int old_count, suffix_first = 0;
+    if (old_index) {
+        suffix_first = trim.suffix > 0
+            ? find_line_at(old_index, old_content + old_len - trim.suffix) : old_index->count;
+        old_lines = old_index->lines + trim.prefix_lines;
+        old_count = suffix_first - trim.prefix_lines;
     } else {
-        // Usar LCS para arquivos menores
-        LineInfo* old_info = create_line_info_array(old_lines, old_lines_count);
-        LineInfo* new_info = create_line_info_array(new_lines, new_lines_count);
+        index_window(&old_window, old_content + trim.prefix, old_len - trim.prefix - trim.suffix,
+                     trim.suffix > 0);
+        old_lines = old_window.lines;
+        old_count = old_window.count;
+    }
+    index_window(&new_window, new_content + trim.prefix, new_len - trim.prefix - trim.suffix,
+                 trim.suffix > 0);
 
-        int** lcs = compute_lcs_table(old_info, old_lines_count,
-                                     new_info, new_lines_count);
+    DiffResult result = {0};
+
+    // Algoritmo escolhido pelas medidas da janela, com tempo limitado
+    DiffScript script = {0};
+    int status = diff_auto(old_lines, old_count, new_window.lines, new_window.count,
+                           budget_ns, &script, plan);
 
-        generate_operations_from_lcs(lcs, old_info, old_lines_count,
-                                   new_info, new_lines_count, &result, author);
+    if (status == 0) {
+        generate_operations_from_script(&script, old_lines, new_window.lines, trim.prefix_lines,
+                                        intraline, &result, author);
+    }
 
-        free_lcs_table(lcs, old_lines_count);
-        safe_free(old_info);
-        safe_free(new_info);
+    if (old_index && new_index) {
+        assemble_index(new_index, old_index, old_content, old_len, &new_window, suffix_first,
+                       &trim, new_content, new_len);
     }
 
-    str_free_lines(old_lines, old_lines_count);
-    str_free_lines(new_lines, new_lines_count);
+    diff_script_free(&script);
+    if (!old_index) line_index_free(&old_window);
+    line_index_free(&new_window);
 
     *ops = result.operations;
     return result.count;
 }
 
-Operation** versioning_detect_changes(VersioningManager* vm, const char* filepath, int* op_count) {
+int versioning_diff_lines(const char* old_content, const char* new_content, Operation*** ops) {
+    if (!old_content || !new_content || !ops) return -1;
+
+    DiffPlan plan;
+    return diff_contents(old_content, strlen(old_content), NULL,
+                         new_content, strlen(new_content), NULL, 0,
+                         (long long)VERSIONING_DIFF_BUDGET_MS * 1000000LL, &plan, ops);
+}
+
+int versioning_is_block_content(const char* content, size_t size) {
+    if (size >= VERSIONING_BLOCK_MIN_SIZE) return 1;
+    return memchr(content, '\0', size < VERSIONING_BINARY_SNIFF ? size : VERSIONING_BINARY_SNIFF) != NULL;
+}
+
+// Operação "blocks" que transforma o conteúdo da assinatura em `content`
+static Operation* block_operation(const BlockSignature* sig, const char* content, size_t size,
+                                  const char* author) {
+    size_t delta_len, copied, text_len;
+    unsigned char* delta = block_delta_encode(sig, content, size, &delta_len, &copied);
+    char* text = str_base64_encode(delta, delta_len, &text_len);
+    Operation* op = operation_create_n("blocks", 0, 0, text, text_len, author);
+    safe_free(text);
+    safe_free(delta);
+
+    log_message(LOG_DEBUG, "Block delta: %zu -> %zu bytes, %zu-byte delta (%.0f%% reused)",
+                (size_t)sig->size, size, delta_len, size > 0 ? copied * 100.0 / size : 100.0);
+    return op;
+}
+
+Operation* versioning_create_operation(const char* filepath, const char* content, size_t size,
+                                       const char* author) {
+    if (!filepath || !content || !author) return NULL;
+
+    Operation* op;
+    if (versioning_is_block_content(content, size)) {
+        BlockSignature empty;
+        block_signature_build(&empty, "", 0);
+        op = block_operation(&empty, content, size, author);
+        block_signature_free(&empty);
+    } else {
+        op = operation_create_n("create", 0, 0, content, size, author);
+    }
+    operation_set_file(op, filepath);
+    return op;
+}
+
+// Binário ou grande (antes ou agora): uma única operação "blocks". O baseline de
+// texto não tem assinatura; ela é calculada do documento nessa transição.
+static int diff_blocks(FileState* fs, const char* content, size_t size, Operation*** ops) {
+    const char* author = getenv("USER");
+    if (!author) author = "system";
+
+    BlockSignature text_signature;
+    const BlockSignature* sig = &fs->signature;
+    if (!fs->blocks) {
+        size_t old_size;
+        const char* old = document_text(&fs->content, &old_size);
+        block_signature_build(&text_signature, old, old_size);
+        sig = &text_signature;
+    }
+
+    int count = 0;
+    *ops = NULL;
+    if (sig->size != size || sig->content_hash != hash_bytes64(content, size, BLOCK_DELTA_SEED)) {
+        *ops = (Operation**)safe_malloc(sizeof(Operation*));
+        (*ops)[0] = block_operation(sig, content, size, author);
+        count = 1;
+    }
+
+    if (!fs->blocks) block_signature_free(&text_signature);
+    return count;
+}
+
+// Entrega ao chamador (se pedido) uma cópia do conteúdo que virou o baseline
+static void hand_out_content(const char* content, size_t size, char** content_out, size_t* size_out) {
+    if (!content_out) return;
+    *content_out = (char*)safe_malloc(size + 1);
+    memcpy(*content_out, content, size + 1);
+    *size_out = size;
+}
+
+Operation** versioning_detect_changes(VersioningManager* vm, const char* filepath, int* op_count,
+                                      char** content, size_t* size) {
     if (!vm || !filepath || !op_count) return NULL;
+    if (content) {
+        *content = NULL;
+        *size = 0;
+    }
 
     FileState* fs = find_file_state(vm, filepath);
     if (!fs) {
@@ -310,81 +981,227 @@ Operation** versioning_detect_changes(VersioningManager* vm, const char* filepat
     }
 
     // Verificar se o arquivo foi modificado
-    time_t current_mtime = file_get_mtime(filepath);
-    if (current_mtime == fs->last_modified) {
+    WorktreeStat current_stat;
+    if (worktree_stat(filepath, &current_stat) != 0) {
+        log_message(LOG_ERROR, "Failed to stat file %s", filepath);
+        return NULL;
+    }
+    if (worktree_stat_equal(&current_stat, &fs->stat)) {
         *op_count = 0;
         return NULL; // Sem mudanças
     }
 
+    if (pin_baseline(vm, fs) != 0) return NULL;
+
     // Ler conteúdo atual
     size_t current_size;
     char* current_content = file_read_all(filepath, &current_size);
     if (!current_content) {
         log_message(LOG_ERROR, "Failed to read file %s", filepath);
+        unpin_baseline(vm, fs);
         return NULL;
     }
 
-    // Detectar diferenças
+    if (fs->blocks || versioning_is_block_content(current_content, current_size)) {
+        Operation** ops = NULL;
+        int count = diff_blocks(fs, current_content, current_size, &ops);
+        if (count > 0) {
+            log_message(LOG_INFO, "Detected block changes in %s", filepath);
+            operation_set_file(ops[0], filepath);
+            hand_out_content(current_content, current_size, content, size);
+            set_baseline(fs, current_content, current_size);
+        } else {
+            safe_free(current_content);
+        }
+        fs->stat = current_stat;
+        unpin_baseline(vm, fs);
+
+        *op_count = count;
+        return ops;
+    }
+
+    // Detectar diferenças: o baseline já está indexado, só o conteúdo novo é hasheado.
+    // Entre chamadas o documento não tem edições pendentes, então o texto é o buffer
+    // original e as visões de fs->lines continuam válidas.
+    size_t baseline_size;
+    const char* baseline = document_text(&fs->content, &baseline_size);
     Operation** ops = NULL;
-    int count = versioning_diff_lines(fs->last_content, current_content, &ops);
+    LineIndex current_lines;
+    DiffPlan plan;
+    int count = diff_contents(baseline, baseline_size, &fs->lines,
+                              current_content, current_size, &current_lines,
+                              intraline_enabled(vm, filepath), vm->diff_budget_ns, &plan, &ops);
+    if (plan.window_lines > 0) {
+        record_diff(vm, filepath, &plan);
+    }
 
     if (count > 0) {
         log_message(LOG_INFO, "Detected %d changes in %s", count, filepath);
 
-        // Atualizar estado do arquivo
-        safe_free(fs->last_content);
-        fs->last_content = current_content;
-        fs->last_content_size = current_size;
-        fs->last_modified = current_mtime;
+        for (int i = 0; i < count; i++) {
+            operation_set_file(ops[i], filepath);
+        }
+
+        hand_out_content(current_content, current_size, content, size);
+
+        // Atualizar estado do arquivo: o índice novo vira o baseline
+        line_index_free(&fs->lines);
+        fs->lines = current_lines;
+        document_reset(&fs->content, current_content, current_size);
+        fs->stat = current_stat;
     } else {
+        // Conteúdo igual ao baseline (gravação idêntica, touch): o stat novo passa a
+        // identificá-lo, senão o baseline pareceria desatualizado para as operações remotas
+        line_index_free(&current_lines);
         safe_free(current_content);
+        fs->stat = current_stat;
     }
+    unpin_baseline(vm, fs);
 
     *op_count = count;
     return ops;
 }
 
+// Aplica as operações em ordem; cada uma custa O(log n) no documento
+static int apply_to_document(Document* doc, const Operation* const* ops, int op_count, const char* filepath) {
+    for (int i = 0; i < op_count; i++) {
+        if (document_apply(doc, ops[i]) != 0) {
+            log_message(LOG_ERROR, "Operation %d (%s at line %d) does not apply to %s",
+                        i, ops[i]->op_type, ops[i]->line, filepath);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// "create" e "blocks" trazem o conteúdo inteiro: aplicáveis a um arquivo que ainda não existe
+static int creates_file(const Operation* op) {
+    return strcmp(op->op_type, "create") == 0 || strcmp(op->op_type, "blocks") == 0;
+}
+
 int versioning_apply_patch(const char* filepath, Operation** ops, int op_count) {
     if (!filepath || !ops || op_count <= 0) return -1;
 
-    // Ler conteúdo atual
-    size_t size;
-    char* content = file_read_all(filepath, &size);
+    // Ler conteúdo atual (vazio se o arquivo vai ser criado)
+    size_t size = 0;
+    char* content = !file_exists(filepath) && creates_file(ops[0])
+        ? str_duplicate("") : file_read_all(filepath, &size);
     if (!content) {
         log_message(LOG_ERROR, "Failed to read file %s for patching", filepath);
         return -1;
     }
 
-    int line_count;
-    char** lines = str_split_lines(content, &line_count);
-    safe_free(content);
+    // Todas as operações no documento em memória e uma única gravação no fim
+    Document doc;
+    document_init(&doc, content, size);
+    int status = apply_to_document(&doc, (const Operation* const*)ops, op_count, filepath);
+    if (status == 0) {
+        status = document_write(&doc, filepath);
+    }
+    document_free(&doc);
+
+    if (status == 0) {
+        log_message(LOG_INFO, "Applied %d operations to %s", op_count, filepath);
+    }
+    return status;
+}
 
-    if (!lines) {
-        log_message(LOG_ERROR, "Failed to split file into lines");
+// Remoção do arquivo inteiro ("remove"): apaga do disco e deixa de monitorar
+static int remove_tracked_file(VersioningManager* vm, const char* filepath) {
+    if (unlink(filepath) != 0 && errno != ENOENT) {
+        log_message(LOG_ERROR, "Failed to remove %s: %s", filepath, strerror(errno));
         return -1;
     }
+    if (find_file_state(vm, filepath)) {
+        versioning_remove_file(vm, filepath);
+    }
+    log_message(LOG_INFO, "Removed %s", filepath);
+    return 0;
+}
 
-    // Aplicar cada operação
-    for (int i = 0; i < op_count; i++) {
-        Operation* op = ops[i];
-
-        if (strcmp(op->op_type, "insert") == 0) {
-            // TODO: Implementar inserção real
-            log_message(LOG_DEBUG, "Would insert at line %d: %s", op->line, op->text);
-        } else if (strcmp(op->op_type, "delete") == 0) {
-            // TODO: Implementar deleção real
-            log_message(LOG_DEBUG, "Would delete line %d", op->line);
-        } else if (strcmp(op->op_type, "replace") == 0) {
-            // TODO: Implementar substituição real
-            log_message(LOG_DEBUG, "Would replace line %d with: %s", op->line, op->text);
+// Operações de conteúdo de um arquivo, com uma única gravação
+static int apply_content_operations(VersioningManager* vm, const char* filepath,
+                                    const Operation* const* ops, int op_count) {
+    FileState* fs = find_file_state(vm, filepath);
+
+    // Sem baseline confiável (arquivo não monitorado ou com mudanças locais ainda
+    // não detectadas): aplicar sobre o conteúdo do disco. Um arquivo criado assim
+    // passa a ser monitorado, com o conteúdo aplicado como baseline.
+    WorktreeStat current_stat;
+    if (!fs || worktree_stat(fs->filepath, &current_stat) != 0 || !worktree_stat_equal(&current_stat, &fs->stat)) {
+        int created = !fs && !file_exists(filepath);
+        int status = versioning_apply_patch(fs ? fs->filepath : filepath, (Operation**)ops, op_count);
+        if (status == 0 && created) {
+            versioning_add_file(vm, filepath);
         }
+        return status;
     }
 
-    // TODO: Reconstruir arquivo e salvar
-    str_free_lines(lines, line_count);
+    if (pin_baseline(vm, fs) != 0) return -1;
 
-    log_message(LOG_INFO, "Applied %d operations to %s", op_count, filepath);
-    return 0;
+    // Baseline de blocos não tem o conteúdo: aplicar sobre o disco e refazer a assinatura
+    int status;
+    size_t size;
+    if (fs->blocks) {
+        status = versioning_apply_patch(fs->filepath, (Operation**)ops, op_count);
+        char* disk_content = file_read_all(fs->filepath, &size);
+        if (disk_content) set_baseline(fs, disk_content, size);
+        worktree_stat(fs->filepath, &fs->stat);
+        unpin_baseline(vm, fs);
+        return status;
+    }
+
+    status = apply_to_document(&fs->content, ops, op_count, fs->filepath);
+    if (status == 0) {
+        status = document_write(&fs->content, fs->filepath);
+    }
+
+    // Em caso de falha, voltar ao conteúdo do disco para o baseline não divergir do arquivo
+    char* disk_content = NULL;
+    if (status != 0 && (disk_content = file_read_all(fs->filepath, &size)) != NULL) {
+        document_reset(&fs->content, disk_content, size);
+    }
+
+    // O resultado vira o baseline, para o watcher não reenviar a mudança como local.
+    // A consolidação troca o buffer do documento: o índice de linhas é refeito (ou,
+    // se o conteúdo passou a ser binário ou grande, trocado pela assinatura).
+    const char* content = document_text(&fs->content, &size);
+    if (versioning_is_block_content(content, size)) {
+        char* copy = (char*)safe_malloc(size + 1);
+        memcpy(copy, content, size);
+        copy[size] = '\0';
+        set_baseline(fs, copy, size);
+    } else {
+        line_index_free(&fs->lines);
+        line_index_build(&fs->lines, content, size, 1);
+    }
+    worktree_stat(fs->filepath, &fs->stat);
+    unpin_baseline(vm, fs);
+
+    if (status == 0) {
+        log_message(LOG_INFO, "Applied %d operations to %s", op_count, fs->filepath);
+    }
+    return status;
+}
+
+int versioning_apply_operations(VersioningManager* vm, const char* filepath,
+                                const Operation* const* ops, int op_count) {
+    if (!vm || !filepath || !ops || op_count <= 0) return -1;
+
+    // "remove" divide o lote: o que vem antes é aplicado, o arquivo é apagado e o
+    // restante (um "create" posterior, por exemplo) parte do arquivo inexistente
+    int status = 0;
+    int start = 0;
+    for (int i = 0; i < op_count; i++) {
+        if (strcmp(ops[i]->op_type, "remove") != 0) continue;
+        if (i > start && apply_content_operations(vm, filepath, ops + start, i - start) != 0) status = -1;
+        if (remove_tracked_file(vm, filepath) != 0) status = -1;
+        start = i + 1;
+    }
+    if (start < op_count && apply_content_operations(vm, filepath, ops + start, op_count - start) != 0) {
+        status = -1;
+    }
+    return status;
 }
 
 char* versioning_get_file_content(const char* filepath, size_t* size) {
@@ -39,10 +39,22 @@ static int websocket_callback(struct lws* wsi, enum lws_callback_reasons reason,
 
         case LWS_CALLBACK_CLIENT_RECEIVE:
             if (client && in && len > 0) {
-                // Copiar dados recebidos para o buffer
-                size_t copy_len = len < WS_BUFFER_SIZE - 1 ? len : WS_BUFFER_SIZE - 1;
-                memcpy(client->recv_buffer, in, copy_len);
-                client->recv_buffer[copy_len] = '\0';
+                // Acumular fragmentos até a mensagem completa
+                size_t needed = client->recv_len + len + 1;
+                if (needed > client->recv_capacity) {
+                    size_t capacity = client->recv_capacity ? client->recv_capacity : WS_BUFFER_SIZE;
+                    while (capacity < needed) capacity *= 2;
+                    client->recv_buffer = (char*)safe_realloc(client->recv_buffer, capacity);
+                    client->recv_capacity = capacity;
+                }
+                memcpy(client->recv_buffer + client->recv_len, in, len);
+                client->recv_len += len;
+                client->recv_buffer[client->recv_len] = '\0';
+
+                if (!lws_is_final_fragment(wsi) || lws_remaining_packet_payload(wsi) > 0) {
+                    break;
+                }
+                client->recv_len = 0;
 
                 log_message(LOG_DEBUG, "Received: %s", client->recv_buffer);
 
@@ -50,8 +62,8 @@ static int websocket_callback(struct lws* wsi, enum lws_callback_reasons reason,
                 Operation* op = operation_deserialize(client->recv_buffer);
                 if (op && ctx->op_callback) {
                     ctx->op_callback(op, ctx->user_data);
-                    operation_destroy(op);
                 }
+                operation_destroy(op);
             }
             break;
 
@@ -62,12 +74,14 @@ static int websocket_callback(struct lws* wsi, enum lws_callback_reasons reason,
                 char* json = operation_serialize(op);
 
                 if (json) {
+                    // Operações em bloco podem passar de WS_BUFFER_SIZE
                     size_t json_len = strlen(json);
-                    unsigned char buf[LWS_PRE + WS_BUFFER_SIZE];
+                    unsigned char* buf = (unsigned char*)safe_malloc(LWS_PRE + json_len);
 
                     memcpy(&buf[LWS_PRE], json, json_len);
 
                     int written = lws_write(wsi, &buf[LWS_PRE], json_len, LWS_WRITE_TEXT);
+                    safe_free(buf);
                     if (written < 0) {
                         log_message(LOG_ERROR, "Failed to send data");
                     } else {
@@ -128,7 +142,9 @@ WebSocketClient* ws_create(const char* server, int port) {
     client->pending_count = 0;
 
     memset(client->send_buffer, 0, WS_BUFFER_SIZE);
-    memset(client->recv_buffer, 0, WS_BUFFER_SIZE);
+    client->recv_buffer = NULL;
+    client->recv_len = 0;
+    client->recv_capacity = 0;
 
     log_message(LOG_INFO, "Created WebSocket client for %s:%d", server, port);
     return client;
@@ -146,6 +162,7 @@ void ws_destroy(WebSocketClient* client) {
         operation_destroy(client->pending_ops[i]);
     }
     safe_free(client->pending_ops);
+    safe_free(client->recv_buffer);
 
     safe_free(client);
 }
@@ -269,11 +286,7 @@ int ws_send_operation(WebSocketClient* client, const Operation* op) {
     }
 
     // Criar cópia da operação
-    Operation* op_copy = operation_create(
-        op->op_type, op->line, op->column,
-        op->text, op->author
-    );
-    op_copy->timestamp = op->timestamp;
+    Operation* op_copy = operation_copy(op);
 
     client->pending_ops[client->pending_count++] = op_copy;
 
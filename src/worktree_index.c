@@ -0,0 +1,338 @@
+//
+// Created by HP on 16/10/2026.
+//
+#include "worktree_index.h"
+#include "utils.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define WORKTREE_INITIAL_BUCKETS 1024
+#define WORKTREE_BUCKET_EMPTY (-1)
+
+struct WorktreeIndex {
+    char path[512];
+    int fd;
+    void* map;                    // Arquivo como estava na abertura
+    size_t map_size;
+    const WorktreeEntry* mapped;  // Registros dentro do mapeamento
+    size_t mapped_count;
+    WorktreeEntry* appended;      // Registros acrescentados depois da abertura
+    size_t appended_count;
+    size_t appended_capacity;
+    long* buckets;                // Caminho -> posição do registro (endereçamento aberto)
+    size_t bucket_count;          // Potência de 2
+    size_t count;                 // Registros no arquivo (válidos e removidos)
+    unsigned long long live;
+    unsigned long long removed;
+    unsigned long long writes;
+    pthread_mutex_t mutex;
+};
+
+static const char* skip_current_dir(const char* path) {
+    return strncmp(path, "./", 2) == 0 ? path + 2 : path;
+}
+
+static uint64_t path_hash(const char* path) {
+    return hash_bytes64(path, strnlen(path, WORKTREE_PATH_LEN), WORKTREE_INDEX_SEED);
+}
+
+static uint64_t entry_check(const WorktreeEntry* entry) {
+    return hash_bytes64(entry, offsetof(WorktreeEntry, check), WORKTREE_INDEX_SEED);
+}
+
+static const WorktreeEntry* entry_at(const WorktreeIndex* index, size_t slot) {
+    return slot < index->mapped_count ? &index->mapped[slot] : &index->appended[slot - index->mapped_count];
+}
+
+static int entry_valid(const WorktreeEntry* entry) {
+    return (entry->flags & WORKTREE_ENTRY_VALID) && entry->check == entry_check(entry);
+}
+
+// Bucket do caminho, ou o bucket vazio onde ele entraria
+static size_t find_bucket(const WorktreeIndex* index, const char* path) {
+    size_t mask = index->bucket_count - 1;
+    for (size_t b = path_hash(path) & mask; ; b = (b + 1) & mask) {
+        long slot = index->buckets[b];
+        if (slot == WORKTREE_BUCKET_EMPTY ||
+            strncmp(entry_at(index, (size_t)slot)->path, path, WORKTREE_PATH_LEN) == 0) {
+            return b;
+        }
+    }
+}
+
+// Mantém a ocupação abaixo de 1/2 (não há remoções na tabela: o registro fica)
+static void grow_buckets(WorktreeIndex* index, size_t needed) {
+    if (index->buckets && needed * 2 <= index->bucket_count) return;
+
+    size_t count = index->bucket_count ? index->bucket_count : WORKTREE_INITIAL_BUCKETS;
+    while (needed * 2 > count) count *= 2;
+
+    safe_free(index->buckets);
+    index->buckets = (long*)safe_malloc(count * sizeof(long));
+    index->bucket_count = count;
+    for (size_t i = 0; i < count; i++) index->buckets[i] = WORKTREE_BUCKET_EMPTY;
+
+    for (size_t slot = 0; slot < index->count; slot++) {
+        const WorktreeEntry* entry = entry_at(index, slot);
+        size_t b = find_bucket(index, entry->path);
+        if (index->buckets[b] == WORKTREE_BUCKET_EMPTY) index->buckets[b] = (long)slot;
+    }
+}
+
+static int write_header(WorktreeIndex* index) {
+    WorktreeIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WORKTREE_INDEX_MAGIC, 8);
+    header.version = WORKTREE_INDEX_VERSION;
+    header.entry_size = sizeof(WorktreeEntry);
+    header.count = index->count;
+    return pwrite(index->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) ? 0 : -1;
+}
+
+// Mapeia o índice existente; arquivo ausente, de outra versão ou corrompido recomeça vazio
+// 0 se mapeado, 1 se o arquivo é novo ou de outra versão do índice (pode ser
+// reiniciado) e -1 se não é um índice: arquivo alheio nunca é sobrescrito
+static int map_existing(WorktreeIndex* index) {
+    struct stat st;
+    if (fstat(index->fd, &st) != 0) return -1;
+    if (st.st_size == 0) return 1;
+    if ((size_t)st.st_size < sizeof(WorktreeIndexHeader)) {
+        log_message(LOG_ERROR, "%s is not a worktree index", index->path);
+        return -1;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, index->fd, 0);
+    if (map == MAP_FAILED) {
+        log_message(LOG_ERROR, "Failed to map worktree index %s: %s", index->path, strerror(errno));
+        return -1;
+    }
+
+    const WorktreeIndexHeader* header = (const WorktreeIndexHeader*)map;
+    if (memcmp(header->magic, WORKTREE_INDEX_MAGIC, 8) != 0) {
+        log_message(LOG_ERROR, "%s is not a worktree index", index->path);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+    if (header->version != WORKTREE_INDEX_VERSION || header->entry_size != sizeof(WorktreeEntry)) {
+        log_message(LOG_WARNING, "Rebuilding incompatible worktree index %s", index->path);
+        munmap(map, (size_t)st.st_size);
+        return 1;
+    }
+
+    // Registros além do tamanho do arquivo (acréscimo interrompido) são ignorados
+    size_t available = ((size_t)st.st_size - sizeof(WorktreeIndexHeader)) / sizeof(WorktreeEntry);
+    index->map = map;
+    index->map_size = (size_t)st.st_size;
+    index->mapped = (const WorktreeEntry*)((const char*)map + sizeof(WorktreeIndexHeader));
+    index->mapped_count = header->count < available ? (size_t)header->count : available;
+    index->count = index->mapped_count;
+    return 0;
+}
+
+WorktreeIndex* worktree_index_open(const char* path) {
+    if (!path) return NULL;
+
+    WorktreeIndex* index = (WorktreeIndex*)safe_malloc(sizeof(WorktreeIndex));
+    memset(index, 0, sizeof(WorktreeIndex));
+    strncpy(index->path, path, sizeof(index->path) - 1);
+    pthread_mutex_init(&index->mutex, NULL);
+
+    index->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (index->fd < 0) {
+        log_message(LOG_ERROR, "Failed to open worktree index %s: %s", path, strerror(errno));
+        pthread_mutex_destroy(&index->mutex);
+        safe_free(index);
+        return NULL;
+    }
+
+    int status = map_existing(index);
+    if (status < 0) {
+        worktree_index_close(index);
+        return NULL;
+    }
+    if (status > 0) {
+        if (ftruncate(index->fd, 0) != 0 || write_header(index) != 0) {
+            log_message(LOG_ERROR, "Failed to initialize worktree index %s: %s", path, strerror(errno));
+            worktree_index_close(index);
+            return NULL;
+        }
+    }
+
+    // Só os caminhos são lidos na abertura; o check de cada registro é conferido na consulta
+    grow_buckets(index, index->count + 1);
+    for (size_t slot = 0; slot < index->count; slot++) {
+        if (index->mapped[slot].flags & WORKTREE_ENTRY_VALID) index->live++;
+        else index->removed++;
+    }
+
+    log_message(LOG_DEBUG, "Opened worktree index %s (%llu entries)", path, index->live);
+    return index;
+}
+
+// Regrava apenas os registros válidos (tmp + fsync + rename)
+static int rewrite_compacted(WorktreeIndex* index) {
+    char tmp_path[600];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index->path);
+
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return -1;
+
+    WorktreeIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, WORKTREE_INDEX_MAGIC, 8);
+    header.version = WORKTREE_INDEX_VERSION;
+    header.entry_size = sizeof(WorktreeEntry);
+
+    int ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+    for (size_t slot = 0; ok && slot < index->count; slot++) {
+        const WorktreeEntry* entry = entry_at(index, slot);
+        if (!entry_valid(entry)) continue;
+        ok = write(fd, entry, sizeof(*entry)) == (ssize_t)sizeof(*entry);
+        header.count++;
+    }
+    ok = ok && pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && fsync(fd) == 0;
+    ok = (close(fd) == 0) && ok;
+    if (ok && rename(tmp_path, index->path) == 0) return 0;
+
+    unlink(tmp_path);
+    return -1;
+}
+
+void worktree_index_close(WorktreeIndex* index) {
+    if (!index) return;
+
+    if (index->fd >= 0 && index->removed > 0 && index->removed * 4 > index->count &&
+        rewrite_compacted(index) != 0) {
+        log_message(LOG_WARNING, "Failed to compact worktree index %s", index->path);
+    }
+
+    if (index->map) munmap(index->map, index->map_size);
+    if (index->fd >= 0) close(index->fd);
+    pthread_mutex_destroy(&index->mutex);
+    safe_free(index->appended);
+    safe_free(index->buckets);
+    safe_free(index);
+}
+
+int worktree_index_lookup(WorktreeIndex* index, const char* path, WorktreeEntry* entry) {
+    if (!index || !path || !entry) return -1;
+    path = skip_current_dir(path);
+
+    pthread_mutex_lock(&index->mutex);
+    long slot = index->buckets[find_bucket(index, path)];
+    int found = slot != WORKTREE_BUCKET_EMPTY && entry_valid(entry_at(index, (size_t)slot));
+    if (found) *entry = *entry_at(index, (size_t)slot);
+    pthread_mutex_unlock(&index->mutex);
+    return found;
+}
+
+// Grava o registro na sua posição; posições novas vão para o fim do arquivo
+static int store_entry(WorktreeIndex* index, size_t slot, const WorktreeEntry* entry) {
+    off_t offset = (off_t)(sizeof(WorktreeIndexHeader) + slot * sizeof(WorktreeEntry));
+    if (pwrite(index->fd, entry, sizeof(*entry), offset) != (ssize_t)sizeof(*entry)) {
+        log_message(LOG_ERROR, "Failed to write worktree index %s: %s", index->path, strerror(errno));
+        return -1;
+    }
+    if (slot >= index->mapped_count) {
+        index->appended[slot - index->mapped_count] = *entry;
+    }
+    index->writes++;
+    return 0;
+}
+
+int worktree_index_update(WorktreeIndex* index, const char* path, const WorktreeStat* stat,
+                          const unsigned char digest[HASH_SHA256_SIZE], uint32_t flags) {
+    if (!index || !path || !stat || !digest) return -1;
+    path = skip_current_dir(path);
+    if (strlen(path) >= WORKTREE_PATH_LEN) return -1;
+
+    WorktreeEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.path, path, WORKTREE_PATH_LEN - 1);
+    entry.stat = *stat;
+    entry.flags = flags | WORKTREE_ENTRY_VALID;
+    memcpy(entry.digest, digest, HASH_SHA256_SIZE);
+    entry.check = entry_check(&entry);
+
+    pthread_mutex_lock(&index->mutex);
+    size_t b = find_bucket(index, path);
+    long slot = index->buckets[b];
+    int status;
+
+    if (slot != WORKTREE_BUCKET_EMPTY) {
+        int was_valid = entry_at(index, (size_t)slot)->flags & WORKTREE_ENTRY_VALID;
+        status = store_entry(index, (size_t)slot, &entry);
+        if (status == 0 && !was_valid) {
+            index->removed--;
+            index->live++;
+        }
+    } else {
+        if (index->appended_count == index->appended_capacity) {
+            index->appended_capacity = index->appended_capacity ? index->appended_capacity * 2 : 64;
+            index->appended = (WorktreeEntry*)safe_realloc(index->appended,
+                                                           index->appended_capacity * sizeof(WorktreeEntry));
+        }
+        index->appended_count++;
+        status = store_entry(index, index->count, &entry);
+        if (status == 0) {
+            // O registro só passa a contar depois de gravado por inteiro
+            index->count++;
+            status = write_header(index);
+            index->live++;
+            grow_buckets(index, index->count + 1);
+            index->buckets[find_bucket(index, path)] = (long)(index->count - 1);
+        } else {
+            index->appended_count--;
+        }
+    }
+    pthread_mutex_unlock(&index->mutex);
+    return status;
+}
+
+int worktree_index_remove(WorktreeIndex* index, const char* path) {
+    if (!index || !path) return -1;
+    path = skip_current_dir(path);
+
+    pthread_mutex_lock(&index->mutex);
+    long slot = index->buckets[find_bucket(index, path)];
+    int status = 0;
+    if (slot != WORKTREE_BUCKET_EMPTY && (entry_at(index, (size_t)slot)->flags & WORKTREE_ENTRY_VALID)) {
+        WorktreeEntry entry = *entry_at(index, (size_t)slot);
+        entry.flags &= ~(uint32_t)WORKTREE_ENTRY_VALID;
+        entry.check = entry_check(&entry);
+        status = store_entry(index, (size_t)slot, &entry);
+        if (status == 0) {
+            index->live--;
+            index->removed++;
+        }
+    }
+    pthread_mutex_unlock(&index->mutex);
+    return status;
+}
+
+void worktree_index_get_stats(WorktreeIndex* index, WorktreeIndexStats* stats) {
+    if (!index || !stats) return;
+    pthread_mutex_lock(&index->mutex);
+    stats->entries = index->live;
+    stats->removed = index->removed;
+    stats->writes = index->writes;
+    pthread_mutex_unlock(&index->mutex);
+}
+
+int worktree_stat(const char* path, WorktreeStat* stat_out) {
+    struct stat st;
+    if (!path || !stat_out || stat(path, &st) != 0) return -1;
+
+    stat_out->inode = (uint64_t)st.st_ino;
+    stat_out->size = (uint64_t)st.st_size;
+#ifdef __APPLE__
+    stat_out->mtime_ns = (int64_t)st.st_mtimespec.tv_sec * 1000000000LL + st.st_mtimespec.tv_nsec;
+#else
+    stat_out->mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+    return 0;
+}